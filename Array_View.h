@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+
+namespace CoDet {
+
+/*  Read only view of a contiguous array, not owning it.
+*
+*   Lets the BVH hand out its arrays the same way whether they live
+*   in vectors it owns or in memory it was mapped onto.
+*/
+template <typename T>
+class Array_View final
+{
+private:
+    const T*    first;
+    std::size_t count;
+
+public:
+    Array_View()
+        :   first   (nullptr)
+        ,   count   (0u)
+    {}
+
+    Array_View(
+            const T*            first,
+            const std::size_t   count
+    )
+        :   first   (first)
+        ,   count   (count)
+    {}
+
+    Array_View(
+            const std::vector<T>& v
+    )
+        :   first   (v.data())
+        ,   count   (v.size())
+    {}
+
+public:
+    const T*
+    data() const
+    {
+        return first;
+    }
+public:
+    std::size_t
+    size() const
+    {
+        return count;
+    }
+public:
+    bool
+    empty() const
+    {
+        return 0u == count;
+    }
+public:
+    const T&
+    operator[](
+            const std::size_t i ) const
+    {
+        assert( i < count );
+
+        return first[i];
+    }
+public:
+    const T*
+    begin() const
+    {
+        return first;
+    }
+public:
+    const T*
+    end() const
+    {
+        return first + count;
+    }
+};
+
+/*    used for testing */
+template <typename T>
+bool
+operator==(
+        const Array_View<T>& l,
+        const Array_View<T>& r )
+{
+    return
+           (l.size() == r.size())
+        && std::equal( l.begin(), l.end(), r.begin() );
+}
+
+}
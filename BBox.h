@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include "Point.h"
 
 namespace CoDet {
@@ -12,5 +15,236 @@ BBox
     Point max;
 };
 
+/*  Bounding box that contains nothing,
+*   neutral element of merge_bboxes. */
+inline
+BBox
+make_empty_bbox()
+{
+    constexpr float_t max_val = std::numeric_limits<float_t>::max();
+
+    return
+        BBox{   { +max_val, +max_val, +max_val },
+                { -max_val, -max_val, -max_val } };
+}
+
+/*  Grow bounding box so it contains given point. */
+inline
+void
+expand_bbox(
+        BBox&           bbox,
+        const Point&    p )
+{
+    for_each_coordinate(
+        [&bbox, &p]
+        ( const unsigned int coord )
+        {
+            if ( bbox.max.data[coord] < p.data[coord] ) bbox.max.data[coord] = p.data[coord];
+            if ( bbox.min.data[coord] > p.data[coord] ) bbox.min.data[coord] = p.data[coord];
+        } );
+}
+
+/*  Smallest bounding box containing both arguments. */
+inline
+BBox
+merge_bboxes(
+        const BBox& l,
+        const BBox& r )
+{
+    BBox ret;
+
+    for_each_coordinate(
+        [&ret, &l, &r]
+        ( const unsigned int coord )
+        {
+            ret.min.data[coord] = std::min( l.min.data[coord], r.min.data[coord] );
+            ret.max.data[coord] = std::max( l.max.data[coord], r.max.data[coord] );
+        } );
+
+    return ret;
+}
+
+/*  Check whether two bounding boxes intersect, touching ones do not. */
+inline
+bool
+do_bbox_intersect(
+        const BBox& bbox1,
+        const BBox& bbox2 )
+{
+    const auto test_coordinate_intersection =
+        [&bbox1,&bbox2]
+        ( const unsigned int coord )
+        {
+            return
+                  (bbox1.min.data[coord] < bbox2.max.data[coord])
+                & (bbox1.max.data[coord] > bbox2.min.data[coord]);    // bitwise operator to remove dependency
+        };
+
+    return
+          test_coordinate_intersection(0u)
+        & test_coordinate_intersection(1u)
+        & test_coordinate_intersection(2u);    // bitwise operator to remove dependency
+}
+
+/*  Surface area of the bounding box,
+*   zero for empty bounding box. */
+inline
+float_t
+surface_area(
+        const BBox& bbox )
+{
+    const auto dx = bbox.max.data[0u] - bbox.min.data[0u];
+    const auto dy = bbox.max.data[1u] - bbox.min.data[1u];
+    const auto dz = bbox.max.data[2u] - bbox.min.data[2u];
+
+    if ( (dx < 0) | (dy < 0) | (dz < 0) )
+    {
+        return 0;
+    }
+
+    return 2 * (dx*dy + dy*dz + dz*dx);
+}
+
+/*  Bounding box of a BVH node, stored in bound_t. */
+struct
+Node_BBox
+{
+    std::array<bound_t,3u> min;
+    std::array<bound_t,3u> max;
+};
+
+/*  Check whether two node bounding boxes intersect, touching ones do not.
+*   Same test as overlap_mask makes for many boxes at once. */
+inline
+bool
+do_bbox_intersect(
+        const Node_BBox& bbox1,
+        const Node_BBox& bbox2 )
+{
+    const auto test_coordinate_intersection =
+        [&bbox1,&bbox2]
+        ( const unsigned int coord )
+        {
+            return
+                  (bbox1.min[coord] < bbox2.max[coord])
+                & (bbox1.max[coord] > bbox2.min[coord]);    // bitwise operator to remove dependency
+        };
+
+    return
+          test_coordinate_intersection(0u)
+        & test_coordinate_intersection(1u)
+        & test_coordinate_intersection(2u);    // bitwise operator to remove dependency
+}
+
+/*  Distance to a neighbouring bound_t, at least one unit in the last place of b.
+*   Written out instead of std::nextafter, to keep <cmath> out of this header. */
+inline
+bound_t
+bound_step(
+        const bound_t b )
+{
+    const bound_t magnitude = (b < 0) ? -b : b;
+
+    return std::max( magnitude * std::numeric_limits<bound_t>::epsilon(), std::numeric_limits<bound_t>::denorm_min() );
+}
+
+/*  bound_t not greater than v, the nearest one or next to it. */
+inline
+bound_t
+round_down_to_bound(
+        const float_t v )
+{
+    if ( v < -std::numeric_limits<bound_t>::max() )
+    {
+        return -std::numeric_limits<bound_t>::infinity();
+    }
+    if ( v > std::numeric_limits<bound_t>::max() )
+    {
+        return std::numeric_limits<bound_t>::max();
+    }
+
+    const auto b = static_cast<bound_t>( v );
+
+    return (b > v) ? b - bound_step( b ) : b;
+}
+
+/*  bound_t not less than v, the nearest one or next to it. */
+inline
+bound_t
+round_up_to_bound(
+        const float_t v )
+{
+    if ( v > std::numeric_limits<bound_t>::max() )
+    {
+        return +std::numeric_limits<bound_t>::infinity();
+    }
+    if ( v < -std::numeric_limits<bound_t>::max() )
+    {
+        return -std::numeric_limits<bound_t>::max();
+    }
+
+    const auto b = static_cast<bound_t>( v );
+
+    return (b < v) ? b + bound_step( b ) : b;
+}
+
+/*  Node bounding box containing given bounding box,
+*   rounded outwards where bound_t cannot hold it exactly. */
+inline
+Node_BBox
+make_node_bbox(
+        const BBox& bbox )
+{
+    Node_BBox ret;
+
+    for_each_coordinate(
+        [&ret, &bbox]
+        ( const unsigned int coord )
+        {
+            ret.min[coord] = round_down_to_bound( bbox.min.data[coord] );
+            ret.max[coord] = round_up_to_bound( bbox.max.data[coord] );
+        } );
+
+    return ret;
 }
 
+/*  Node bounding box in float_t. */
+inline
+BBox
+to_bbox(
+        const Node_BBox& node_bbox )
+{
+    BBox ret;
+
+    for_each_coordinate(
+        [&ret, &node_bbox]
+        ( const unsigned int coord )
+        {
+            ret.min.data[coord] = node_bbox.min[coord];
+            ret.max.data[coord] = node_bbox.max[coord];
+        } );
+
+    return ret;
+}
+
+/*  Smallest node bounding box containing both arguments. */
+inline
+Node_BBox
+merge_bboxes(
+        const Node_BBox& l,
+        const Node_BBox& r )
+{
+    Node_BBox ret;
+
+    for_each_coordinate(
+        [&ret, &l, &r]
+        ( const unsigned int coord )
+        {
+            ret.min[coord] = std::min( l.min[coord], r.min[coord] );
+            ret.max[coord] = std::max( l.max[coord], r.max[coord] );
+        } );
+
+    return ret;
+}
+
+}
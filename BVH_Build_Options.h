@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace CoDet {
+
+class Task_Scheduler;
+
+/*  Tunables of BVH construction.
+*/
+struct
+BVH_Build_Options
+{
+    /*  When set, subtrees are built as tasks on this scheduler. */
+    Task_Scheduler*     scheduler       = nullptr;
+
+    /*  Ranges with fewer faces are built serially. */
+    std::size_t         parallel_cutoff = 4096u;
+
+    /*  Ranges with at most this many faces become a leaf.
+    *   Faces of a leaf are tested against each other by brute force
+    *   during pruning. Larger leaves mean fewer, shallower nodes.
+    */
+    std::size_t         max_leaf_size   = 1u;
+
+    /*  Nodes this many levels deep, the root being the first, become a
+    *   leaf with however many faces they have. Bounds recursion and
+    *   traversal depth when clustered or coincident faces keep splits
+    *   from separating them.
+    */
+    std::size_t         max_depth       = 64u;
+};
+
+}
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
+#include "BVH_Image.h"
+#include "BoundingVolumeHierarchy.h"
+
+using namespace CoDet;
+
+namespace {
+
+std::uint64_t
+align_up(
+        const std::uint64_t offset )
+{
+    return (offset + bvh_image_alignment - 1u) / bvh_image_alignment * bvh_image_alignment;
+}
+
+/*  Bytes taken by SoA bounds of count boxes, padding included. */
+std::uint64_t
+get_bounds_size(
+        const std::uint64_t count )
+{
+    return 6u * (count + Node_Bounds_SoA::padding) * sizeof(bound_t);
+}
+
+/*  Header of an image of bvh, offsets of the arrays filled in. */
+BVH_Image_Header
+make_header(
+        const BoundingVolumeHierarchy& bvh )
+{
+    BVH_Image_Header header;
+    std::memset( &header, 0, sizeof(header) );
+
+    header.magic            = bvh_image_magic;
+    header.byte_order       = bvh_image_byte_order;
+    header.version          = bvh_image_version;
+    header.bound_size       = sizeof(bound_t);
+    header.node_size        = sizeof(Compact_BVH_Node);
+    header.number_of_nodes  = static_cast<std::uint32_t>( bvh.get_nodes().size() );
+    header.number_of_faces  = static_cast<std::uint32_t>( bvh.get_face_order().size() );
+    header.has_face_bounds  = bvh.get_face_bounds().min[0u].empty() ? 0u : 1u;
+    header.bounds_padding   = Node_Bounds_SoA::padding;
+    header.built_sah_cost   = bvh.get_built_sah_cost();
+
+    header.nodes_offset         = align_up( sizeof(BVH_Image_Header) );
+    header.node_bounds_offset   = align_up( header.nodes_offset + header.number_of_nodes * sizeof(Compact_BVH_Node) );
+    header.face_order_offset    = align_up( header.node_bounds_offset + get_bounds_size( header.number_of_nodes ) );
+    header.face_bounds_offset   = align_up( header.face_order_offset + header.number_of_faces * sizeof(std::uint32_t) );
+    header.image_size           =
+        header.face_bounds_offset
+        + (header.has_face_bounds ? get_bounds_size( header.number_of_faces ) : 0u);
+
+    return header;
+}
+
+/*  Write SoA bounds, min then max, one coordinate after another. */
+void
+write_bounds(
+        const Node_Bounds_View& bounds,
+        unsigned char*          destination )
+{
+    for( const auto* coordinate_arrays : { bounds.min, bounds.max } )
+    for( unsigned int coord=0u; coord<3u; ++coord )
+    {
+        const auto& values = coordinate_arrays[coord];
+
+        std::memcpy( destination, values.data(), values.size() * sizeof(bound_t) );
+        destination += values.size() * sizeof(bound_t);
+    }
+}
+
+Node_Bounds_View
+read_bounds(
+        const unsigned char*    source,
+        const std::size_t       count )
+{
+    const auto length = count + Node_Bounds_SoA::padding;
+    const auto* values = reinterpret_cast<const bound_t*>( source );
+
+    Node_Bounds_View bounds;
+
+    for( unsigned int coord=0u; coord<3u; ++coord )
+    {
+        bounds.min[coord] = Array_View<bound_t>( values + coord * length, length );
+        bounds.max[coord] = Array_View<bound_t>( values + (3u + coord) * length, length );
+    }
+
+    return bounds;
+}
+
+/*  Whether size bytes starting at offset end at or before end, without
+*   the sum wrapping around.
+*/
+bool
+fits_before(
+        const std::uint64_t offset,
+        const std::uint64_t size,
+        const std::uint64_t end )
+{
+    return (offset <= end) && (size <= end - offset);
+}
+
+/*  Whether every node references children after itself and inside the
+*   node array, and faces inside the face order, and the face order only
+*   faces of the mesh. Children after their parent also rule out cycles.
+*   Leaves of more than one face need face bounds, queries test faces
+*   of such leaves against them.
+*/
+bool
+has_consistent_structure(
+        const BVH_Image_Header& header,
+        const unsigned char*    bytes )
+{
+    const auto* nodes       = reinterpret_cast<const Compact_BVH_Node*>( bytes + header.nodes_offset );
+    const auto* face_order  = reinterpret_cast<const std::uint32_t*>( bytes + header.face_order_offset );
+
+    for( std::uint32_t n=0u; n<header.number_of_nodes; ++n )
+    {
+        const auto& node = nodes[n];
+
+        if ( std::uint64_t( node.first_face ) + node.face_count > header.number_of_faces )
+        {
+            return false;
+        }
+
+        if ( (0u == node.child_count) && (1u < node.face_count) && (0u == header.has_face_bounds) )
+        {
+            return false;
+        }
+
+        if (   (0u != node.child_count)
+            && (   (node.first_child <= n)
+                || (std::uint64_t( node.first_child ) + node.child_count > header.number_of_nodes)) )
+        {
+            return false;
+        }
+    }
+
+    return
+        std::all_of(
+            face_order,
+            face_order + header.number_of_faces,
+            [&header]
+            ( const std::uint32_t face )
+            {
+                return face < header.number_of_faces;
+            } );
+}
+
+/*  Arrays of a checked image. */
+struct
+Image_Arrays
+{
+    Array_View<Compact_BVH_Node>    nodes;
+    Node_Bounds_View                node_bounds;
+    Array_View<std::uint32_t>       face_order;
+    Node_Bounds_View                face_bounds;
+    float_t                         built_sah_cost;
+};
+
+Image_Arrays
+read_image(
+        const void*         image,
+        const std::size_t   image_size )
+{
+    assert( BVH_Image_Status::valid == check_BVH_image( image, image_size ) );
+    (void)image_size;
+
+    BVH_Image_Header header;
+    std::memcpy( &header, image, sizeof(header) );
+
+    const auto* bytes = static_cast<const unsigned char*>( image );
+
+    Image_Arrays arrays;
+
+    arrays.nodes =
+        Array_View<Compact_BVH_Node>(
+            reinterpret_cast<const Compact_BVH_Node*>( bytes + header.nodes_offset ),
+            header.number_of_nodes );
+    arrays.node_bounds = read_bounds( bytes + header.node_bounds_offset, header.number_of_nodes );
+    arrays.face_order =
+        Array_View<std::uint32_t>(
+            reinterpret_cast<const std::uint32_t*>( bytes + header.face_order_offset ),
+            header.number_of_faces );
+
+    if ( 0u != header.has_face_bounds )
+    {
+        arrays.face_bounds = read_bounds( bytes + header.face_bounds_offset, header.number_of_faces );
+    }
+
+    arrays.built_sah_cost = static_cast<float_t>( header.built_sah_cost );
+
+    return arrays;
+}
+
+}
+
+BVH_Image_Status
+CoDet::check_BVH_image(
+        const void*         image,
+        const std::size_t   image_size )
+{
+    if ( 0u != reinterpret_cast<std::uintptr_t>( image ) % 8u )
+    {
+        return BVH_Image_Status::misaligned;
+    }
+
+    if ( image_size < sizeof(BVH_Image_Header) )
+    {
+        return BVH_Image_Status::truncated;
+    }
+
+    BVH_Image_Header header;
+    std::memcpy( &header, image, sizeof(header) );
+
+    if ( header.magic != bvh_image_magic )
+    {
+        return BVH_Image_Status::bad_magic;
+    }
+
+    if ( header.byte_order != bvh_image_byte_order )
+    {
+        return BVH_Image_Status::wrong_byte_order;
+    }
+
+    if ( header.version != bvh_image_version )
+    {
+        return BVH_Image_Status::unsupported_version;
+    }
+
+    if (   (header.bound_size != sizeof(bound_t))
+        || (header.node_size != sizeof(Compact_BVH_Node))
+        || (header.bounds_padding != Node_Bounds_SoA::padding) )
+    {
+        return BVH_Image_Status::incompatible_layout;
+    }
+
+    // arrays have to lie inside the image, in order. Each array is checked
+    // to end before the start of the next, checked one before it, so no
+    // offset can wrap around past the end of the image
+    const bool fits =
+           (0u != header.number_of_nodes)
+        && (header.image_size <= image_size)
+        && (header.nodes_offset >= sizeof(BVH_Image_Header))
+        && (0u == header.nodes_offset % bvh_image_alignment)
+        && (0u == header.node_bounds_offset % bvh_image_alignment)
+        && (0u == header.face_order_offset % bvh_image_alignment)
+        && (0u == header.face_bounds_offset % bvh_image_alignment)
+        && fits_before( header.face_bounds_offset, header.has_face_bounds ? get_bounds_size( header.number_of_faces ) : 0u, header.image_size )
+        && fits_before( header.face_order_offset, header.number_of_faces * std::uint64_t( sizeof(std::uint32_t) ), header.face_bounds_offset )
+        && fits_before( header.node_bounds_offset, get_bounds_size( header.number_of_nodes ), header.face_order_offset )
+        && fits_before( header.nodes_offset, header.number_of_nodes * std::uint64_t( sizeof(Compact_BVH_Node) ), header.node_bounds_offset );
+
+    if ( !fits )
+    {
+        return BVH_Image_Status::truncated;
+    }
+
+    if ( !has_consistent_structure( header, static_cast<const unsigned char*>( image ) ) )
+    {
+        return BVH_Image_Status::corrupt;
+    }
+
+    return BVH_Image_Status::valid;
+}
+
+std::vector<unsigned char>
+CoDet::make_BVH_image(
+        const BoundingVolumeHierarchy& bvh )
+{
+    const auto header = make_header( bvh );
+
+    std::vector<unsigned char> image( header.image_size, 0u );
+
+    std::memcpy( image.data(), &header, sizeof(header) );
+
+    const auto& nodes = bvh.get_nodes();
+    std::memcpy( image.data() + header.nodes_offset, nodes.data(), nodes.size() * sizeof(Compact_BVH_Node) );
+
+    write_bounds( bvh.get_node_bounds(), image.data() + header.node_bounds_offset );
+
+    const auto& face_order = bvh.get_face_order();
+    std::memcpy( image.data() + header.face_order_offset, face_order.data(), face_order.size() * sizeof(std::uint32_t) );
+
+    if ( 0u != header.has_face_bounds )
+    {
+        write_bounds( bvh.get_face_bounds(), image.data() + header.face_bounds_offset );
+    }
+
+    return image;
+}
+
+bool
+CoDet::write_BVH_image(
+        const BoundingVolumeHierarchy&  bvh,
+        const char*                     path )
+{
+    const auto image = make_BVH_image( bvh );
+
+    auto* const file = std::fopen( path, "wb" );
+
+    if ( nullptr == file )
+    {
+        return false;
+    }
+
+    const bool written = (image.size() == std::fwrite( image.data(), 1u, image.size(), file ));
+
+    return (0 == std::fclose( file )) && written;
+}
+
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_from_image(
+        const void*                     image,
+        const std::size_t               image_size,
+        const std::vector<Mesh_Face>&   mesh_face_data )
+{
+    const auto arrays = read_image( image, image_size );
+
+    assert( arrays.face_order.size() == mesh_face_data.size() );
+
+    BoundingVolumeHierarchy bvh;
+    bvh.nodes           = arrays.nodes;
+    bvh.node_bounds     = arrays.node_bounds;
+    bvh.face_order      = arrays.face_order;
+    bvh.face_bounds     = arrays.face_bounds;
+    bvh.mesh_faces      = mesh_face_data.data();
+    bvh.built_sah_cost  = arrays.built_sah_cost;
+    bvh.is_mapped       = true;
+
+    return bvh;
+}
+
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_from_image(
+        const void*                     image,
+        const std::size_t               image_size,
+        const Indexed_Mesh&             mesh )
+{
+    const auto arrays = read_image( image, image_size );
+
+    assert( arrays.face_order.size() == mesh.size() );
+
+    BoundingVolumeHierarchy bvh;
+    bvh.nodes           = arrays.nodes;
+    bvh.node_bounds     = arrays.node_bounds;
+    bvh.face_order      = arrays.face_order;
+    bvh.face_bounds     = arrays.face_bounds;
+    bvh.indexed_mesh    = mesh;
+    bvh.built_sah_cost  = arrays.built_sah_cost;
+    bvh.is_mapped       = true;
+
+    return bvh;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+namespace CoDet {
+
+// forward decls
+class BoundingVolumeHierarchy;
+
+/*  On-disk image of a built BVH.
+*
+*   A header followed by the node array, SoA node bounds, face order
+*   and, if the BVH has them, SoA face bounds, each at an offset from
+*   the start of the image. Nothing in it is a pointer, so the image can
+*   be mapped anywhere and BoundingVolumeHierarchy::make_BVH_from_image
+*   reads the arrays in place. Mesh face data is not part of the image.
+*
+*   Arrays are written in the byte order and scalar types of the
+*   producing build. The header records both, an image from a build
+*   that differs is rejected by check_BVH_image rather than converted.
+*/
+struct
+BVH_Image_Header
+{
+    std::array<char,8u> magic;
+    std::uint32_t       byte_order;         // bvh_image_byte_order, as written by the producer
+    std::uint32_t       version;
+    std::uint32_t       bound_size;         // sizeof(bound_t)
+    std::uint32_t       node_size;          // sizeof(Compact_BVH_Node)
+    std::uint32_t       number_of_nodes;
+    std::uint32_t       number_of_faces;
+    std::uint32_t       has_face_bounds;
+    std::uint32_t       bounds_padding;     // Node_Bounds_SoA::padding
+    std::uint64_t       nodes_offset;
+    std::uint64_t       node_bounds_offset;
+    std::uint64_t       face_order_offset;
+    std::uint64_t       face_bounds_offset;
+    std::uint64_t       image_size;
+    double              built_sah_cost;
+};
+
+static_assert( std::is_standard_layout<BVH_Image_Header>::value, "BVH_Image_Header is written as is" );
+
+constexpr std::array<char,8u>   bvh_image_magic         { { 'C', 'o', 'D', 'e', 't', 'B', 'V', 'H' } };
+constexpr std::uint32_t         bvh_image_byte_order    = 0x01020304u;
+constexpr std::uint32_t         bvh_image_version       = 1u;
+
+/*  Arrays start at multiples of this many bytes from the start of the image. */
+constexpr std::size_t           bvh_image_alignment     = 64u;
+
+enum class
+BVH_Image_Status
+{
+    valid,
+    truncated,              // shorter than its header says
+    bad_magic,              // not a BVH image
+    wrong_byte_order,       // written on a machine of the other endianness
+    unsupported_version,
+    incompatible_layout,    // bound or node size of another build configuration
+    misaligned,             // image does not start at an 8 byte boundary
+    corrupt                 // nodes or face order index outside their arrays,
+                            // or leaves of several faces lack face bounds
+};
+
+// whether image can be read in place by this build. Besides the header,
+// every node and face order entry is checked to index inside the image,
+// in time linear in its size, so that images from untrusted sources
+// cannot make queries read outside the mapping. Bounds are not checked.
+BVH_Image_Status
+check_BVH_image(
+        const void*         image,
+        const std::size_t   image_size );
+
+// image of a BVH, in memory
+std::vector<unsigned char>
+make_BVH_image(
+        const BoundingVolumeHierarchy& bvh );
+
+// image of a BVH, written to a file. Returns false if it could not be written.
+bool
+write_BVH_image(
+        const BoundingVolumeHierarchy&  bvh,
+        const char*                     path );
+
+/*  Read only memory mapping of a whole file, through mmap on POSIX
+*   systems and file mapping objects on Windows.
+*
+*   Pages are shared with every other process mapping the same file
+*   and loaded on first access. Unmapped on destruction.
+*/
+class Mapped_File final
+{
+private:
+    const void*     mapping;
+    std::size_t     mapping_size;
+
+private:
+    void
+    unmap();
+
+public:
+    Mapped_File()
+        :   mapping         (nullptr)
+        ,   mapping_size    (0u)
+    {}
+
+    Mapped_File(
+            Mapped_File&& other )
+        :   mapping         (other.mapping)
+        ,   mapping_size    (other.mapping_size)
+    {
+        other.mapping       = nullptr;
+        other.mapping_size  = 0u;
+    }
+
+    Mapped_File&
+    operator=(
+            Mapped_File&& other );
+
+    Mapped_File(
+            const Mapped_File& ) = delete;
+
+    Mapped_File&
+    operator=(
+            const Mapped_File& ) = delete;
+
+    ~Mapped_File();
+
+public:
+    const void*
+    data() const
+    {
+        return mapping;
+    }
+public:
+    std::size_t
+    size() const
+    {
+        return mapping_size;
+    }
+public:
+    bool
+    is_mapped() const
+    {
+        return nullptr != mapping;
+    }
+
+public:
+    /*  Map file at path, unmapped result if it cannot be opened
+    *   or mapped, or is empty.
+    */
+    static
+    Mapped_File
+    map_file(
+            const char* path );
+};
+
+}
@@ -1,93 +1,351 @@
 #pragma once
 
 #include <vector>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
 #include <cassert>
 #include "BBox.h"
+#include "Compact_BVH_Node.h"
+#include "Mesh_Face.h"
+#include "Indexed_Mesh.h"
 
 namespace CoDet {
 
-struct Mesh_Face;
 using Mesh_face_iterator = decltype( std::vector<const Mesh_Face*>().begin() );
 
+/*  Face of an Indexed_Mesh while a BVH is built over it.
+*   Partitioning moves only its index and centroid, vertices
+*   are read through the mesh when bounds are needed.
+*/
+struct
+Indexed_Build_Face
+{
+    Point                   centroid;
+    const Indexed_Mesh*     mesh;
+    std::uint32_t           index;
+};
+
+using Indexed_face_iterator = std::vector<Indexed_Build_Face>::iterator;
+
+/*  Accessors partitioning policies read faces through,
+*   for ranges of either iterator type.
+*/
+inline
+float_t
+get_face_centroid(
+        const Mesh_Face&    face,
+        const unsigned int  coord )
+{
+    return
+        (face.vertices[0u].data[coord]
+        +face.vertices[1u].data[coord]
+        +face.vertices[2u].data[coord])
+        * 0.33333333333;
+}
+
+inline
+float_t
+get_face_centroid(
+        const Mesh_Face*    face,
+        const unsigned int  coord )
+{
+    return get_face_centroid( *face, coord );
+}
+
+inline
+float_t
+get_face_centroid(
+        const Indexed_Build_Face&   face,
+        const unsigned int          coord )
+{
+    return face.centroid.data[coord];
+}
+
+inline
+BBox
+get_face_bbox(
+        const Mesh_Face& face )
+{
+    auto bbox = make_empty_bbox();
+
+    for( const auto& vert : face.vertices )
+    {
+        expand_bbox( bbox, vert );
+    }
+
+    return bbox;
+}
+
+inline
+BBox
+get_face_bbox(
+        const Mesh_Face* face )
+{
+    return get_face_bbox( *face );
+}
+
+inline
+BBox
+get_face_bbox(
+        const Indexed_Build_Face& face )
+{
+    return get_face_bbox( face.mesh->get_face( face.index ) );
+}
+
+inline
+Indexed_Build_Face
+make_indexed_build_face(
+        const Indexed_Mesh&     mesh,
+        const std::uint32_t     face_index )
+{
+    const auto face = mesh.get_face( face_index );
+
+    return
+        Indexed_Build_Face{
+            make_point(
+                [&face]
+                ( const unsigned int coord )
+                {
+                    return get_face_centroid( face, coord );
+                } ),
+            &mesh,
+            face_index };
+}
+
+class BVH_Node_Range;
+
 /*  Node of the BVH.
 *
+*   Lightweight view of one node in the flattened node array.
 *   Holds bounding box of elements contained.
-*   It also holds either child nodes or mesh faces (if leaf).
+*   It also gives access to either child nodes or mesh face (if leaf).
 */
 class BVH_Node final
 {
 private:
-    BBox                    bbox;
-    std::vector<BVH_Node>   child_volumes;
-    Mesh_Face*              face;
+    const Compact_BVH_Node* nodes;
+    const std::uint32_t*    face_order;
+    const Mesh_Face*        mesh_faces;
+    std::uint32_t           index;
 
-private:
-    explicit
-    BVH_Node(
-            const Mesh_face_iterator    mesh_face_data,
-            const BBox                  bbox
-    )
-        :   bbox    (bbox)
-        ,   face    (const_cast<Mesh_Face*>(*mesh_face_data))
-    {
-    }
-private:
+public:
     explicit
     BVH_Node(
-            std::vector<BVH_Node>&&      nodes,
-            const BBox                   bbox
+            const Compact_BVH_Node* nodes,
+            const std::uint32_t*    face_order,
+            const Mesh_Face*        mesh_faces,
+            const std::uint32_t     index
     )
-        :   bbox            (bbox)
-        ,   child_volumes   (nodes)
-        ,   face            (nullptr)
+        :   nodes       (nodes)
+        ,   face_order  (face_order)
+        ,   mesh_faces  (mesh_faces)
+        ,   index       (index)
     {
-        assert( !child_volumes.empty() );
+        assert( nullptr != nodes );
     }
 
 public:
-    const std::vector<BVH_Node>&
-    get_child_volumes() const
-    {
-        return child_volumes;
-    }
+    BVH_Node_Range
+    get_child_volumes() const;
 public:
+    /*  First face of a leaf, nullptr for interior nodes and for BVHs built
+    *   from an Indexed_Mesh, which have no Mesh_Face data, see get_face_index.
+    *   Leaves of a BVH built with max_leaf_size above one can hold more,
+    *   they follow the first one in the face order.
+    */
     const Mesh_Face*
     get_face() const
     {
-        return face;
+        const auto& node = nodes[index];
+
+        if ( !is_leaf( node ) || (nullptr == mesh_faces) )
+        {
+            return nullptr;
+        }
+
+        return mesh_faces + face_order[node.first_face];
     }
 public:
-    const BBox&
+    /*  Index of the first face of a leaf, into the mesh the BVH was built from. */
+    std::uint32_t
+    get_face_index() const
+    {
+        const auto& node = nodes[index];
+
+        assert( is_leaf( node ) );
+
+        return face_order[node.first_face];
+    }
+public:
+    BBox
     get_bbox() const
     {
-        return bbox;
+        return to_bbox( nodes[index].bbox );
+    }
+public:
+    std::uint32_t
+    get_index() const
+    {
+        return index;
     }
+};
 
+/*  Range of sibling nodes, as returned by BVH_Node::get_child_volumes.
+*/
+class BVH_Node_Range final
+{
 public:
-    static
-    auto
-    make_BVH_Node(
-            const Mesh_face_iterator    mesh_face_data,
-            const BBox                  bbox )
+    class iterator final
     {
-        return
-            BVH_Node(
-                mesh_face_data,
-                bbox );
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = BVH_Node;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = BVH_Node;
+
+    private:
+        const Compact_BVH_Node* nodes;
+        const std::uint32_t*    face_order;
+        const Mesh_Face*        mesh_faces;
+        std::uint32_t           index;
+
+    public:
+        explicit
+        iterator(
+                const Compact_BVH_Node* nodes,
+                const std::uint32_t*    face_order,
+                const Mesh_Face*        mesh_faces,
+                const std::uint32_t     index
+        )
+            :   nodes       (nodes)
+            ,   face_order  (face_order)
+            ,   mesh_faces  (mesh_faces)
+            ,   index       (index)
+        {}
+
+    public:
+        BVH_Node
+        operator*() const
+        {
+            return
+                BVH_Node(
+                    nodes,
+                    face_order,
+                    mesh_faces,
+                    index );
+        }
+    public:
+        iterator&
+        operator++()
+        {
+            ++index;
+            return *this;
+        }
+    public:
+        iterator
+        operator++( int )
+        {
+            const auto ret = *this;
+            ++index;
+            return ret;
+        }
+    public:
+        bool
+        operator==(
+                const iterator& other ) const
+        {
+            return index == other.index;
+        }
+    public:
+        bool
+        operator!=(
+                const iterator& other ) const
+        {
+            return index != other.index;
+        }
+    };
+
+private:
+    const Compact_BVH_Node* nodes;
+    const std::uint32_t*    face_order;
+    const Mesh_Face*        mesh_faces;
+    std::uint32_t           first;
+    std::uint32_t           count;
+
+public:
+    explicit
+    BVH_Node_Range(
+            const Compact_BVH_Node* nodes,
+            const std::uint32_t*    face_order,
+            const Mesh_Face*        mesh_faces,
+            const std::uint32_t     first,
+            const std::uint32_t     count
+    )
+        :   nodes       (nodes)
+        ,   face_order  (face_order)
+        ,   mesh_faces  (mesh_faces)
+        ,   first       (first)
+        ,   count       (count)
+    {}
+
+public:
+    std::size_t
+    size() const
+    {
+        return count;
     }
 public:
-    static
-    auto
-    make_BVH_Node(
-            std::vector<BVH_Node>&& nodes,
-            const BBox                bbox )
+    bool
+    empty() const
     {
+        return 0u == count;
+    }
+public:
+    BVH_Node
+    operator[](
+            const std::size_t i ) const
+    {
+        assert( i < count );
+
         return
             BVH_Node(
-                std::move(nodes),
-                bbox );
+                nodes,
+                face_order,
+                mesh_faces,
+                first + static_cast<std::uint32_t>(i) );
+    }
+public:
+    iterator
+    begin() const
+    {
+        return iterator( nodes, face_order, mesh_faces, first );
+    }
+public:
+    iterator
+    end() const
+    {
+        return iterator( nodes, face_order, mesh_faces, first + count );
     }
 };
 
+/*  If interior node, range of its children.
+*   If leaf, empty range.
+*/
+inline
+BVH_Node_Range
+BVH_Node::get_child_volumes() const
+{
+    const auto& node = nodes[index];
+
+    return
+        BVH_Node_Range(
+            nodes,
+            face_order,
+            mesh_faces,
+            node.first_child,
+            node.child_count );
 }
 
+}
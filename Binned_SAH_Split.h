@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#include <limits>
+#include <cassert>
+#include "BBox.h"
+#include "BVH_Node.h"
+#include "Mesh_Face.h"
+#include "Naive_Oct_Split.h"
+
+namespace CoDet {
+
+/*    Partition faces in two using binned Surface Area Heuristic.
+ *
+ *    Face centroids are binned along each axis, and the split plane
+ *    between bins which minimises area weighted face count of both
+ *    sides is chosen. Number of bins trades build time for tree quality.
+ *    Falls back to object median split along the axis of widest centroid
+ *    spread when bins can not separate the centroids.
+ * */
+class Binned_SAH_Split final
+{
+private:
+    unsigned int    number_of_bins;
+
+public:
+    explicit
+    Binned_SAH_Split(
+            const unsigned int number_of_bins = 16u
+    )
+        :   number_of_bins  (number_of_bins)
+    {
+        assert( 2u <= number_of_bins );
+    }
+
+private:
+    struct
+    Bin
+    {
+        BBox            bbox;
+        unsigned int    count;
+    };
+
+private:
+    unsigned int
+    bin_of(
+            const float_t   c,
+            const float_t   cmin,
+            const float_t   scale ) const
+    {
+        const auto bin = static_cast<unsigned int>( (c - cmin) * scale );
+
+        return std::min( bin, number_of_bins - 1u );
+    }
+
+public:
+    template <typename Face_iterator>
+    std::vector<std::tuple<const Face_iterator,const Face_iterator>>
+    operator()(
+            const Face_iterator     mesh_face_data_begin,
+            const Face_iterator     mesh_face_data_end,
+            const BBox              /*bbox*/ ) const
+    {
+        assert( mesh_face_data_begin < mesh_face_data_end );
+
+        std::vector<std::tuple<const Face_iterator,const Face_iterator>> ret;
+
+        // bounds of centroids
+        auto centroid_bbox = make_empty_bbox();
+        for( auto it=mesh_face_data_begin; it!=mesh_face_data_end; ++it )
+        {
+            expand_bbox(
+                centroid_bbox,
+                make_point(
+                    [it]
+                    ( const unsigned int coord )
+                    {
+                        return get_face_centroid( *it, coord );
+                    } ) );
+        }
+
+        float_t         best_cost  = std::numeric_limits<float_t>::max();
+        unsigned int    best_axis  = 0u;
+        unsigned int    best_split = 0u;
+
+        std::vector<Bin>            bins( number_of_bins );
+        std::vector<float_t>        right_area( number_of_bins );
+        std::vector<unsigned int>   right_count( number_of_bins );
+
+        for( unsigned int axis=0u; axis<3u; ++axis )
+        {
+            const auto cmin   = centroid_bbox.min.data[axis];
+            const auto extent = centroid_bbox.max.data[axis] - cmin;
+
+            if ( !(extent > 0) )
+            {
+                continue;
+            }
+
+            const auto scale = number_of_bins / extent;
+
+            // a denormal extent overflows the scale, bin of the lowest
+            // centroid would come out of 0 * inf
+            if ( !(scale <= std::numeric_limits<float_t>::max()) )
+            {
+                continue;
+            }
+
+            std::fill( bins.begin(), bins.end(), Bin{ make_empty_bbox(), 0u } );
+
+            for( auto it=mesh_face_data_begin; it!=mesh_face_data_end; ++it )
+            {
+                auto& bin = bins[ bin_of( get_face_centroid( *it, axis ), cmin, scale ) ];
+
+                bin.bbox = merge_bboxes( bin.bbox, get_face_bbox( *it ) );
+                ++bin.count;
+            }
+
+            // sweep from the right, right_*[i] describe bins [i, number_of_bins)
+            auto            acc_bbox  = make_empty_bbox();
+            unsigned int    acc_count = 0u;
+            for( unsigned int i=number_of_bins; i-->1u; )
+            {
+                acc_bbox   = merge_bboxes( acc_bbox, bins[i].bbox );
+                acc_count += bins[i].count;
+
+                right_area[i]  = surface_area( acc_bbox );
+                right_count[i] = acc_count;
+            }
+
+            // sweep from the left, split i puts bins [0, i) left
+            acc_bbox  = make_empty_bbox();
+            acc_count = 0u;
+            for( unsigned int i=1u; i<number_of_bins; ++i )
+            {
+                acc_bbox   = merge_bboxes( acc_bbox, bins[i-1u].bbox );
+                acc_count += bins[i-1u].count;
+
+                if ( (0u == acc_count) | (0u == right_count[i]) )
+                {
+                    continue;
+                }
+
+                const auto cost =
+                      surface_area( acc_bbox ) * acc_count
+                    + right_area[i] * right_count[i];
+
+                if ( cost < best_cost )
+                {
+                    best_cost  = cost;
+                    best_axis  = axis;
+                    best_split = i;
+                }
+            }
+        }
+
+        if ( 0u == best_split )
+        {
+            // centroids coincide or can not be separated by bins
+            return split_at_object_median( mesh_face_data_begin, mesh_face_data_end );
+        }
+
+        const auto cmin  = centroid_bbox.min.data[best_axis];
+        const auto scale = number_of_bins / (centroid_bbox.max.data[best_axis] - cmin);
+
+        const auto middle =
+            std::partition(
+                mesh_face_data_begin,
+                mesh_face_data_end,
+                [this,best_axis,best_split,cmin,scale]
+                ( const auto& el )
+                {
+                    return bin_of( get_face_centroid( el, best_axis ), cmin, scale ) < best_split;
+                } );
+
+        assert( mesh_face_data_begin < middle );
+        assert( middle < mesh_face_data_end );
+
+        ret.emplace_back( mesh_face_data_begin, middle );
+        ret.emplace_back( middle, mesh_face_data_end );
+
+        return ret;
+    }
+};
+
+}
@@ -1,10 +1,20 @@
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <limits>
+#include <numeric>
 #include <tuple>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
 #include <cassert>
 #include "BoundingVolumeHierarchy.h"
 #include "Mesh_Face.h"
 #include "BBox.h"
 #include "Naive_Oct_Split.h"
+#include "Binned_SAH_Split.h"
+#include "Task_Scheduler.h"
+#include "Statistics.h"
 
 using namespace CoDet;
 
@@ -12,86 +22,965 @@ namespace {
 
 /*  Compute Bounding Box
 */
+template <typename Face_iterator>
 BBox
 find_bounds(
-        const Mesh_face_iterator    mesh_face_data_begin,
-        const Mesh_face_iterator    mesh_face_data_end )
+        const Face_iterator     mesh_face_data_begin,
+        const Face_iterator     mesh_face_data_end )
 {
     assert( mesh_face_data_begin < mesh_face_data_end );
 
-    constexpr float max_val = std::numeric_limits<float_t>::max();
-    BBox bbox{  { +max_val, +max_val, +max_val},
-                { -max_val, -max_val, -max_val} };
+    auto bbox = make_empty_bbox();
 
     for( auto face=mesh_face_data_begin; face!=mesh_face_data_end; ++face )
     {
-        for( const auto& vert : (*face)->vertices )
-        {
-            for_each_coordinate(
-                [&bbox, vert]
-                ( const unsigned int coord )
-                {
-                    if ( bbox.max.data[coord] < vert.data[coord] ) bbox.max.data[coord] = vert.data[coord];
-                    if ( bbox.min.data[coord] > vert.data[coord] ) bbox.min.data[coord] = vert.data[coord];
-                });
-        }
+        bbox = merge_bboxes( bbox, get_face_bbox( *face ) );
     }
 
-    assert( +max_val != bbox.max.data[0u] );
-    assert( -max_val != bbox.min.data[0u] );
+    assert( bbox.min.data[0u] <= bbox.max.data[0u] );
 
     return bbox;
 }
 
-/*  Build BVH using top down approach.
-    Partitioning method is provided as a policy.
+/*  Time spent in parts of one build, summed over its threads.
 */
-template <typename Partitioning_policy>
+struct
+Build_Timers
+{
+    std::atomic<std::int64_t>   find_bounds_nanoseconds     {0};
+    std::atomic<std::int64_t>   partitioning_nanoseconds    {0};
+};
+
+#if defined(CODET_ENABLE_STATISTICS)
+void
+add_elapsed_time(
+        std::atomic<std::int64_t>&                      nanoseconds,
+        const std::chrono::steady_clock::time_point     start )
+{
+    nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+}
+#endif
+
+/*  State shared by all recursion levels of one build.
+    Faces are reached through Face_iterator, see BVH_Node.h.
+*/
+template <typename Partitioning_policy, typename Face_iterator>
+struct
+Build_Context
+{
+    Face_iterator                           mesh_face_data_first;
+    std::decay_t<Partitioning_policy>       partitioning_policy;
+    BVH_Build_Options                       options;
+    Build_Timers*                           timers;     // only used with CODET_ENABLE_STATISTICS
+};
+
+/*  Fill in the node for given range of faces, depth levels below the root.
+    Returns ranges of its children, empty if the node is a leaf.
+*/
+template <typename Partitioning_policy, typename Face_iterator>
 auto
-_build_BVH_topDown(
-        const Mesh_face_iterator    mesh_face_data_begin,
-        const Mesh_face_iterator    mesh_face_data_end,
-        Partitioning_policy            partitioning_policy )
+_make_node(
+        const Build_Context<Partitioning_policy,Face_iterator>& context,
+        const Face_iterator                                     mesh_face_data_begin,
+        const Face_iterator                                     mesh_face_data_end,
+        const std::size_t                                       depth,
+        Compact_BVH_Node&                                       node )
 {
     assert( mesh_face_data_begin < mesh_face_data_end );
 
+    CODET_STATISTICS( const auto find_bounds_start = std::chrono::steady_clock::now() );
+
     const auto bbox = find_bounds( mesh_face_data_begin, mesh_face_data_end );
 
+    CODET_STATISTICS( add_elapsed_time( context.timers->find_bounds_nanoseconds, find_bounds_start ) );
+
     const auto number_of_faces = mesh_face_data_end - mesh_face_data_begin;
 
     assert( 0u != number_of_faces );
-    if ( 1u == number_of_faces )
+
+    node.bbox           = make_node_bbox( bbox );
+    node.first_child    = 0u;
+    node.child_count    = 0u;
+    node.first_face     = static_cast<std::uint32_t>( mesh_face_data_begin - context.mesh_face_data_first );
+    node.face_count     = static_cast<std::uint32_t>( number_of_faces );
+
+    if (   (static_cast<std::size_t>( number_of_faces ) <= context.options.max_leaf_size)
+        || (depth >= context.options.max_depth) )
     {
-        return
-            BVH_Node::make_BVH_Node(
-                mesh_face_data_begin,
-                bbox );
+        return decltype( context.partitioning_policy( mesh_face_data_begin, mesh_face_data_end, bbox ) )();
     }
 
+    CODET_STATISTICS( const auto partitioning_start = std::chrono::steady_clock::now() );
+
     // partition and sort faces and get ranges for each partition
-    const auto child_volume_ranges =
-        partitioning_policy(
+    auto child_volume_ranges =
+        context.partitioning_policy(
             mesh_face_data_begin,
             mesh_face_data_end,
             bbox );
 
+    CODET_STATISTICS( add_elapsed_time( context.timers->partitioning_nanoseconds, partitioning_start ) );
+
     assert( 0u != child_volume_ranges.size() );
 
-    std::vector<BVH_Node> ret;
+    // a policy that returns the range itself would recurse on it forever
+    if ( 1u == child_volume_ranges.size() )
+    {
+        child_volume_ranges.clear();
+    }
+
+    return child_volume_ranges;
+}
+
+/*  Reserve contiguous block for children of the node at node_index.
+*/
+void
+_reserve_children(
+        std::vector<Compact_BVH_Node>&  nodes,
+        const std::uint32_t             node_index,
+        const std::size_t               number_of_children )
+{
+    const auto first_child = static_cast<std::uint32_t>( nodes.size() );
+    nodes.resize( nodes.size() + number_of_children );
+
+    nodes[node_index].first_child   = first_child;
+    nodes[node_index].child_count   = static_cast<std::uint32_t>( number_of_children );
+}
+
+/*  Build BVH using top down approach.
+    Partitioning method is provided as a policy.
+
+    Node at node_index is written in place. Children of a split node
+    are reserved as one contiguous block at the end of the node array
+    and then built one after another, depth first.
+*/
+template <typename Partitioning_policy, typename Face_iterator>
+void
+_build_BVH_topDown(
+        const Build_Context<Partitioning_policy,Face_iterator>& context,
+        const Face_iterator                                     mesh_face_data_begin,
+        const Face_iterator                                     mesh_face_data_end,
+        const std::size_t                                       depth,
+        const std::uint32_t                                     node_index,
+        std::vector<Compact_BVH_Node>&                          nodes )
+{
+    assert( node_index < nodes.size() );
+
+    const auto child_volume_ranges =
+        _make_node(
+            context,
+            mesh_face_data_begin,
+            mesh_face_data_end,
+            depth,
+            nodes[node_index] );
+
+    if ( child_volume_ranges.empty() )
+    {
+        return;
+    }
+
+    _reserve_children( nodes, node_index, child_volume_ranges.size() );
+
     // produce a node for each partition
+    std::uint32_t child_index = nodes[node_index].first_child;
     for( auto& child_volume_range : child_volume_ranges )
     {
-        ret.emplace_back(
-            _build_BVH_topDown<Partitioning_policy>(
-                std::get<0>( child_volume_range ),
-                std::get<1>( child_volume_range ),
-                partitioning_policy ) );
+        _build_BVH_topDown(
+            context,
+            std::get<0>( child_volume_range ),
+            std::get<1>( child_volume_range ),
+            depth + 1u,
+            child_index++,
+            nodes );
+    }
+}
+
+/*  Move subtree built in its own array into the node array.
+    Root of the subtree goes to the reserved slot, the rest is appended,
+    which reproduces the layout a serial build would have produced.
+*/
+void
+_append_subtree(
+        std::vector<Compact_BVH_Node>&          nodes,
+        const std::uint32_t                     slot,
+        const std::vector<Compact_BVH_Node>&    subtree )
+{
+    assert( !subtree.empty() );
+
+    const auto base = static_cast<std::uint32_t>( nodes.size() ) - 1u;
+
+    const auto relocate =
+        [base]
+        ( Compact_BVH_Node node )
+        {
+            if ( !is_leaf( node ) )
+            {
+                node.first_child += base;
+            }
+            return node;
+        };
+
+    nodes[slot] = relocate( subtree[0u] );
+
+    std::transform(
+        subtree.begin() + 1u,
+        subtree.end(),
+        std::back_inserter( nodes ),
+        relocate );
+}
+
+/*  Parallel variant of _build_BVH_topDown.
+    Children of large ranges are built as independent tasks,
+    each into its own array, and spliced in order afterwards.
+*/
+template <typename Partitioning_policy, typename Face_iterator>
+void
+_build_BVH_topDown_parallel(
+        const Build_Context<Partitioning_policy,Face_iterator>& context,
+        const Face_iterator                                     mesh_face_data_begin,
+        const Face_iterator                                     mesh_face_data_end,
+        const std::size_t                                       depth,
+        const std::uint32_t                                     node_index,
+        std::vector<Compact_BVH_Node>&                          nodes )
+{
+    assert( nullptr != context.options.scheduler );
+
+    const auto number_of_faces = static_cast<std::size_t>( mesh_face_data_end - mesh_face_data_begin );
+
+    if ( number_of_faces < context.options.parallel_cutoff )
+    {
+        _build_BVH_topDown(
+            context,
+            mesh_face_data_begin,
+            mesh_face_data_end,
+            depth,
+            node_index,
+            nodes );
+        return;
+    }
+
+    const auto child_volume_ranges =
+        _make_node(
+            context,
+            mesh_face_data_begin,
+            mesh_face_data_end,
+            depth,
+            nodes[node_index] );
+
+    if ( child_volume_ranges.empty() )
+    {
+        return;
+    }
+
+    std::vector<std::vector<Compact_BVH_Node>> subtrees( child_volume_ranges.size() );
+    {
+        Task_Scheduler::Task_Group group( *context.options.scheduler );
+
+        for( std::size_t child=0u; child<child_volume_ranges.size(); ++child )
+        {
+            group.spawn(
+                [&context,&child_volume_ranges,&subtrees,depth,child]
+                ()
+                {
+                    subtrees[child].resize( 1u );
+
+                    _build_BVH_topDown_parallel(
+                        context,
+                        std::get<0>( child_volume_ranges[child] ),
+                        std::get<1>( child_volume_ranges[child] ),
+                        depth + 1u,
+                        0u,
+                        subtrees[child] );
+                } );
+        }
+
+        group.wait();
+    }
+
+    _reserve_children( nodes, node_index, child_volume_ranges.size() );
+
+    std::uint32_t child_index = nodes[node_index].first_child;
+    for( const auto& subtree : subtrees )
+    {
+        _append_subtree( nodes, child_index++, subtree );
+    }
+}
+
+/*  Recompute bounds of all nodes bottom-up.
+    get_face_bbox returns bounds of the face at a given index of the mesh.
+*/
+template <typename Get_face_bbox>
+void
+_refit_nodes(
+        const std::vector<std::uint32_t>&   face_order,
+        std::vector<Compact_BVH_Node>&      nodes,
+        Node_Bounds_SoA&                    node_bounds,
+        Node_Bounds_SoA&                    face_bounds,
+        Get_face_bbox                       get_face_bbox )
+{
+    const bool has_face_bounds = !face_bounds.min[0u].empty();
+
+    // children follow their parent, so in reverse order
+    // every node is reached after all of its children
+    for( auto n=static_cast<std::uint32_t>( nodes.size() ); n-->0u; )
+    {
+        auto& node = nodes[n];
+
+        if ( is_leaf( node ) )
+        {
+            auto bbox = make_empty_bbox();
+
+            for( auto f=node.first_face; f<node.first_face+node.face_count; ++f )
+            {
+                const auto face_bbox = get_face_bbox( face_order[f] );
+
+                if ( has_face_bounds )
+                {
+                    const auto rounded = make_node_bbox( face_bbox );
+
+                    for_each_coordinate(
+                        [&face_bounds, f, &rounded]
+                        ( const unsigned int coord )
+                        {
+                            face_bounds.min[coord][f] = rounded.min[coord];
+                            face_bounds.max[coord][f] = rounded.max[coord];
+                        } );
+                }
+
+                bbox = merge_bboxes( bbox, face_bbox );
+            }
+
+            node.bbox = make_node_bbox( bbox );
+        } else {
+            assert( node.first_child > n );
+
+            auto bbox = nodes[node.first_child].bbox;
+
+            for( auto c=node.first_child+1u; c<node.first_child+node.child_count; ++c )
+            {
+                bbox = merge_bboxes( bbox, nodes[c].bbox );
+            }
+
+            node.bbox = bbox;
+        }
+
+        for_each_coordinate(
+            [&node_bounds, n, &node]
+            ( const unsigned int coord )
+            {
+                node_bounds.min[coord][n] = node.bbox.min[coord];
+                node_bounds.max[coord][n] = node.bbox.max[coord];
+            } );
+    }
+}
+
+/*  Number of chunks the range of count elements is processed in,
+    one per options.parallel_cutoff elements when building in parallel.
+*/
+std::size_t
+_get_number_of_chunks(
+        const BVH_Build_Options&    options,
+        const std::size_t           count )
+{
+    if ( (nullptr == options.scheduler) || (count < options.parallel_cutoff) )
+    {
+        return 1u;
+    }
+
+    const auto chunk_size = std::max<std::size_t>( options.parallel_cutoff, 1u );
+
+    return (count + chunk_size - 1u) / chunk_size;
+}
+
+/*  Call body( chunk, begin, end ) for every chunk of [0, count),
+    as tasks on options.scheduler if there is more than one.
+*/
+template <typename Body>
+void
+_for_each_chunk(
+        const BVH_Build_Options&    options,
+        const std::size_t           number_of_chunks,
+        const std::size_t           count,
+        const Body&                 body )
+{
+    if ( 1u == number_of_chunks )
+    {
+        body( std::size_t( 0u ), std::size_t( 0u ), count );
+        return;
+    }
+
+    Task_Scheduler::Task_Group group( *options.scheduler );
+
+    for( std::size_t chunk=0u; chunk<number_of_chunks; ++chunk )
+    {
+        group.spawn(
+            [&body, chunk, number_of_chunks, count]
+            ()
+            {
+                body(
+                    chunk,
+                    count * chunk / number_of_chunks,
+                    count * (chunk + 1u) / number_of_chunks );
+            } );
+    }
+
+    group.wait();
+}
+
+/*  Cells per axis of the grid centroids are quantized to, 21 bits each fill a 63 bit code. */
+constexpr std::uint32_t morton_cells_per_axis = 1u << 21u;
+
+/*  Spread the low 21 bits of v to every third bit. */
+std::uint64_t
+_spread_bits(
+        std::uint64_t v )
+{
+    v &= 0x1fffffu;
+    v = (v | (v << 32u)) & 0x1f00000000ffffu;
+    v = (v | (v << 16u)) & 0x1f0000ff0000ffu;
+    v = (v | (v <<  8u)) & 0x100f00f00f00f00fu;
+    v = (v | (v <<  4u)) & 0x10c30c30c30c30c3u;
+    v = (v | (v <<  2u)) & 0x1249249249249249u;
+
+    return v;
+}
+
+/*  Quantizes points within given bounds to a grid of 2^21 cells per axis
+    and interleaves the cell coordinates into a 63 bit Morton code.
+*/
+struct
+Morton_Encoder
+{
+    Point   origin;
+    Point   scale;
+
+    std::uint64_t
+    operator()(
+            const Point& p ) const
+    {
+        std::uint64_t code = 0u;
+
+        for_each_coordinate(
+            [this, &p, &code]
+            ( const unsigned int coord )
+            {
+                const auto cell =
+                    std::min(
+                        (p.data[coord] - origin.data[coord]) * scale.data[coord],
+                        float_t( morton_cells_per_axis - 1u ) );
+
+                code |= _spread_bits( static_cast<std::uint64_t>( std::max( cell, float_t( 0 ) ) ) ) << (2u - coord);
+            } );
+
+        return code;
+    }
+};
+
+Morton_Encoder
+make_morton_encoder(
+        const BBox& bounds )
+{
+    Morton_Encoder encoder;
+    encoder.origin = bounds.min;
+
+    for_each_coordinate(
+        [&encoder, &bounds]
+        ( const unsigned int coord )
+        {
+            const auto extent = bounds.max.data[coord] - bounds.min.data[coord];
+
+            // all centroids in a plane map to cell 0 along its normal
+            encoder.scale.data[coord] = (0 < extent) ? float_t( morton_cells_per_axis - 1u ) / extent : 0;
+        } );
+
+    return encoder;
+}
+
+/*  Stable LSD radix sort of faces by their codes, a byte per pass.
+    Passes over a byte all codes share are skipped. Every pass counts
+    digits per chunk, then each chunk scatters to its own offsets.
+*/
+void
+_sort_by_code(
+        const BVH_Build_Options&        options,
+        std::vector<std::uint64_t>&     codes,
+        std::vector<std::uint32_t>&     faces )
+{
+    assert( codes.size() == faces.size() );
+
+    const auto count = codes.size();
+    const auto number_of_chunks = _get_number_of_chunks( options, count );
+
+    std::vector<std::uint64_t> sorted_codes( count );
+    std::vector<std::uint32_t> sorted_faces( count );
+    std::vector<std::array<std::size_t,256u>> offsets( number_of_chunks );
+
+    for( unsigned int shift=0u; shift<64u; shift+=8u )
+    {
+        _for_each_chunk(
+            options,
+            number_of_chunks,
+            count,
+            [&offsets, &codes, shift]
+            ( const std::size_t chunk, const std::size_t begin, const std::size_t end )
+            {
+                auto& histogram = offsets[chunk];
+                histogram.fill( 0u );
+
+                for( auto i=begin; i<end; ++i )
+                {
+                    ++histogram[(codes[i] >> shift) & 0xffu];
+                }
+            } );
+
+        // digits major, chunks minor, keeps equal digits in order
+        std::size_t total = 0u;
+        bool is_constant = false;
+
+        for( unsigned int digit=0u; digit<256u; ++digit )
+        {
+            const auto digit_first = total;
+
+            for( auto& histogram : offsets )
+            {
+                const auto digit_count = histogram[digit];
+                histogram[digit] = total;
+                total += digit_count;
+            }
+
+            is_constant |= (total - digit_first == count);
+        }
+
+        if ( is_constant )
+        {
+            continue;
+        }
+
+        _for_each_chunk(
+            options,
+            number_of_chunks,
+            count,
+            [&offsets, &codes, &faces, &sorted_codes, &sorted_faces, shift]
+            ( const std::size_t chunk, const std::size_t begin, const std::size_t end )
+            {
+                auto& offset = offsets[chunk];
+
+                for( auto i=begin; i<end; ++i )
+                {
+                    const auto slot = offset[(codes[i] >> shift) & 0xffu]++;
+
+                    sorted_codes[slot] = codes[i];
+                    sorted_faces[slot] = faces[i];
+                }
+            } );
+
+        codes.swap( sorted_codes );
+        faces.swap( sorted_faces );
     }
+}
 
+/*  Codes and bounds of sorted faces, shared by all recursion levels
+    of one linear build.
+*/
+struct
+Linear_Build_Context
+{
+    const std::vector<std::uint64_t>&   codes;
+    const std::vector<Node_BBox>&       sorted_bboxes;
+    BVH_Build_Options                   options;
+};
+
+/*  First face of the second child of a range of sorted faces.
+    Codes of the range share all bits above the highest one first and
+    last code differ in, so the split is where that bit becomes set.
+    Ranges of equal codes are halved.
+*/
+std::uint32_t
+_find_linear_split(
+        const std::vector<std::uint64_t>&   codes,
+        const std::uint32_t                 begin,
+        const std::uint32_t                 end )
+{
+    assert( begin + 1u < end );
+
+    const auto difference = codes[begin] ^ codes[end - 1u];
+
+    if ( 0u == difference )
+    {
+        return begin + (end - begin) / 2u;
+    }
+
+    const auto bit = std::uint64_t( 1u ) << highest_set_bit( difference );
+
+    const auto split =
+        std::partition_point(
+            codes.begin() + begin,
+            codes.begin() + end,
+            [bit]
+            ( const std::uint64_t code )
+            {
+                return 0u == (code & bit);
+            } );
+
+    return static_cast<std::uint32_t>( split - codes.begin() );
+}
+
+/*  Node at node_index for sorted faces [begin, end), depth levels below
+    the root. Its bounds are merged bottom-up as the recursion returns.
+    Same layout as _build_BVH_topDown.
+*/
+void
+_build_BVH_linear(
+        const Linear_Build_Context&     context,
+        const std::uint32_t             begin,
+        const std::uint32_t             end,
+        const std::size_t               depth,
+        const std::uint32_t             node_index,
+        std::vector<Compact_BVH_Node>&  nodes )
+{
+    assert( node_index < nodes.size() );
+    assert( begin < end );
+
+    nodes[node_index].first_child   = 0u;
+    nodes[node_index].child_count   = 0u;
+    nodes[node_index].first_face    = begin;
+    nodes[node_index].face_count    = end - begin;
+
+    if ( (end - begin <= context.options.max_leaf_size) || (depth >= context.options.max_depth) )
+    {
+        auto bbox = context.sorted_bboxes[begin];
+
+        for( auto f=begin+1u; f<end; ++f )
+        {
+            bbox = merge_bboxes( bbox, context.sorted_bboxes[f] );
+        }
+
+        nodes[node_index].bbox = bbox;
+        return;
+    }
+
+    const auto split = _find_linear_split( context.codes, begin, end );
+
+    _reserve_children( nodes, node_index, 2u );
+
+    const auto first_child = nodes[node_index].first_child;
+
+    _build_BVH_linear( context, begin, split, depth + 1u, first_child, nodes );
+    _build_BVH_linear( context, split, end, depth + 1u, first_child + 1u, nodes );
+
+    nodes[node_index].bbox = merge_bboxes( nodes[first_child].bbox, nodes[first_child + 1u].bbox );
+}
+
+/*  Parallel variant of _build_BVH_linear, see _build_BVH_topDown_parallel.
+*/
+void
+_build_BVH_linear_parallel(
+        const Linear_Build_Context&     context,
+        const std::uint32_t             begin,
+        const std::uint32_t             end,
+        const std::size_t               depth,
+        const std::uint32_t             node_index,
+        std::vector<Compact_BVH_Node>&  nodes )
+{
+    assert( nullptr != context.options.scheduler );
+
+    if (   (end - begin < context.options.parallel_cutoff)
+        || (end - begin <= context.options.max_leaf_size)
+        || (depth >= context.options.max_depth) )
+    {
+        _build_BVH_linear( context, begin, end, depth, node_index, nodes );
+        return;
+    }
+
+    const std::uint32_t child_ranges[3u] = { begin, _find_linear_split( context.codes, begin, end ), end };
+
+    std::vector<Compact_BVH_Node> subtrees[2u];
+    {
+        Task_Scheduler::Task_Group group( *context.options.scheduler );
+
+        for( unsigned int child=0u; child<2u; ++child )
+        {
+            group.spawn(
+                [&context,&child_ranges,&subtrees,depth,child]
+                ()
+                {
+                    subtrees[child].resize( 1u );
+
+                    _build_BVH_linear_parallel(
+                        context,
+                        child_ranges[child],
+                        child_ranges[child + 1u],
+                        depth + 1u,
+                        0u,
+                        subtrees[child] );
+                } );
+        }
+
+        group.wait();
+    }
+
+    nodes[node_index].first_face    = begin;
+    nodes[node_index].face_count    = end - begin;
+
+    _reserve_children( nodes, node_index, 2u );
+
+    const auto first_child = nodes[node_index].first_child;
+
+    _append_subtree( nodes, first_child, subtrees[0u] );
+    _append_subtree( nodes, first_child + 1u, subtrees[1u] );
+
+    nodes[node_index].bbox = merge_bboxes( nodes[first_child].bbox, nodes[first_child + 1u].bbox );
+}
+
+/*  Whether a leaf holds more than one face, from max_leaf_size or the
+    depth limit, and so needs bounds of its faces.
+*/
+bool
+_has_multi_face_leaf(
+        const std::vector<Compact_BVH_Node>& nodes )
+{
     return
-        BVH_Node::make_BVH_Node(
-            std::move( ret ),
-            bbox );
+        std::any_of(
+            nodes.begin(),
+            nodes.end(),
+            []
+            ( const Compact_BVH_Node& node )
+            {
+                return is_leaf( node ) && (1u < node.face_count);
+            } );
+}
+
+#if defined(CODET_ENABLE_STATISTICS)
+/*  Shape of a finished tree, and times taken if the build had timers.
+*/
+Build_Statistics
+_make_build_statistics(
+        const std::vector<Compact_BVH_Node>&    nodes,
+        const Build_Timers*                     timers )
+{
+    Build_Statistics statistics;
+    statistics.number_of_nodes = static_cast<std::uint32_t>( nodes.size() );
+
+    // children follow their parent, so levels are known before children are reached
+    std::vector<std::uint32_t> levels( nodes.size(), 1u );
+
+    for( std::uint32_t n=0u; n<nodes.size(); ++n )
+    {
+        const auto& node = nodes[n];
+
+        statistics.depth = std::max( statistics.depth, levels[n] );
+
+        if ( is_leaf( node ) )
+        {
+            if ( statistics.leaf_size_histogram.size() <= node.face_count )
+            {
+                statistics.leaf_size_histogram.resize( node.face_count + 1u, 0u );
+            }
+
+            ++statistics.leaf_size_histogram[node.face_count];
+            ++statistics.number_of_leaves;
+            continue;
+        }
+
+        for( auto c=node.first_child; c<node.first_child+node.child_count; ++c )
+        {
+            levels[c] = levels[n] + 1u;
+        }
+    }
+
+    if ( nullptr != timers )
+    {
+        statistics.find_bounds_seconds  = 1e-9 * static_cast<double>( timers->find_bounds_nanoseconds.load() );
+        statistics.partitioning_seconds = 1e-9 * static_cast<double>( timers->partitioning_nanoseconds.load() );
+    }
+
+    return statistics;
+}
+#endif
+
+/*  Nodes of a top-down BVH over faces [begin, end),
+    which are left sorted in face order.
+*/
+template <typename Partitioning_policy, typename Face_iterator>
+std::vector<Compact_BVH_Node>
+_make_topDown_nodes(
+        const Face_iterator         mesh_face_data_begin,
+        const Face_iterator         mesh_face_data_end,
+        Partitioning_policy         partitioning_policy,
+        const BVH_Build_Options&    options )
+{
+    assert( mesh_face_data_begin < mesh_face_data_end );
+    assert( 0u != options.max_leaf_size );
+    assert( 0u != options.max_depth );
+
+    Build_Timers timers;
+
+    const Build_Context<Partitioning_policy,Face_iterator> context{
+        mesh_face_data_begin,
+        partitioning_policy,
+        options,
+        &timers };
+
+    // every interior node has at least two children
+    std::vector<Compact_BVH_Node> nodes;
+    nodes.reserve( 2u * static_cast<std::size_t>( mesh_face_data_end - mesh_face_data_begin ) - 1u );
+    nodes.resize( 1u );
+
+    if ( nullptr != options.scheduler )
+    {
+        _build_BVH_topDown_parallel(
+            context,
+            mesh_face_data_begin,
+            mesh_face_data_end,
+            1u,
+            0u,
+            nodes );
+    } else {
+        _build_BVH_topDown(
+            context,
+            mesh_face_data_begin,
+            mesh_face_data_end,
+            1u,
+            0u,
+            nodes );
+    }
+
+    CODET_STATISTICS( detail::get_thread_build_statistics() = _make_build_statistics( nodes, &timers ) );
+
+    return nodes;
+}
+
+/*  Arrays of a linear BVH over number_of_faces faces.
+    get_face_bbox returns bounds of the face at a given index of the mesh.
+*/
+struct
+Linear_BVH_Arrays
+{
+    std::vector<Compact_BVH_Node>   nodes;
+    std::vector<std::uint32_t>      face_order;
+    Node_Bounds_SoA                 face_bounds;
+};
+
+template <typename Get_face_bbox>
+Linear_BVH_Arrays
+_make_linear_BVH_arrays(
+        const std::size_t           number_of_faces,
+        const Get_face_bbox&        get_face_bbox,
+        const BVH_Build_Options&    options )
+{
+    assert( 0u != number_of_faces );
+    assert( 0u != options.max_leaf_size );
+    assert( 0u != options.max_depth );
+    assert( number_of_faces <= std::numeric_limits<std::uint32_t>::max() );
+
+    const auto number_of_chunks = _get_number_of_chunks( options, number_of_faces );
+
+    // face bounds, and bounds of face centroids per chunk
+    std::vector<BBox> face_bboxes( number_of_faces );
+    std::vector<BBox> centroid_bounds( number_of_chunks, make_empty_bbox() );
+
+    _for_each_chunk(
+        options,
+        number_of_chunks,
+        number_of_faces,
+        [&face_bboxes, &centroid_bounds, &get_face_bbox]
+        ( const std::size_t chunk, const std::size_t begin, const std::size_t end )
+        {
+            for( auto f=begin; f<end; ++f )
+            {
+                face_bboxes[f] = get_face_bbox( static_cast<std::uint32_t>( f ) );
+
+                expand_bbox( centroid_bounds[chunk], (face_bboxes[f].min + face_bboxes[f].max) * float_t( 0.5 ) );
+            }
+        } );
+
+    const auto encoder =
+        make_morton_encoder(
+            std::accumulate(
+                centroid_bounds.begin() + 1u,
+                centroid_bounds.end(),
+                centroid_bounds[0u],
+                []
+                ( const BBox& l, const BBox& r )
+                {
+                    return merge_bboxes( l, r );
+                } ) );
+
+    std::vector<std::uint64_t> codes( number_of_faces );
+    std::vector<std::uint32_t> face_order( number_of_faces );
+
+    _for_each_chunk(
+        options,
+        number_of_chunks,
+        number_of_faces,
+        [&codes, &face_order, &face_bboxes, &encoder]
+        ( const std::size_t, const std::size_t begin, const std::size_t end )
+        {
+            for( auto f=begin; f<end; ++f )
+            {
+                codes[f]        = encoder( (face_bboxes[f].min + face_bboxes[f].max) * float_t( 0.5 ) );
+                face_order[f]   = static_cast<std::uint32_t>( f );
+            }
+        } );
+
+    _sort_by_code( options, codes, face_order );
+
+    // gathered once, so that the recursion reads bounds of leaves in order.
+    // Rounding outwards is monotonic, merging rounded bounds is exact.
+    std::vector<Node_BBox> sorted_bboxes( number_of_faces );
+
+    _for_each_chunk(
+        options,
+        number_of_chunks,
+        number_of_faces,
+        [&sorted_bboxes, &face_bboxes, &face_order]
+        ( const std::size_t, const std::size_t begin, const std::size_t end )
+        {
+            for( auto f=begin; f<end; ++f )
+            {
+                sorted_bboxes[f] = make_node_bbox( face_bboxes[face_order[f]] );
+            }
+        } );
+
+    face_bboxes = std::vector<BBox>();
+
+    const Linear_Build_Context context{
+        codes,
+        sorted_bboxes,
+        options };
+
+    // binary, so 2n - 1 nodes at most
+    Linear_BVH_Arrays ret;
+    ret.nodes.reserve( 2u * number_of_faces - 1u );
+    ret.nodes.resize( 1u );
+
+    const auto end = static_cast<std::uint32_t>( number_of_faces );
+
+    if ( nullptr != options.scheduler )
+    {
+        _build_BVH_linear_parallel( context, 0u, end, 1u, 0u, ret.nodes );
+    } else {
+        _build_BVH_linear( context, 0u, end, 1u, 0u, ret.nodes );
+    }
+
+    // single face leaves are bounded by the leaf itself
+    if ( _has_multi_face_leaf( ret.nodes ) )
+    {
+        ret.face_bounds =
+            make_bounds_soa(
+                sorted_bboxes.size(),
+                [&sorted_bboxes]
+                ( const std::size_t f )
+                {
+                    return sorted_bboxes[f];
+                } );
+    }
+
+    ret.face_order = std::move( face_order );
+
+    CODET_STATISTICS( detail::get_thread_build_statistics() = _make_build_statistics( ret.nodes, nullptr ) );
+
+    return ret;
 }
 
 }
@@ -102,16 +991,377 @@ BoundingVolumeHierarchy::make_BVH_topDown(
         const std::vector<Mesh_Face>&   mesh_face_data,
         Partitioning_policy             partitioning_policy )
 {
+    return
+        make_BVH_topDown<Partitioning_policy>(
+            mesh_face_data,
+            partitioning_policy,
+            BVH_Build_Options() );
+}
+
+template <typename Partitioning_policy>
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown(
+        const std::vector<Mesh_Face>&   mesh_face_data,
+        Partitioning_policy             partitioning_policy,
+        const BVH_Build_Options&        options )
+{
+    assert( !mesh_face_data.empty() );
+
     std::vector<const Mesh_Face*> mesh_face_data_sortable
         = generate_vector_of_pointers_to_elements(
             mesh_face_data );
 
+    auto nodes =
+        _make_topDown_nodes(
+            mesh_face_data_sortable.begin(),
+            mesh_face_data_sortable.end(),
+            partitioning_policy,
+            options );
+
+    std::vector<std::uint32_t> face_order( mesh_face_data_sortable.size() );
+    std::transform(
+        mesh_face_data_sortable.begin(),
+        mesh_face_data_sortable.end(),
+        face_order.begin(),
+        [&mesh_face_data]
+        ( const Mesh_Face* face )
+        {
+            return static_cast<std::uint32_t>( face - mesh_face_data.data() );
+        } );
+
+    // single face leaves are bounded by the leaf itself
+    Node_Bounds_SoA face_bounds;
+    if ( _has_multi_face_leaf( nodes ) )
+    {
+        face_bounds =
+            make_bounds_soa(
+                face_order.size(),
+                [&mesh_face_data, &face_order]
+                ( const std::size_t f )
+                {
+                    auto bbox = make_empty_bbox();
+
+                    for( const auto& vert : mesh_face_data[face_order[f]].vertices )
+                    {
+                        expand_bbox( bbox, vert );
+                    }
+
+                    return make_node_bbox( bbox );
+                } );
+    }
+
+    return
+        BoundingVolumeHierarchy(
+            std::move( nodes ),
+            std::move( face_order ),
+            std::move( face_bounds ),
+            mesh_face_data.data() );
+}
+
+template <typename Partitioning_policy>
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown(
+        const Indexed_Mesh&             mesh,
+        Partitioning_policy             partitioning_policy )
+{
+    return
+        make_BVH_topDown<Partitioning_policy>(
+            mesh,
+            partitioning_policy,
+            BVH_Build_Options() );
+}
+
+template <typename Partitioning_policy>
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown(
+        const Indexed_Mesh&             mesh,
+        Partitioning_policy             partitioning_policy,
+        const BVH_Build_Options&        options )
+{
+    assert( !mesh.empty() );
+
+    // partitioning sorts face indices with their centroids,
+    // vertices are read through the view when bounds are needed
+    std::vector<Indexed_Build_Face> build_faces( mesh.size() );
+    for( std::uint32_t f=0u; f<build_faces.size(); ++f )
+    {
+        build_faces[f] = make_indexed_build_face( mesh, f );
+    }
+
+    auto nodes =
+        _make_topDown_nodes(
+            build_faces.begin(),
+            build_faces.end(),
+            partitioning_policy,
+            options );
+
+    std::vector<std::uint32_t> face_order( build_faces.size() );
+    std::transform(
+        build_faces.begin(),
+        build_faces.end(),
+        face_order.begin(),
+        []
+        ( const Indexed_Build_Face& face )
+        {
+            return face.index;
+        } );
+
+    // single face leaves are bounded by the leaf itself
+    Node_Bounds_SoA face_bounds;
+    if ( _has_multi_face_leaf( nodes ) )
+    {
+        face_bounds =
+            make_bounds_soa(
+                build_faces.size(),
+                [&build_faces]
+                ( const std::size_t f )
+                {
+                    return make_node_bbox( get_face_bbox( build_faces[f] ) );
+                } );
+    }
+
+    auto bvh =
+        BoundingVolumeHierarchy(
+            std::move( nodes ),
+            std::move( face_order ),
+            std::move( face_bounds ),
+            nullptr );
+
+    bvh.indexed_mesh = mesh;
+
+    return bvh;
+}
+
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_linear(
+        const std::vector<Mesh_Face>&   mesh_face_data )
+{
     return
+        make_BVH_linear(
+            mesh_face_data,
+            BVH_Build_Options() );
+}
+
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_linear(
+        const std::vector<Mesh_Face>&   mesh_face_data,
+        const BVH_Build_Options&        options )
+{
+    assert( !mesh_face_data.empty() );
+
+    auto arrays =
+        _make_linear_BVH_arrays(
+            mesh_face_data.size(),
+            [&mesh_face_data]
+            ( const std::uint32_t face_index )
+            {
+                return get_face_bbox( mesh_face_data[face_index] );
+            },
+            options );
+
+    return
+        BoundingVolumeHierarchy(
+            std::move( arrays.nodes ),
+            std::move( arrays.face_order ),
+            std::move( arrays.face_bounds ),
+            mesh_face_data.data() );
+}
+
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_linear(
+        const Indexed_Mesh&             mesh )
+{
+    return
+        make_BVH_linear(
+            mesh,
+            BVH_Build_Options() );
+}
+
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_linear(
+        const Indexed_Mesh&             mesh,
+        const BVH_Build_Options&        options )
+{
+    assert( !mesh.empty() );
+
+    // faces are never sorted themselves, no need to assemble them
+    auto arrays =
+        _make_linear_BVH_arrays(
+            mesh.size(),
+            [&mesh]
+            ( const std::uint32_t face_index )
+            {
+                return get_face_bbox( mesh.get_face( face_index ) );
+            },
+            options );
+
+    auto bvh =
         BoundingVolumeHierarchy(
-            _build_BVH_topDown<Partitioning_policy>(
-                mesh_face_data_sortable.begin(),
-                mesh_face_data_sortable.end(),
-                partitioning_policy ) );
+            std::move( arrays.nodes ),
+            std::move( arrays.face_order ),
+            std::move( arrays.face_bounds ),
+            nullptr );
+
+    bvh.indexed_mesh = mesh;
+
+    return bvh;
+}
+
+bool
+BoundingVolumeHierarchy::refit(
+        const std::vector<Mesh_Face>& mesh_face_data )
+{
+    if ( is_mapped | (mesh_face_data.size() != face_order.size()) )
+    {
+        return false;
+    }
+
+    mesh_faces      = mesh_face_data.data();
+    indexed_mesh    = Indexed_Mesh();
+
+    _refit_nodes(
+        owned_face_order,
+        owned_nodes,
+        owned_node_bounds,
+        owned_face_bounds,
+        [this]
+        ( const std::uint32_t face_index )
+        {
+            return get_face_bbox( mesh_faces[face_index] );
+        } );
+
+    return true;
+}
+
+bool
+BoundingVolumeHierarchy::refit(
+        const Indexed_Mesh& mesh )
+{
+    if ( is_mapped | (mesh.size() != face_order.size()) )
+    {
+        return false;
+    }
+
+    mesh_faces      = nullptr;
+    indexed_mesh    = mesh;
+
+    _refit_nodes(
+        owned_face_order,
+        owned_nodes,
+        owned_node_bounds,
+        owned_face_bounds,
+        [&mesh]
+        ( const std::uint32_t face_index )
+        {
+            return get_face_bbox( mesh.get_face( face_index ) );
+        } );
+
+    return true;
+}
+
+bool
+BoundingVolumeHierarchy::refit_swept(
+        const std::vector<Mesh_Face>& start_faces,
+        const std::vector<Mesh_Face>& end_faces )
+{
+    if (   is_mapped
+        || (start_faces.size() != face_order.size())
+        || (end_faces.size() != face_order.size()) )
+    {
+        return false;
+    }
+
+    mesh_faces      = start_faces.data();
+    indexed_mesh    = Indexed_Mesh();
+
+    _refit_nodes(
+        owned_face_order,
+        owned_nodes,
+        owned_node_bounds,
+        owned_face_bounds,
+        [&start_faces, &end_faces]
+        ( const std::uint32_t face_index )
+        {
+            return
+                merge_bboxes(
+                    get_face_bbox( start_faces[face_index] ),
+                    get_face_bbox( end_faces[face_index] ) );
+        } );
+
+    return true;
+}
+
+bool
+BoundingVolumeHierarchy::refit_swept(
+        const Indexed_Mesh& start_mesh,
+        const Indexed_Mesh& end_mesh )
+{
+    if (   is_mapped
+        || (start_mesh.size() != face_order.size())
+        || (end_mesh.size() != face_order.size()) )
+    {
+        return false;
+    }
+
+    mesh_faces      = nullptr;
+    indexed_mesh    = start_mesh;
+
+    _refit_nodes(
+        owned_face_order,
+        owned_nodes,
+        owned_node_bounds,
+        owned_face_bounds,
+        [&start_mesh, &end_mesh]
+        ( const std::uint32_t face_index )
+        {
+            return
+                merge_bboxes(
+                    get_face_bbox( start_mesh.get_face( face_index ) ),
+                    get_face_bbox( end_mesh.get_face( face_index ) ) );
+        } );
+
+    return true;
+}
+
+std::uint64_t
+BoundingVolumeHierarchy::make_build_generation()
+{
+    static std::atomic<std::uint64_t> last_generation( 0u );
+
+    return ++last_generation;
+}
+
+float_t
+BoundingVolumeHierarchy::get_sah_cost() const
+{
+    const auto root_area = surface_area( to_bbox( nodes[0u].bbox ) );
+
+    if ( 0 == root_area )
+    {
+        return 0;
+    }
+
+    float_t cost = 0;
+
+    for( const auto& node : nodes )
+    {
+        const float_t weight = is_leaf( node ) ? float_t( node.face_count ) : float_t( 1 );
+
+        cost += weight * surface_area( to_bbox( node.bbox ) );
+    }
+
+    return cost / root_area;
+}
+
+float_t
+BoundingVolumeHierarchy::get_sah_cost_growth() const
+{
+    if ( 0 == built_sah_cost )
+    {
+        return 1;
+    }
+
+    return get_sah_cost() / built_sah_cost;
 }
 
 //    explicit template instantiation
@@ -121,3 +1371,48 @@ BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
         const std::vector<Mesh_Face>&,
         decltype(Naive_Oct_Split) );
 
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+        const std::vector<Mesh_Face>&,
+        decltype(Naive_Oct_Split),
+        const BVH_Build_Options& );
+
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+        const std::vector<Mesh_Face>&,
+        Binned_SAH_Split );
+
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+        const std::vector<Mesh_Face>&,
+        Binned_SAH_Split,
+        const BVH_Build_Options& );
+
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+        const Indexed_Mesh&,
+        decltype(Naive_Oct_Split) );
+
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+        const Indexed_Mesh&,
+        decltype(Naive_Oct_Split),
+        const BVH_Build_Options& );
+
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+        const Indexed_Mesh&,
+        Binned_SAH_Split );
+
+template
+BoundingVolumeHierarchy
+BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+        const Indexed_Mesh&,
+        Binned_SAH_Split,
+        const BVH_Build_Options& );
@@ -1,6 +1,14 @@
 #pragma once
 
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
 #include "BVH_Node.h"
+#include "Compact_BVH_Node.h"
+#include "Node_Bounds_SoA.h"
+#include "BVH_Build_Options.h"
+#include "Indexed_Mesh.h"
 
 namespace CoDet {
 
@@ -10,25 +18,271 @@ struct Mesh_Face;
 *
 *   Entry point to the bounding volume
 *   hierarchy.
+*
+*   Nodes are stored flattened in a single array, root first.
+*   Their bounds are mirrored in SoA layout for the SIMD overlap tests.
+*   Leaves reference faces through the face order, a permutation
+*   of indices into the mesh face data the BVH was built from.
+*   Mesh face data is referenced, not copied, and has to outlive the BVH.
+*   It is either a vector of Mesh_Face or an Indexed_Mesh view of shared
+*   vertex and index buffers.
+*
+*   Children are stored after their parent, which lets refit update
+*   all bounds in one pass over the node array in reverse.
+*
+*   Arrays are owned by a built BVH, or read in place from an image
+*   of one, see BVH_Image.h.
+*
+*   Leaves hold up to BVH_Build_Options::max_leaf_size faces, contiguous
+*   in the face order, or more at BVH_Build_Options::max_depth.
+*   If any leaf holds more than one, bounds of every
+*   face are kept as well, in face order, for brute force leaf tests.
 */
 class BoundingVolumeHierarchy final
 {
 private:
-    BVH_Node    root;
+    // arrays of a built BVH, empty for a BVH mapped onto an image
+    std::vector<Compact_BVH_Node>   owned_nodes;
+    Node_Bounds_SoA                 owned_node_bounds;
+    std::vector<std::uint32_t>      owned_face_order;
+    Node_Bounds_SoA                 owned_face_bounds;
+
+    // arrays queries read, refer to the owned ones or into an image
+    Array_View<Compact_BVH_Node>    nodes;
+    Node_Bounds_View                node_bounds;
+    Array_View<std::uint32_t>       face_order;
+    Node_Bounds_View                face_bounds;    // empty if all leaves hold one face
+
+    const Mesh_Face*                mesh_faces;     // null if built from an Indexed_Mesh
+    Indexed_Mesh                    indexed_mesh;
+    float_t                         built_sah_cost;
+    std::uint64_t                   build_generation;   // unique to every build, kept by copies and refits
+    bool                            is_mapped;
 
 public:
-    const BVH_Node&
+    BVH_Node
     get_root() const
     {
-        return root;
+        return
+            BVH_Node(
+                nodes.data(),
+                face_order.data(),
+                mesh_faces,
+                0u );
+    }
+public:
+    Array_View<Compact_BVH_Node>
+    get_nodes() const
+    {
+        return nodes;
+    }
+public:
+    const Node_Bounds_View&
+    get_node_bounds() const
+    {
+        return node_bounds;
+    }
+public:
+    /*  Bounds of faces, indexed like the face order.
+    *   Empty if every leaf holds a single face, its bounds are then
+    *   those of the leaf.
+    */
+    const Node_Bounds_View&
+    get_face_bounds() const
+    {
+        return face_bounds;
+    }
+public:
+    Array_View<std::uint32_t>
+    get_face_order() const
+    {
+        return face_order;
+    }
+public:
+    const Mesh_Face*
+    get_mesh_faces() const
+    {
+        return mesh_faces;
+    }
+public:
+    /*  View the BVH was built from, empty if built from Mesh_Face data. */
+    const Indexed_Mesh&
+    get_indexed_mesh() const
+    {
+        return indexed_mesh;
+    }
+public:
+    /*  Face at face_index of the mesh the BVH was built from. */
+    Mesh_Face
+    get_face(
+            const std::uint32_t face_index ) const
+    {
+        assert( face_index < face_order.size() );
+
+        if ( nullptr != mesh_faces )
+        {
+            return mesh_faces[face_index];
+        }
+
+        return indexed_mesh.get_face( face_index );
+    }
+public:
+    /*  Whether arrays are read from an image, see make_BVH_from_image. */
+    bool
+    is_mapped_image() const
+    {
+        return is_mapped;
+    }
+public:
+    /*  SAH cost right after build. */
+    float_t
+    get_built_sah_cost() const
+    {
+        return built_sah_cost;
+    }
+public:
+    /*  Identifies the build that made the topology of this BVH. Differs
+    *   between any two builds or mappings of an image in the process,
+    *   copies and refits keep it, so equal generations mean equal nodes
+    *   up to bounds.
+    */
+    std::uint64_t
+    get_build_generation() const
+    {
+        return build_generation;
     }
 
 private:
+    BoundingVolumeHierarchy()
+        :   mesh_faces          (nullptr)
+        ,   built_sah_cost      (0)
+        ,   build_generation    (make_build_generation())
+        ,   is_mapped           (false)
+    {}
+
     BoundingVolumeHierarchy(
-            const BVH_Node& root_node
+            std::vector<Compact_BVH_Node>&& nodes,
+            std::vector<std::uint32_t>&&    face_order,
+            Node_Bounds_SoA&&               face_bounds,
+            const Mesh_Face*                mesh_faces
     )
-        :   root    (root_node)
-    {}
+        :   owned_nodes         (std::move(nodes))
+        ,   owned_node_bounds   (make_node_bounds_soa(owned_nodes))
+        ,   owned_face_order    (std::move(face_order))
+        ,   owned_face_bounds   (std::move(face_bounds))
+        ,   mesh_faces          (mesh_faces)
+        ,   built_sah_cost      (0)
+        ,   build_generation    (make_build_generation())
+        ,   is_mapped           (false)
+    {
+        view_owned_arrays();
+        built_sah_cost = get_sah_cost();
+    }
+
+    static
+    std::uint64_t
+    make_build_generation();
+
+    void
+    view_owned_arrays()
+    {
+        nodes       = owned_nodes;
+        node_bounds = owned_node_bounds;
+        face_order  = owned_face_order;
+        face_bounds = owned_face_bounds;
+    }
+
+public:
+    // views of a copy refer to its own arrays, moves keep vector storage in place
+    BoundingVolumeHierarchy(
+            const BoundingVolumeHierarchy& other )
+        :   owned_nodes         (other.owned_nodes)
+        ,   owned_node_bounds   (other.owned_node_bounds)
+        ,   owned_face_order    (other.owned_face_order)
+        ,   owned_face_bounds   (other.owned_face_bounds)
+        ,   nodes               (other.nodes)
+        ,   node_bounds         (other.node_bounds)
+        ,   face_order          (other.face_order)
+        ,   face_bounds         (other.face_bounds)
+        ,   mesh_faces          (other.mesh_faces)
+        ,   indexed_mesh        (other.indexed_mesh)
+        ,   built_sah_cost      (other.built_sah_cost)
+        ,   build_generation    (other.build_generation)
+        ,   is_mapped           (other.is_mapped)
+    {
+        if ( !is_mapped )
+        {
+            view_owned_arrays();
+        }
+    }
+
+    BoundingVolumeHierarchy(
+            BoundingVolumeHierarchy&& other ) = default;
+
+    BoundingVolumeHierarchy&
+    operator=(
+            const BoundingVolumeHierarchy& other )
+    {
+        return *this = BoundingVolumeHierarchy( other );
+    }
+
+    BoundingVolumeHierarchy&
+    operator=(
+            BoundingVolumeHierarchy&& other ) = default;
+
+public:
+    /*  Recompute bounds of all nodes bottom-up from moved faces, O(n).
+    *   Topology is kept, mesh_face_data has to hold the same faces, in the
+    *   same order, as the data the BVH was built from. The BVH then
+    *   references mesh_face_data.
+    *   Returns false, leaving the BVH unchanged, for a BVH mapped onto an
+    *   image, whose arrays are read only, or face data of another size.
+    */
+    bool
+    refit(
+            const std::vector<Mesh_Face>& mesh_face_data );
+public:
+    /*  Same, for a BVH built from an Indexed_Mesh. Triangles have to be
+    *   the ones the BVH was built from, vertices may have moved or be
+    *   in a different buffer. The BVH then references mesh.
+    */
+    bool
+    refit(
+            const Indexed_Mesh& mesh );
+public:
+    /*  Recompute bounds over the motion of every face from its start to
+    *   its end positions, for continuous collision detection. Vertices
+    *   moving linearly stay within the bounds of both positions, so nodes
+    *   bound the volume their faces sweep and pruning two swept BVHs finds
+    *   every face pair that may collide during the step.
+    *   Both arrays hold the faces the BVH was built from, moved. The BVH
+    *   then references start_faces. Returns false like refit.
+    */
+    bool
+    refit_swept(
+            const std::vector<Mesh_Face>& start_faces,
+            const std::vector<Mesh_Face>& end_faces );
+public:
+    /*  Same, for a BVH built from an Indexed_Mesh. Both meshes share
+    *   its triangles. The BVH then references start_mesh.
+    */
+    bool
+    refit_swept(
+            const Indexed_Mesh& start_mesh,
+            const Indexed_Mesh& end_mesh );
+public:
+    /*  Surface area heuristic cost of the tree, relative to its root:
+    *   surface area of every interior node, plus that of every leaf times
+    *   its face count, over the surface area of the root.
+    */
+    float_t
+    get_sah_cost() const;
+public:
+    /*  SAH cost now over SAH cost right after build. Refit keeps topology,
+    *   so as faces move it grows. Past about 1.5 to 2 a rebuild pays off.
+    */
+    float_t
+    get_sah_cost_growth() const;
 
 public:
     template <typename Partitioning_policy>
@@ -37,7 +291,81 @@ public:
     make_BVH_topDown(
             const std::vector<Mesh_Face>&   mesh_face_data,
             Partitioning_policy             partitioning_policy );
+public:
+    template <typename Partitioning_policy>
+    static
+    BoundingVolumeHierarchy
+    make_BVH_topDown(
+            const std::vector<Mesh_Face>&   mesh_face_data,
+            Partitioning_policy             partitioning_policy,
+            const BVH_Build_Options&        options );
+public:
+    /*  Build from shared vertex and index buffers. Leaves reference faces
+    *   by their index in the view, face data is not kept.
+    */
+    template <typename Partitioning_policy>
+    static
+    BoundingVolumeHierarchy
+    make_BVH_topDown(
+            const Indexed_Mesh&             mesh,
+            Partitioning_policy             partitioning_policy );
+public:
+    template <typename Partitioning_policy>
+    static
+    BoundingVolumeHierarchy
+    make_BVH_topDown(
+            const Indexed_Mesh&             mesh,
+            Partitioning_policy             partitioning_policy,
+            const BVH_Build_Options&        options );
+public:
+    /*  Linear BVH: faces are sorted along a Morton curve through their
+    *   centroids and split where the codes start to differ, highest bit
+    *   first. Much faster to build than make_BVH_topDown, at the cost of
+    *   looser trees, so suited for rebuilding large meshes every frame.
+    *   Binary, options.max_leaf_size, options.max_depth and
+    *   options.scheduler apply as they do for make_BVH_topDown.
+    */
+    static
+    BoundingVolumeHierarchy
+    make_BVH_linear(
+            const std::vector<Mesh_Face>&   mesh_face_data );
+public:
+    static
+    BoundingVolumeHierarchy
+    make_BVH_linear(
+            const std::vector<Mesh_Face>&   mesh_face_data,
+            const BVH_Build_Options&        options );
+public:
+    static
+    BoundingVolumeHierarchy
+    make_BVH_linear(
+            const Indexed_Mesh&             mesh );
+public:
+    static
+    BoundingVolumeHierarchy
+    make_BVH_linear(
+            const Indexed_Mesh&             mesh,
+            const BVH_Build_Options&        options );
+public:
+    /*  BVH reading its arrays straight from an image made by
+    *   make_BVH_image, without copying them. The image, for example a
+    *   mapped file, and mesh_face_data have to outlive the BVH, and the
+    *   image has to pass check_BVH_image. mesh_face_data has to hold the
+    *   faces the imaged BVH was built from.
+    */
+    static
+    BoundingVolumeHierarchy
+    make_BVH_from_image(
+            const void*                     image,
+            const std::size_t               image_size,
+            const std::vector<Mesh_Face>&   mesh_face_data );
+public:
+    static
+    BoundingVolumeHierarchy
+    make_BVH_from_image(
+            const void*                     image,
+            const std::size_t               image_size,
+            const Indexed_Mesh&             mesh );
 };
 
 }
-
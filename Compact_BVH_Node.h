@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include "BBox.h"
+
+namespace CoDet {
+
+/*  Node record of the flattened BVH.
+*
+*   All nodes of a hierarchy live in one contiguous array.
+*   Children of a node occupy a contiguous block of that array,
+*   referenced by a 32-bit index, and every node references
+*   the contiguous range of faces it bounds.
+*   The record is 40 bytes with single precision bounds and 64 bytes
+*   with double bounds. It is not aligned, so a record may straddle
+*   two cache lines.
+*/
+struct
+Compact_BVH_Node
+{
+    Node_BBox       bbox;
+    std::uint32_t   first_child;    // index of the first child (unused for leaves)
+    std::uint32_t   child_count;    // 0 for leaves
+    std::uint32_t   first_face;     // index into the BVH face order
+    std::uint32_t   face_count;
+};
+
+static_assert( 6u*sizeof(bound_t) + 16u == sizeof(Compact_BVH_Node), "Compact_BVH_Node is expected to have no padding" );
+
+inline
+bool
+is_leaf(
+        const Compact_BVH_Node& node )
+{
+    return 0u == node.child_count;
+}
+
+}
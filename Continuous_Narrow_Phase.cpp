@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <cassert>
+#include "Continuous_Narrow_Phase.h"
+#include "Mesh_Face.h"
+
+using namespace CoDet;
+
+// implementation lives inside CoDet, so that float_t does not clash with the one from <cmath>
+namespace CoDet {
+namespace {
+
+/*  Relative tolerance of contact tests at a time of impact. Times are
+*   only known to rounding, so features are allowed to miss by a little.
+*/
+const float_t contact_tolerance = std::sqrt( std::numeric_limits<float_t>::epsilon() );
+
+/*  Rounding error of a coplanarity cubic relative to the size of its terms,
+*   covering the differences, cross and dot products and its evaluation.
+*/
+const float_t cubic_tolerance = 16 * std::numeric_limits<float_t>::epsilon();
+
+/*  Point moving linearly over the step. */
+struct
+Moving_Point
+{
+    Point   start;
+    Point   motion;     // end - start
+};
+
+Moving_Point
+make_moving_point(
+        const Point& start,
+        const Point& end )
+{
+    return Moving_Point{ start, end - start };
+}
+
+Point
+position_at(
+        const Moving_Point& p,
+        const float_t       time )
+{
+    return p.start + p.motion * time;
+}
+
+/*  c[0] + c[1] t + c[2] t^2 + c[3] t^3, values within tolerance of zero
+*   are zero up to rounding.
+*/
+struct
+Cubic
+{
+    float_t c[4u];
+    float_t tolerance;
+};
+
+float_t
+evaluate(
+        const Cubic&    cubic,
+        const float_t   t )
+{
+    return ((cubic.c[3u] * t + cubic.c[2u]) * t + cubic.c[1u]) * t + cubic.c[0u];
+}
+
+/*  Triple product of (b - a) x (c - a) and (d - a) over the step.
+*   It vanishes when the four points are coplanar, which is when a vertex
+*   can touch a face, or two edges can cross.
+*/
+Cubic
+make_coplanarity_cubic(
+        const Moving_Point& a,
+        const Moving_Point& b,
+        const Moving_Point& c,
+        const Moving_Point& d )
+{
+    const auto e1_start  = b.start - a.start;
+    const auto e1_motion = b.motion - a.motion;
+    const auto e2_start  = c.start - a.start;
+    const auto e2_motion = c.motion - a.motion;
+    const auto q_start   = d.start - a.start;
+    const auto q_motion  = d.motion - a.motion;
+
+    // normal is quadratic in t
+    const auto n0 = cross( e1_start, e2_start );
+    const auto n1 = cross( e1_start, e2_motion ) + cross( e1_motion, e2_start );
+    const auto n2 = cross( e1_motion, e2_motion );
+
+    // bounds the sum of the magnitudes of all terms
+    const auto size =
+          (std::sqrt( dot( e1_start, e1_start ) ) + std::sqrt( dot( e1_motion, e1_motion ) ))
+        * (std::sqrt( dot( e2_start, e2_start ) ) + std::sqrt( dot( e2_motion, e2_motion ) ))
+        * (std::sqrt( dot( q_start, q_start ) ) + std::sqrt( dot( q_motion, q_motion ) ));
+
+    return
+        Cubic{
+            {
+                dot( n0, q_start ),
+                dot( n1, q_start ) + dot( n0, q_motion ),
+                dot( n2, q_start ) + dot( n1, q_motion ),
+                dot( n2, q_motion ) },
+            cubic_tolerance * size };
+}
+
+/*  Whether value is zero up to the rounding error of cubic. */
+bool
+is_zero(
+        const Cubic&    cubic,
+        const float_t   value )
+{
+    return std::abs( value ) <= cubic.tolerance;
+}
+
+/*  Roots of cubic in [0, 1], ascending. The interval is split where the
+*   cubic turns, each monotonic piece holds at most one root. Rounding
+*   blurs a root into an interval where the cubic is within its tolerance
+*   of zero, the start of that interval is found by bisection. So roots
+*   are early by up to the width of that interval, never late. If the
+*   cubic vanishes on the whole interval, both ends are returned.
+*/
+unsigned int
+find_roots(
+        const Cubic&    cubic,
+        float_t         (&roots)[3u] )
+{
+    if (   is_zero( cubic, cubic.c[0u] ) & is_zero( cubic, cubic.c[1u] )
+         & is_zero( cubic, cubic.c[2u] ) & is_zero( cubic, cubic.c[3u] ) )
+    {
+        roots[0u] = 0;
+        roots[1u] = 1;
+
+        return 2u;
+    }
+
+    // turning points, roots of c[1] + 2 c[2] t + 3 c[3] t^2
+    float_t splits[4u] = { 0 };
+    unsigned int number_of_splits = 1u;
+
+    const auto add_split =
+        [&splits, &number_of_splits]
+        ( const float_t t )
+        {
+            if ( (0 < t) & (t < 1) )
+            {
+                splits[number_of_splits++] = t;
+            }
+        };
+
+    const float_t qa = 3 * cubic.c[3u];
+    const float_t qb = 2 * cubic.c[2u];
+    const float_t qc = cubic.c[1u];
+
+    if ( 0 != qa )
+    {
+        const auto discriminant = qb * qb - 4 * qa * qc;
+
+        if ( discriminant >= 0 )
+        {
+            // without cancellation between qb and the root
+            const auto q = -(qb + std::copysign( std::sqrt( discriminant ), qb )) / 2;
+
+            add_split( q / qa );
+
+            if ( 0 != q )
+            {
+                add_split( qc / q );
+            }
+        }
+    }
+    else if ( 0 != qb )
+    {
+        add_split( -qc / qb );
+    }
+
+    if ( (3u == number_of_splits) && (splits[2u] < splits[1u]) )
+    {
+        std::swap( splits[1u], splits[2u] );
+    }
+
+    splits[number_of_splits++] = 1;
+
+    unsigned int number_of_roots = 0u;
+
+    for( unsigned int i=0u; i+1u<number_of_splits; ++i )
+    {
+        auto low  = splits[i];
+        auto high = splits[i + 1u];
+
+        const auto f_low  = evaluate( cubic, low );
+        const auto f_high = evaluate( cubic, high );
+
+        if ( is_zero( cubic, f_low ) )
+        {
+            // a root reaching past the end of the previous piece is found already
+            if ( 0u == number_of_roots )
+            {
+                roots[number_of_roots++] = low;
+            }
+            continue;
+        }
+
+        if ( !is_zero( cubic, f_high ) && ((f_low < 0) == (f_high < 0)) )
+        {
+            continue;
+        }
+
+        // last point before the cubic comes within tolerance of zero
+        for( int step=0; step<std::numeric_limits<float_t>::digits; ++step )
+        {
+            const auto middle = (low + high) / 2;
+            const auto f_middle = evaluate( cubic, middle );
+
+            if ( !is_zero( cubic, f_middle ) && ((f_middle < 0) == (f_low < 0)) )
+            {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+
+        roots[number_of_roots++] = low;
+    }
+
+    assert( number_of_roots <= 3u );
+
+    return number_of_roots;
+}
+
+/*  Whether p lies inside triangle a, b, c it is coplanar with. */
+bool
+vertex_touches_face(
+        const Point& p,
+        const Point& a,
+        const Point& b,
+        const Point& c )
+{
+    const auto n = cross( b - a, c - a );
+    const auto nn = dot( n, n );
+
+    if ( 0 == nn )
+    {
+        return false;
+    }
+
+    // barycentric coordinates
+    const auto u = dot( cross( b - p, c - p ), n ) / nn;
+    const auto v = dot( cross( c - p, a - p ), n ) / nn;
+    const auto w = 1 - u - v;
+
+    return
+          (u >= -contact_tolerance)
+        & (v >= -contact_tolerance)
+        & (w >= -contact_tolerance);
+}
+
+/*  Whether coplanar edges p0 p1 and q0 q1 cross, point of crossing on p0 p1. */
+bool
+edges_touch(
+        const Point&    p0,
+        const Point&    p1,
+        const Point&    q0,
+        const Point&    q1,
+        Point&          point )
+{
+    const auto d1 = p1 - p0;
+    const auto d2 = q1 - q0;
+    const auto r  = p0 - q0;
+
+    const auto a = dot( d1, d1 );
+    const auto b = dot( d1, d2 );
+    const auto e = dot( d2, d2 );
+    const auto c = dot( d1, r );
+    const auto f = dot( d2, r );
+
+    const auto denominator = a * e - b * b;
+
+    // parallel edges touch at vertices, found by vertex-face tests
+    if ( denominator <= contact_tolerance * a * e )
+    {
+        return false;
+    }
+
+    const auto s = (b * f - c * e) / denominator;
+    const auto u = (a * f - b * c) / denominator;
+
+    point = p0 + d1 * s;
+
+    return
+          (s >= -contact_tolerance) & (s <= 1 + contact_tolerance)
+        & (u >= -contact_tolerance) & (u <= 1 + contact_tolerance);
+}
+
+/*  Earliest contact of a moving vertex and a moving face, if before impact.time. */
+void
+test_vertex_face(
+        const Moving_Point&         p,
+        const Moving_Point          (&face)[3u],
+        const Impact_Feature        feature,
+        Time_Of_Impact&             impact )
+{
+    float_t roots[3u];
+    const auto number_of_roots = find_roots( make_coplanarity_cubic( face[0u], face[1u], face[2u], p ), roots );
+
+    for( unsigned int r=0u; (r<number_of_roots) && (roots[r] < impact.time); ++r )
+    {
+        const auto t = roots[r];
+        const auto point = position_at( p, t );
+
+        if ( vertex_touches_face( point, position_at( face[0u], t ), position_at( face[1u], t ), position_at( face[2u], t ) ) )
+        {
+            impact.time     = t;
+            impact.feature  = feature;
+            impact.point    = point;
+
+            return;
+        }
+    }
+}
+
+/*  Earliest contact of two moving edges, if before impact.time. */
+void
+test_edge_edge(
+        const Moving_Point& p0,
+        const Moving_Point& p1,
+        const Moving_Point& q0,
+        const Moving_Point& q1,
+        Time_Of_Impact&     impact )
+{
+    float_t roots[3u];
+    const auto number_of_roots = find_roots( make_coplanarity_cubic( p0, p1, q0, q1 ), roots );
+
+    for( unsigned int r=0u; (r<number_of_roots) && (roots[r] < impact.time); ++r )
+    {
+        const auto t = roots[r];
+        Point point;
+
+        if ( edges_touch( position_at( p0, t ), position_at( p1, t ), position_at( q0, t ), position_at( q1, t ), point ) )
+        {
+            impact.time     = t;
+            impact.feature  = Impact_Feature::edge_edge;
+            impact.point    = point;
+
+            return;
+        }
+    }
+}
+
+/*  Earliest contact of two moving faces, time above 1 if they do not meet. */
+Time_Of_Impact
+find_time_of_impact(
+        const Mesh_Face& start1,
+        const Mesh_Face& end1,
+        const Mesh_Face& start2,
+        const Mesh_Face& end2 )
+{
+    Moving_Point face1[3u];
+    Moving_Point face2[3u];
+
+    for( unsigned int v=0u; v<3u; ++v )
+    {
+        face1[v] = make_moving_point( start1.vertices[v], end1.vertices[v] );
+        face2[v] = make_moving_point( start2.vertices[v], end2.vertices[v] );
+    }
+
+    Time_Of_Impact impact;
+    impact.time = 2;
+
+    for( unsigned int v=0u; v<3u; ++v )
+    {
+        test_vertex_face( face1[v], face2, Impact_Feature::vertex_face, impact );
+        test_vertex_face( face2[v], face1, Impact_Feature::face_vertex, impact );
+    }
+
+    for( unsigned int i=0u; i<3u; ++i )
+    for( unsigned int j=0u; j<3u; ++j )
+    {
+        test_edge_edge(
+            face1[i],
+            face1[(i + 1u) % 3u],
+            face2[j],
+            face2[(j + 1u) % 3u],
+            impact );
+    }
+
+    return impact;
+}
+
+}
+}
+
+continuous_narrow_phase_return_t
+CoDet::continuous_narrow_phase(
+        const pairwise_pruning_face_indices_t&  candidate_faces,
+        const std::vector<Mesh_Face>&           start_faces1,
+        const std::vector<Mesh_Face>&           end_faces1,
+        const std::vector<Mesh_Face>&           start_faces2,
+        const std::vector<Mesh_Face>&           end_faces2 )
+{
+    assert( start_faces1.size() == end_faces1.size() );
+    assert( start_faces2.size() == end_faces2.size() );
+
+    continuous_narrow_phase_return_t ret;
+
+    for( const auto& candidate : candidate_faces )
+    {
+        const auto face1 = std::get<0u>( candidate );
+        const auto face2 = std::get<1u>( candidate );
+
+        assert( face1 < start_faces1.size() );
+        assert( face2 < start_faces2.size() );
+
+        auto impact =
+            find_time_of_impact(
+                start_faces1[face1],
+                end_faces1[face1],
+                start_faces2[face2],
+                end_faces2[face2] );
+
+        if ( impact.time <= 1 )
+        {
+            impact.face1 = face1;
+            impact.face2 = face2;
+
+            ret.push_back( impact );
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "Point.h"
+#include "Pairwise_Pruning.h"
+
+namespace CoDet {
+
+// forward decls
+struct Mesh_Face;
+
+// which features of the two faces meet first
+enum class
+Impact_Feature
+{
+    vertex_face,    // vertex of face1 hits face2
+    face_vertex,    // face1 is hit by vertex of face2
+    edge_edge
+};
+
+/*  First contact of two faces moving during a time step.
+*
+*   Time is the fraction of the step, in [0, 1], taken early by a margin
+*   covering rounding error, so faces moved to it have not passed each
+*   other yet.
+*   Point is where the features meet, at that time.
+*/
+struct
+Time_Of_Impact
+{
+    std::uint32_t   face1;
+    std::uint32_t   face2;
+    float_t         time;
+    Impact_Feature  feature;
+    Point           point;
+};
+
+// defines
+using continuous_narrow_phase_return_t = std::vector<Time_Of_Impact>;
+
+// earliest time of impact of each candidate face pair whose faces touch while
+// their vertices move linearly from start to end positions, through vertex-face
+// and edge-edge contacts. Candidates are face indices into both meshes, as found
+// by pruning BVHs refit with BoundingVolumeHierarchy::refit_swept.
+// Features that stay coplanar during the whole step are only tested at its ends.
+continuous_narrow_phase_return_t
+continuous_narrow_phase(
+        const pairwise_pruning_face_indices_t&  candidate_faces,
+        const std::vector<Mesh_Face>&           start_faces1,
+        const std::vector<Mesh_Face>&           end_faces1,
+        const std::vector<Mesh_Face>&           start_faces2,
+        const std::vector<Mesh_Face>&           end_faces2 );
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include "Point.h"
+#include "Mesh_Face.h"
+
+namespace CoDet {
+
+/*  View of a mesh given as a shared vertex buffer and a triangle index buffer.
+*
+*   Neither buffer is copied or owned, both have to outlive the view and
+*   every BVH built from it. Strides are in bytes, so positions can be read
+*   straight out of interleaved vertex formats, and triangles out of index
+*   buffers with extra per-triangle data.
+*   Faces are numbered by their position in the index buffer.
+*/
+class Indexed_Mesh final
+{
+private:
+    const unsigned char*    positions;
+    std::size_t             vertex_stride;
+    const unsigned char*    indices;
+    std::size_t             triangle_stride;
+    std::size_t             number_of_faces;
+
+public:
+    Indexed_Mesh()
+        :   positions       (nullptr)
+        ,   vertex_stride   (0u)
+        ,   indices         (nullptr)
+        ,   triangle_stride (0u)
+        ,   number_of_faces (0u)
+    {}
+
+private:
+    Indexed_Mesh(
+            const unsigned char*    positions,
+            const std::size_t       vertex_stride,
+            const unsigned char*    indices,
+            const std::size_t       triangle_stride,
+            const std::size_t       number_of_faces
+    )
+        :   positions       (positions)
+        ,   vertex_stride   (vertex_stride)
+        ,   indices         (indices)
+        ,   triangle_stride (triangle_stride)
+        ,   number_of_faces (number_of_faces)
+    {}
+
+public:
+    std::size_t
+    size() const
+    {
+        return number_of_faces;
+    }
+public:
+    bool
+    empty() const
+    {
+        return 0u == number_of_faces;
+    }
+public:
+    Point
+    get_vertex(
+            const std::uint32_t vertex_index ) const
+    {
+        const auto* const p = reinterpret_cast<const float_t*>( positions + vertex_index * vertex_stride );
+
+        return Point{ { p[0u], p[1u], p[2u] } };
+    }
+public:
+    /*  Indices of the three vertices of a face. */
+    const std::uint32_t*
+    get_triangle(
+            const std::size_t face_index ) const
+    {
+        assert( face_index < number_of_faces );
+
+        return reinterpret_cast<const std::uint32_t*>( indices + face_index * triangle_stride );
+    }
+public:
+    /*  Face assembled from its vertices. */
+    Mesh_Face
+    get_face(
+            const std::size_t face_index ) const
+    {
+        const auto* const triangle = get_triangle( face_index );
+
+        return
+            Mesh_Face{ {
+                get_vertex( triangle[0u] ),
+                get_vertex( triangle[1u] ),
+                get_vertex( triangle[2u] ) } };
+    }
+
+public:
+    /*  View of number_of_faces triangles.
+    *   Vertex v has its position at positions + v * vertex_stride bytes,
+    *   triangle f its three vertex indices at indices + f * triangle_stride bytes.
+    */
+    static
+    Indexed_Mesh
+    make_indexed_mesh(
+            const float_t*          positions,
+            const std::size_t       vertex_stride,
+            const std::uint32_t*    indices,
+            const std::size_t       triangle_stride,
+            const std::size_t       number_of_faces )
+    {
+        assert( vertex_stride >= 3u * sizeof(float_t) );
+        assert( triangle_stride >= 3u * sizeof(std::uint32_t) );
+
+        return
+            Indexed_Mesh(
+                reinterpret_cast<const unsigned char*>( positions ),
+                vertex_stride,
+                reinterpret_cast<const unsigned char*>( indices ),
+                triangle_stride,
+                number_of_faces );
+    }
+public:
+    /*  View of tightly packed vertices and triangles, the vertices may be
+     *  empty when there are no triangles. */
+    static
+    Indexed_Mesh
+    make_indexed_mesh(
+            const std::vector<Point>&           vertices,
+            const std::vector<std::uint32_t>&   indices )
+    {
+        assert( 0u == indices.size() % 3u );
+
+        const float_t* positions =
+            vertices.empty() ? nullptr : vertices.front().data.data();
+
+        return
+            make_indexed_mesh(
+                positions,
+                sizeof(Point),
+                indices.data(),
+                3u * sizeof(std::uint32_t),
+                indices.size() / 3u );
+    }
+};
+
+}
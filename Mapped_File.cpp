@@ -0,0 +1,140 @@
+#if defined(_WIN32)
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+#include "BVH_Image.h"
+
+using namespace CoDet;
+
+Mapped_File&
+Mapped_File::operator=(
+        Mapped_File&& other )
+{
+    if ( this != &other )
+    {
+        unmap();
+
+        mapping             = other.mapping;
+        mapping_size        = other.mapping_size;
+        other.mapping       = nullptr;
+        other.mapping_size  = 0u;
+    }
+
+    return *this;
+}
+
+Mapped_File::~Mapped_File()
+{
+    unmap();
+}
+
+#if defined(_WIN32)
+
+void
+Mapped_File::unmap()
+{
+    if ( nullptr != mapping )
+    {
+        ::UnmapViewOfFile( mapping );
+        mapping         = nullptr;
+        mapping_size    = 0u;
+    }
+}
+
+Mapped_File
+Mapped_File::map_file(
+        const char* path )
+{
+    Mapped_File ret;
+
+    const HANDLE file = ::CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+
+    if ( INVALID_HANDLE_VALUE == file )
+    {
+        return ret;
+    }
+
+    LARGE_INTEGER file_size;
+
+    if ( ::GetFileSizeEx( file, &file_size ) && (0 < file_size.QuadPart) )
+    {
+        const HANDLE file_mapping = ::CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+        if ( nullptr != file_mapping )
+        {
+            const void* const view = ::MapViewOfFile( file_mapping, FILE_MAP_READ, 0, 0, 0 );
+
+            if ( nullptr != view )
+            {
+                ret.mapping         = view;
+                ret.mapping_size    = static_cast<std::size_t>( file_size.QuadPart );
+            }
+
+            // view keeps the mapping object alive
+            ::CloseHandle( file_mapping );
+        }
+    }
+
+    ::CloseHandle( file );
+
+    return ret;
+}
+
+#else
+
+void
+Mapped_File::unmap()
+{
+    if ( nullptr != mapping )
+    {
+        ::munmap( const_cast<void*>( mapping ), mapping_size );
+        mapping         = nullptr;
+        mapping_size    = 0u;
+    }
+}
+
+Mapped_File
+Mapped_File::map_file(
+        const char* path )
+{
+    Mapped_File ret;
+
+    const int fd = ::open( path, O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        return ret;
+    }
+
+    struct stat file_status;
+
+    if ( (0 == ::fstat( fd, &file_status )) && (0 < file_status.st_size) )
+    {
+        const auto size = static_cast<std::size_t>( file_status.st_size );
+
+        void* const mapping = ::mmap( nullptr, size, PROT_READ, MAP_SHARED, fd, 0 );
+
+        if ( MAP_FAILED != mapping )
+        {
+            ret.mapping         = mapping;
+            ret.mapping_size    = size;
+        }
+    }
+
+    // mapping stays valid after the descriptor is closed
+    ::close( fd );
+
+    return ret;
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <cassert>
 #include "BBox.h"
 #include "BVH_Node.h"
+#include "Mesh_Face.h"
 
 namespace CoDet {
 
@@ -26,58 +27,118 @@ partition_by_coord(
             [midpoint]
             ( const auto& el )
             {
-                return
-                    (
-                        (el->vertices[0u].data[coord]
-                        +el->vertices[1u].data[coord]
-                        +el->vertices[2u].data[coord])
-                        * 0.33333333333
-                    ) < midpoint;
+                return get_face_centroid( el, coord ) < midpoint;
             } );
 }
 
-/*    Partition faces using bisection on every coordinate for a maximum of 8 partitions
- *     and a minimum of two (assuming reasonable input).
+/*    Split faces in two halves by count, along the axis on which their
+ *    centroids spread the most. Always splits two or more faces, also
+ *    when all of their centroids coincide.
  * */
+template <typename Face_iterator>
 inline
-auto
-Naive_Oct_Split(
-        const Mesh_face_iterator    mesh_face_data_begin,
-        const Mesh_face_iterator    mesh_face_data_end,
-        const BBox                  bbox )
+std::vector<std::tuple<const Face_iterator,const Face_iterator>>
+split_at_object_median(
+        const Face_iterator     mesh_face_data_begin,
+        const Face_iterator     mesh_face_data_end )
 {
-    assert( mesh_face_data_begin < mesh_face_data_end );
+    assert( 2 <= mesh_face_data_end - mesh_face_data_begin );
 
-    const auto midpoint = (bbox.min + bbox.max) * 0.5f;
+    auto centroid_bbox = make_empty_bbox();
+    for( auto it=mesh_face_data_begin; it!=mesh_face_data_end; ++it )
+    {
+        expand_bbox(
+            centroid_bbox,
+            make_point(
+                [it]
+                ( const unsigned int coord )
+                {
+                    return get_face_centroid( *it, coord );
+                } ) );
+    }
 
-    std::vector<std::tuple<const Mesh_face_iterator,const Mesh_face_iterator>> ret;
-    Mesh_face_iterator it[9u];
+    const auto extent = centroid_bbox.max - centroid_bbox.min;
+
+    unsigned int axis = (extent.data[1u] > extent.data[0u]) ? 1u : 0u;
+    if ( extent.data[2u] > extent.data[axis] )
+    {
+        axis = 2u;
+    }
 
-    it[0u] = mesh_face_data_begin;
-    it[8u] = mesh_face_data_end;
+    const auto middle = mesh_face_data_begin + (mesh_face_data_end - mesh_face_data_begin) / 2;
 
-    it[4u] = partition_by_coord<0u>( it[0u], it[8u], midpoint.data[0u] );
+    std::nth_element(
+        mesh_face_data_begin,
+        middle,
+        mesh_face_data_end,
+        [axis]
+        ( const auto& l, const auto& r )
+        {
+            return get_face_centroid( l, axis ) < get_face_centroid( r, axis );
+        } );
 
-    it[2u] = partition_by_coord<1u>( it[0u], it[4u], midpoint.data[1u] );
-    it[6u] = partition_by_coord<1u>( it[4u], it[8u], midpoint.data[1u] );
+    std::vector<std::tuple<const Face_iterator,const Face_iterator>> ret;
+    ret.emplace_back( mesh_face_data_begin, middle );
+    ret.emplace_back( middle, mesh_face_data_end );
 
-    it[1u] = partition_by_coord<2u>( it[0u], it[2u], midpoint.data[2u] );
-    it[3u] = partition_by_coord<2u>( it[2u], it[4u], midpoint.data[2u] );
-    it[5u] = partition_by_coord<2u>( it[4u], it[6u], midpoint.data[2u] );
-    it[7u] = partition_by_coord<2u>( it[6u], it[8u], midpoint.data[2u] );
+    return ret;
+}
 
-    for( unsigned int child=1u; child<9u; ++child )
+/*    Partition faces using bisection on every coordinate for a maximum of 8 partitions
+ *    and a minimum of two. When all centroids fall on the same side of every
+ *    midpoint, as for duplicate faces, bisection would return the range
+ *    itself, so it is split at the object median instead.
+ *    Stateless, the Naive_Oct_Split instance below serves every build.
+ * */
+class Naive_Oct_Split_Policy final
+{
+public:
+    template <typename Face_iterator>
+    std::vector<std::tuple<const Face_iterator,const Face_iterator>>
+    operator()(
+            const Face_iterator     mesh_face_data_begin,
+            const Face_iterator     mesh_face_data_end,
+            const BBox              bbox ) const
     {
-        assert( it[child] >= it[child-1u] );
+        assert( mesh_face_data_begin < mesh_face_data_end );
+
+        const auto midpoint = (bbox.min + bbox.max) * 0.5f;
 
-        if ( 0u != (it[child] - it[child-1u]) )
+        std::vector<std::tuple<const Face_iterator,const Face_iterator>> ret;
+        Face_iterator it[9u];
+
+        it[0u] = mesh_face_data_begin;
+        it[8u] = mesh_face_data_end;
+
+        it[4u] = partition_by_coord<0u>( it[0u], it[8u], midpoint.data[0u] );
+
+        it[2u] = partition_by_coord<1u>( it[0u], it[4u], midpoint.data[1u] );
+        it[6u] = partition_by_coord<1u>( it[4u], it[8u], midpoint.data[1u] );
+
+        it[1u] = partition_by_coord<2u>( it[0u], it[2u], midpoint.data[2u] );
+        it[3u] = partition_by_coord<2u>( it[2u], it[4u], midpoint.data[2u] );
+        it[5u] = partition_by_coord<2u>( it[4u], it[6u], midpoint.data[2u] );
+        it[7u] = partition_by_coord<2u>( it[6u], it[8u], midpoint.data[2u] );
+
+        for( unsigned int child=1u; child<9u; ++child )
+        {
+            assert( it[child] >= it[child-1u] );
+
+            if ( 0u != (it[child] - it[child-1u]) )
+            {
+                ret.emplace_back( it[child-1u], it[child] );
+            }
+        }
+
+        if ( ret.size() < 2u )
         {
-            ret.emplace_back( it[child-1u], it[child] );
+            return split_at_object_median( mesh_face_data_begin, mesh_face_data_end );
         }
+
+        return ret;
     }
+};
 
-    return ret;
-}
+constexpr Naive_Oct_Split_Policy Naive_Oct_Split {};
 
 }
-
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <cassert>
+#include "Narrow_Phase.h"
+#include "Mesh_Face.h"
+
+using namespace CoDet;
+
+// implementation lives inside CoDet, so that float_t does not clash with the one from <cmath>
+namespace CoDet {
+namespace {
+
+/*  Number of candidate pairs filtered together. */
+constexpr std::size_t batch_size = 16u;
+
+/*  Signed distances to a plane through a triangle are rounding error below
+*   this times the lengths of two of its edges and the largest coordinate
+*   magnitude, and are taken as zero, as in Moeller's original test.
+*   Vertices meant to lie on a tilted plane are only on it to rounding.
+*/
+const float_t distance_tolerance = 64 * std::numeric_limits<float_t>::epsilon();
+
+/*  Tolerance of signed distances to the plane of a triangle with edges e1, e2. */
+float_t
+get_distance_tolerance(
+        const Point&    e1,
+        const Point&    e2,
+        const float_t   coordinate_scale )
+{
+    return distance_tolerance * std::sqrt( dot( e1, e1 ) * dot( e2, e2 ) ) * coordinate_scale;
+}
+
+/*  Largest coordinate magnitude of both faces. */
+float_t
+get_coordinate_scale(
+        const Mesh_Face& face1,
+        const Mesh_Face& face2 )
+{
+    float_t scale = 0;
+
+    for( const auto* face : { &face1, &face2 } )
+    for( const auto& vert : face->vertices )
+    for( unsigned int c=0u; c<3u; ++c )
+    {
+        scale = std::max( scale, std::abs( vert.data[c] ) );
+    }
+
+    return scale;
+}
+
+/*  Coordinates of candidate pairs of one batch, in SoA layout.
+*   vertex[t][v][c][i] is coordinate c of vertex v of triangle t of pair i.
+*/
+struct
+Candidate_Batch
+{
+    float_t         vertex[2u][3u][3u][batch_size];
+    float_t         coordinate_scale[batch_size];
+    std::uint32_t   count;
+};
+
+void
+load_batch(
+        const pairwise_pruning_return_t&    candidate_faces,
+        const std::size_t                   first,
+        Candidate_Batch&                    batch )
+{
+    batch.count = static_cast<std::uint32_t>( std::min( batch_size, candidate_faces.size() - first ) );
+
+    for( std::uint32_t i=0u; i<batch.count; ++i )
+    {
+        const Mesh_Face* const faces[2u] = {
+            std::get<0u>( candidate_faces[first + i] ),
+            std::get<1u>( candidate_faces[first + i] ) };
+
+        for( unsigned int t=0u; t<2u; ++t )
+        for( unsigned int v=0u; v<3u; ++v )
+        for( unsigned int c=0u; c<3u; ++c )
+        {
+            batch.vertex[t][v][c][i] = faces[t]->vertices[v].data[c];
+        }
+
+        batch.coordinate_scale[i] = get_coordinate_scale( *faces[0u], *faces[1u] );
+    }
+}
+
+/*  Flag pairs where all vertices of triangle a lie on one side of the
+*   plane of triangle b, farther than rounding error. Straight line code over SoA arrays,
+*   so that the compiler can vectorise it across the batch.
+*/
+void
+plane_separation(
+        const Candidate_Batch&  batch,
+        const unsigned int      a,
+        const unsigned int      b,
+        bool                    (&separated)[batch_size] )
+{
+    const auto& A = batch.vertex[a];
+    const auto& B = batch.vertex[b];
+
+    for( std::size_t i=0u; i<batch_size; ++i )
+    {
+        const float_t e1x = B[1u][0u][i] - B[0u][0u][i];
+        const float_t e1y = B[1u][1u][i] - B[0u][1u][i];
+        const float_t e1z = B[1u][2u][i] - B[0u][2u][i];
+        const float_t e2x = B[2u][0u][i] - B[0u][0u][i];
+        const float_t e2y = B[2u][1u][i] - B[0u][1u][i];
+        const float_t e2z = B[2u][2u][i] - B[0u][2u][i];
+
+        const float_t nx = e1y*e2z - e1z*e2y;
+        const float_t ny = e1z*e2x - e1x*e2z;
+        const float_t nz = e1x*e2y - e1y*e2x;
+
+        const float_t d0 = nx*(A[0u][0u][i]-B[0u][0u][i]) + ny*(A[0u][1u][i]-B[0u][1u][i]) + nz*(A[0u][2u][i]-B[0u][2u][i]);
+        const float_t d1 = nx*(A[1u][0u][i]-B[0u][0u][i]) + ny*(A[1u][1u][i]-B[0u][1u][i]) + nz*(A[1u][2u][i]-B[0u][2u][i]);
+        const float_t d2 = nx*(A[2u][0u][i]-B[0u][0u][i]) + ny*(A[2u][1u][i]-B[0u][1u][i]) + nz*(A[2u][2u][i]-B[0u][2u][i]);
+
+        const float_t tolerance =
+            distance_tolerance
+            * std::sqrt( (e1x*e1x + e1y*e1y + e1z*e1z) * (e2x*e2x + e2y*e2y + e2z*e2z) )
+            * batch.coordinate_scale[i];
+
+        separated[i] |=
+              ((d0 > tolerance) & (d1 > tolerance) & (d2 > tolerance))
+            | ((d0 < -tolerance) & (d1 < -tolerance) & (d2 < -tolerance));    // bitwise operator to remove dependency
+    }
+}
+
+/*  Signed distances (scaled by normal length) of vertices to a plane
+*   through triangle, those within tolerance of it snapped to zero.
+*/
+void
+signed_distances(
+        const std::array<Point,3u>& vertices,
+        const Point&                normal,
+        const Point&                on_plane,
+        const float_t               tolerance,
+        float_t                     (&d)[3u] )
+{
+    for( unsigned int k=0u; k<3u; ++k )
+    {
+        d[k] = dot( normal, vertices[k] - on_plane );
+
+        if ( std::abs( d[k] ) <= tolerance )
+        {
+            d[k] = 0;
+        }
+    }
+}
+
+bool
+all_zero(
+        const float_t (&d)[3u] )
+{
+    return (0 == d[0u]) & (0 == d[1u]) & (0 == d[2u]);
+}
+
+bool
+strictly_one_side(
+        const float_t (&d)[3u] )
+{
+    return
+          ((d[0u] > 0) & (d[1u] > 0) & (d[2u] > 0))
+        | ((d[0u] < 0) & (d[1u] < 0) & (d[2u] < 0));
+}
+
+/*  Points where triangle meets the plane given by signed distances
+*   of its vertices. Returns their number, one or two.
+*/
+unsigned int
+plane_crossing(
+        const std::array<Point,3u>& vertices,
+        const float_t               (&d)[3u],
+        Point                       (&points)[2u] )
+{
+    unsigned int count = 0u;
+
+    const auto add =
+        [&points,&count]
+        ( const Point& p )
+        {
+            if ( count < 2u )
+            {
+                points[count++] = p;
+            }
+        };
+
+    for( unsigned int i=0u; i<3u; ++i )
+    {
+        const auto j = (i + 1u) % 3u;
+
+        if ( 0 == d[i] )
+        {
+            add( vertices[i] );
+        }
+        if ( ((d[i] < 0) & (d[j] > 0)) | ((d[i] > 0) & (d[j] < 0)) )
+        {
+            add( vertices[i] + (vertices[j] - vertices[i]) * (d[i] / (d[i] - d[j])) );
+        }
+    }
+
+    assert( 0u != count );
+
+    if ( 1u == count )
+    {
+        points[1u] = points[0u];
+    }
+
+    return count;
+}
+
+float_t
+orient_2d(
+        const float_t (&a)[2u],
+        const float_t (&b)[2u],
+        const float_t (&c)[2u] )
+{
+    return (b[0u]-a[0u])*(c[1u]-a[1u]) - (b[1u]-a[1u])*(c[0u]-a[0u]);
+}
+
+bool
+segments_intersect_2d(
+        const float_t (&a)[2u],
+        const float_t (&b)[2u],
+        const float_t (&c)[2u],
+        const float_t (&d)[2u] )
+{
+    const auto o1 = orient_2d( a, b, c );
+    const auto o2 = orient_2d( a, b, d );
+    const auto o3 = orient_2d( c, d, a );
+    const auto o4 = orient_2d( c, d, b );
+
+    if ( (0 == o1) & (0 == o2) )
+    {
+        // collinear, compare extents on both axes
+        for( unsigned int axis=0u; axis<2u; ++axis )
+        {
+            if (   std::max( a[axis], b[axis] ) < std::min( c[axis], d[axis] )
+                || std::max( c[axis], d[axis] ) < std::min( a[axis], b[axis] ) )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    return
+          (o1 * o2 <= 0)
+        & (o3 * o4 <= 0);
+}
+
+bool
+point_in_triangle_2d(
+        const float_t (&p)[2u],
+        const float_t (&t)[3u][2u] )
+{
+    const auto o1 = orient_2d( t[0u], t[1u], p );
+    const auto o2 = orient_2d( t[1u], t[2u], p );
+    const auto o3 = orient_2d( t[2u], t[0u], p );
+
+    return
+          ((o1 >= 0) & (o2 >= 0) & (o3 >= 0))
+        | ((o1 <= 0) & (o2 <= 0) & (o3 <= 0));
+}
+
+/*  Intersection test of coplanar triangles, done in the coordinate
+*   plane where their projection has the largest area.
+*/
+bool
+coplanar_triangles_intersect(
+        const std::array<Point,3u>& V,
+        const std::array<Point,3u>& U,
+        const Point&                normal )
+{
+    const float_t abs_normal[3u] = {
+        std::abs( normal.data[0u] ),
+        std::abs( normal.data[1u] ),
+        std::abs( normal.data[2u] ) };
+
+    const unsigned int dropped =
+        (abs_normal[0u] > abs_normal[1u])
+            ? ( (abs_normal[0u] > abs_normal[2u]) ? 0u : 2u )
+            : ( (abs_normal[1u] > abs_normal[2u]) ? 1u : 2u );
+
+    const unsigned int i0 = (0u == dropped) ? 1u : 0u;
+    const unsigned int i1 = (2u == dropped) ? 1u : 2u;
+
+    float_t v[3u][2u];
+    float_t u[3u][2u];
+    for( unsigned int k=0u; k<3u; ++k )
+    {
+        v[k][0u] = V[k].data[i0];
+        v[k][1u] = V[k].data[i1];
+        u[k][0u] = U[k].data[i0];
+        u[k][1u] = U[k].data[i1];
+    }
+
+    for( unsigned int i=0u; i<3u; ++i )
+    for( unsigned int j=0u; j<3u; ++j )
+    {
+        if ( segments_intersect_2d( v[i], v[(i+1u)%3u], u[j], u[(j+1u)%3u] ) )
+        {
+            return true;
+        }
+    }
+
+    return
+           point_in_triangle_2d( v[0u], u )
+        || point_in_triangle_2d( u[0u], v );
+}
+
+/*  Test of two triangles, following Moeller's interval overlap method.
+*   Both triangles are cut by the plane of the other one, the two cuts
+*   lie on the line where the planes meet and the triangles intersect
+*   iff the cuts overlap on that line.
+*/
+bool
+triangles_intersect(
+        const Mesh_Face&            face1,
+        const Mesh_Face&            face2,
+        Triangle_Intersection&      result )
+{
+    const auto& V = face1.vertices;
+    const auto& U = face2.vertices;
+
+    const auto normal1 = cross( V[1u] - V[0u], V[2u] - V[0u] );
+    const auto normal2 = cross( U[1u] - U[0u], U[2u] - U[0u] );
+
+    const auto coordinate_scale = get_coordinate_scale( face1, face2 );
+
+    const Point zero{ { 0, 0, 0 } };
+    if ( (normal1 == zero) | (normal2 == zero) )
+    {
+        // degenerate face
+        return false;
+    }
+
+    float_t dv[3u];
+    signed_distances( V, normal2, U[0u], get_distance_tolerance( U[1u] - U[0u], U[2u] - U[0u], coordinate_scale ), dv );
+    if ( strictly_one_side( dv ) )
+    {
+        return false;
+    }
+
+    float_t du[3u];
+    signed_distances( U, normal1, V[0u], get_distance_tolerance( V[1u] - V[0u], V[2u] - V[0u], coordinate_scale ), du );
+    if ( strictly_one_side( du ) )
+    {
+        return false;
+    }
+
+    // either face lying in the plane of the other means both are coplanar
+    if ( all_zero( dv ) | all_zero( du ) )
+    {
+        result.coplanar     = true;
+        result.segment[0u]  = zero;
+        result.segment[1u]  = zero;
+
+        return coplanar_triangles_intersect( V, U, normal1 );
+    }
+
+    Point cut1[2u];
+    Point cut2[2u];
+    plane_crossing( V, dv, cut1 );
+    plane_crossing( U, du, cut2 );
+
+    // parametrise both cuts along the line the planes meet at
+    const auto direction = cross( normal1, normal2 );
+
+    float_t t1[2u] = { dot( direction, cut1[0u] ), dot( direction, cut1[1u] ) };
+    float_t t2[2u] = { dot( direction, cut2[0u] ), dot( direction, cut2[1u] ) };
+
+    if ( t1[0u] > t1[1u] )
+    {
+        std::swap( t1[0u], t1[1u] );
+        std::swap( cut1[0u], cut1[1u] );
+    }
+    if ( t2[0u] > t2[1u] )
+    {
+        std::swap( t2[0u], t2[1u] );
+        std::swap( cut2[0u], cut2[1u] );
+    }
+
+    if ( (t1[1u] < t2[0u]) | (t2[1u] < t1[0u]) )
+    {
+        return false;
+    }
+
+    result.coplanar     = false;
+    result.segment[0u]  = (t1[0u] > t2[0u]) ? cut1[0u] : cut2[0u];
+    result.segment[1u]  = (t1[1u] < t2[1u]) ? cut1[1u] : cut2[1u];
+
+    return true;
+}
+
+}
+}
+
+narrow_phase_return_t
+CoDet::narrow_phase(
+        const pairwise_pruning_return_t&    candidate_faces )
+{
+    narrow_phase_return_t ret;
+
+    Candidate_Batch batch = {};
+
+    for( std::size_t first=0u; first<candidate_faces.size(); first+=batch_size )
+    {
+        load_batch( candidate_faces, first, batch );
+
+        // cheap plane side rejection for the whole batch,
+        // lanes past batch.count hold stale data and are ignored
+        bool separated[batch_size] = {};
+        plane_separation( batch, 0u, 1u, separated );
+        plane_separation( batch, 1u, 0u, separated );
+
+        for( std::uint32_t i=0u; i<batch.count; ++i )
+        {
+            if ( separated[i] )
+            {
+                continue;
+            }
+
+            const auto& candidate = candidate_faces[first + i];
+
+            Triangle_Intersection intersection;
+            intersection.face1 = std::get<0u>( candidate );
+            intersection.face2 = std::get<1u>( candidate );
+
+            if ( triangles_intersect( *intersection.face1, *intersection.face2, intersection ) )
+            {
+                ret.push_back( intersection );
+            }
+        }
+    }
+
+    return ret;
+}
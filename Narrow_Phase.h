@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include "Point.h"
+#include "Pairwise_Pruning.h"
+
+namespace CoDet {
+
+// forward decls
+struct Mesh_Face;
+
+/*  Pair of faces that do intersect.
+*
+*   For faces in general position the segment holds endpoints of
+*   the intersection of both triangles. It degenerates to a point
+*   when faces only touch. For coplanar faces the intersection is
+*   a polygon, only the flag is set and the segment is unspecified.
+*/
+struct
+Triangle_Intersection
+{
+    const Mesh_Face*    face1;
+    const Mesh_Face*    face2;
+    Point               segment[2u];
+    bool                coplanar;
+};
+
+// defines
+using narrow_phase_return_t = std::vector<Triangle_Intersection>;
+
+// triangle-triangle test of pruning candidates. Vertices within rounding
+// error of the plane of the other face count as lying on it, so faces in
+// one tilted plane are found coplanar.
+narrow_phase_return_t
+narrow_phase(
+        const pairwise_pruning_return_t&    candidate_faces );
+
+}
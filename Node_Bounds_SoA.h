@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include "Compact_BVH_Node.h"
+#include "Array_View.h"
+#include "common_utils.h"
+
+namespace CoDet {
+
+/*  Bounds of all BVH nodes in structure of arrays layout.
+*
+*   Indexed like the node array, so the bounds of siblings are adjacent
+*   in every coordinate array and can be loaded into one SIMD register.
+*   Arrays are padded with empty boxes, which allows full width loads
+*   past the last node.
+*   Bounds of faces are kept in the same layout, indexed like the face
+*   order, so that faces of a leaf are adjacent.
+*/
+struct
+Node_Bounds_SoA
+{
+    static constexpr std::size_t padding = 8u;
+
+    std::vector<bound_t>    min[3u];
+    std::vector<bound_t>    max[3u];
+};
+
+/*  Read only view of SoA bounds, padding included.
+*   Refers either to a Node_Bounds_SoA or to bounds in a mapped BVH image.
+*/
+struct
+Node_Bounds_View
+{
+    Array_View<bound_t>     min[3u];
+    Array_View<bound_t>     max[3u];
+
+    Node_Bounds_View() = default;
+
+    Node_Bounds_View(
+            const Node_Bounds_SoA& soa )
+        :   min { soa.min[0u], soa.min[1u], soa.min[2u] }
+        ,   max { soa.max[0u], soa.max[1u], soa.max[2u] }
+    {}
+};
+
+/*  Copy count boxes, box i given by get_bbox( i ), into SoA layout.
+*/
+template <typename Get_bbox>
+Node_Bounds_SoA
+make_bounds_soa(
+        const std::size_t   count,
+        Get_bbox            get_bbox )
+{
+    constexpr bound_t max_val = std::numeric_limits<bound_t>::max();
+
+    Node_Bounds_SoA soa;
+
+    for_each_coordinate(
+        [&soa, count, max_val]
+        ( const unsigned int coord )
+        {
+            soa.min[coord].resize( count + Node_Bounds_SoA::padding, +max_val );
+            soa.max[coord].resize( count + Node_Bounds_SoA::padding, -max_val );
+        } );
+
+    for( std::size_t i=0u; i<count; ++i )
+    {
+        const Node_BBox bbox = get_bbox( i );
+
+        for_each_coordinate(
+            [&soa, &bbox, i]
+            ( const unsigned int coord )
+            {
+                soa.min[coord][i] = bbox.min[coord];
+                soa.max[coord][i] = bbox.max[coord];
+            } );
+    }
+
+    return soa;
+}
+
+/*  Copy bounds of given nodes into SoA layout.
+*/
+inline
+Node_Bounds_SoA
+make_node_bounds_soa(
+        const std::vector<Compact_BVH_Node>& nodes )
+{
+    return
+        make_bounds_soa(
+            nodes.size(),
+            [&nodes]
+            ( const std::size_t n )
+            {
+                return nodes[n].bbox;
+            } );
+}
+
+/*  Box i of the SoA bounds. */
+inline
+Node_BBox
+get_bbox(
+        const Node_Bounds_View& soa,
+        const std::size_t       i )
+{
+    Node_BBox bbox;
+
+    for_each_coordinate(
+        [&bbox, &soa, i]
+        ( const unsigned int coord )
+        {
+            bbox.min[coord] = soa.min[coord][i];
+            bbox.max[coord] = soa.max[coord][i];
+        } );
+
+    return bbox;
+}
+
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include "BBox.h"
+#include "Node_Bounds_SoA.h"
+
+#if !defined(CODET_NO_SIMD) && (defined(__AVX__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+namespace CoDet {
+
+/*  Maximum number of boxes tested by one overlap_mask call. */
+constexpr std::uint32_t overlap_mask_width = 32u;
+
+namespace detail {
+
+/*  Pointers to the six coordinate arrays of the tested boxes. */
+template <typename T>
+struct
+SoA_Bounds_View
+{
+    const T* min_x;
+    const T* min_y;
+    const T* min_z;
+    const T* max_x;
+    const T* max_y;
+    const T* max_z;
+};
+
+#if !defined(CODET_NO_SIMD) && defined(__AVX__)
+
+inline
+std::uint32_t
+overlap_mask_simd(
+        const Node_BBox&                    bbox,
+        const SoA_Bounds_View<float>&       b,
+        const std::uint32_t                 count )
+{
+    const auto q_min_x = _mm256_set1_ps( bbox.min[0u] );
+    const auto q_min_y = _mm256_set1_ps( bbox.min[1u] );
+    const auto q_min_z = _mm256_set1_ps( bbox.min[2u] );
+    const auto q_max_x = _mm256_set1_ps( bbox.max[0u] );
+    const auto q_max_y = _mm256_set1_ps( bbox.max[1u] );
+    const auto q_max_z = _mm256_set1_ps( bbox.max[2u] );
+
+    std::uint32_t mask = 0u;
+
+    // padding guarantees the last, partially used, load stays in bounds
+    for( std::uint32_t i=0u; i<count; i+=8u )
+    {
+        const auto x =
+            _mm256_and_ps(
+                _mm256_cmp_ps( q_min_x, _mm256_loadu_ps( b.max_x + i ), _CMP_LT_OQ ),
+                _mm256_cmp_ps( q_max_x, _mm256_loadu_ps( b.min_x + i ), _CMP_GT_OQ ) );
+        const auto y =
+            _mm256_and_ps(
+                _mm256_cmp_ps( q_min_y, _mm256_loadu_ps( b.max_y + i ), _CMP_LT_OQ ),
+                _mm256_cmp_ps( q_max_y, _mm256_loadu_ps( b.min_y + i ), _CMP_GT_OQ ) );
+        const auto z =
+            _mm256_and_ps(
+                _mm256_cmp_ps( q_min_z, _mm256_loadu_ps( b.max_z + i ), _CMP_LT_OQ ),
+                _mm256_cmp_ps( q_max_z, _mm256_loadu_ps( b.min_z + i ), _CMP_GT_OQ ) );
+
+        mask |= static_cast<std::uint32_t>( _mm256_movemask_ps( _mm256_and_ps( _mm256_and_ps( x, y ), z ) ) ) << i;
+    }
+
+    return mask;
+}
+
+inline
+std::uint32_t
+overlap_mask_simd(
+        const Node_BBox&                    bbox,
+        const SoA_Bounds_View<double>&      b,
+        const std::uint32_t                 count )
+{
+    const auto q_min_x = _mm256_set1_pd( bbox.min[0u] );
+    const auto q_min_y = _mm256_set1_pd( bbox.min[1u] );
+    const auto q_min_z = _mm256_set1_pd( bbox.min[2u] );
+    const auto q_max_x = _mm256_set1_pd( bbox.max[0u] );
+    const auto q_max_y = _mm256_set1_pd( bbox.max[1u] );
+    const auto q_max_z = _mm256_set1_pd( bbox.max[2u] );
+
+    std::uint32_t mask = 0u;
+
+    for( std::uint32_t i=0u; i<count; i+=4u )
+    {
+        const auto x =
+            _mm256_and_pd(
+                _mm256_cmp_pd( q_min_x, _mm256_loadu_pd( b.max_x + i ), _CMP_LT_OQ ),
+                _mm256_cmp_pd( q_max_x, _mm256_loadu_pd( b.min_x + i ), _CMP_GT_OQ ) );
+        const auto y =
+            _mm256_and_pd(
+                _mm256_cmp_pd( q_min_y, _mm256_loadu_pd( b.max_y + i ), _CMP_LT_OQ ),
+                _mm256_cmp_pd( q_max_y, _mm256_loadu_pd( b.min_y + i ), _CMP_GT_OQ ) );
+        const auto z =
+            _mm256_and_pd(
+                _mm256_cmp_pd( q_min_z, _mm256_loadu_pd( b.max_z + i ), _CMP_LT_OQ ),
+                _mm256_cmp_pd( q_max_z, _mm256_loadu_pd( b.min_z + i ), _CMP_GT_OQ ) );
+
+        mask |= static_cast<std::uint32_t>( _mm256_movemask_pd( _mm256_and_pd( _mm256_and_pd( x, y ), z ) ) ) << i;
+    }
+
+    return mask;
+}
+
+#elif !defined(CODET_NO_SIMD) && defined(__SSE2__)
+
+inline
+std::uint32_t
+overlap_mask_simd(
+        const Node_BBox&                    bbox,
+        const SoA_Bounds_View<float>&       b,
+        const std::uint32_t                 count )
+{
+    const auto q_min_x = _mm_set1_ps( bbox.min[0u] );
+    const auto q_min_y = _mm_set1_ps( bbox.min[1u] );
+    const auto q_min_z = _mm_set1_ps( bbox.min[2u] );
+    const auto q_max_x = _mm_set1_ps( bbox.max[0u] );
+    const auto q_max_y = _mm_set1_ps( bbox.max[1u] );
+    const auto q_max_z = _mm_set1_ps( bbox.max[2u] );
+
+    std::uint32_t mask = 0u;
+
+    for( std::uint32_t i=0u; i<count; i+=4u )
+    {
+        const auto x =
+            _mm_and_ps(
+                _mm_cmplt_ps( q_min_x, _mm_loadu_ps( b.max_x + i ) ),
+                _mm_cmpgt_ps( q_max_x, _mm_loadu_ps( b.min_x + i ) ) );
+        const auto y =
+            _mm_and_ps(
+                _mm_cmplt_ps( q_min_y, _mm_loadu_ps( b.max_y + i ) ),
+                _mm_cmpgt_ps( q_max_y, _mm_loadu_ps( b.min_y + i ) ) );
+        const auto z =
+            _mm_and_ps(
+                _mm_cmplt_ps( q_min_z, _mm_loadu_ps( b.max_z + i ) ),
+                _mm_cmpgt_ps( q_max_z, _mm_loadu_ps( b.min_z + i ) ) );
+
+        mask |= static_cast<std::uint32_t>( _mm_movemask_ps( _mm_and_ps( _mm_and_ps( x, y ), z ) ) ) << i;
+    }
+
+    return mask;
+}
+
+inline
+std::uint32_t
+overlap_mask_simd(
+        const Node_BBox&                    bbox,
+        const SoA_Bounds_View<double>&      b,
+        const std::uint32_t                 count )
+{
+    const auto q_min_x = _mm_set1_pd( bbox.min[0u] );
+    const auto q_min_y = _mm_set1_pd( bbox.min[1u] );
+    const auto q_min_z = _mm_set1_pd( bbox.min[2u] );
+    const auto q_max_x = _mm_set1_pd( bbox.max[0u] );
+    const auto q_max_y = _mm_set1_pd( bbox.max[1u] );
+    const auto q_max_z = _mm_set1_pd( bbox.max[2u] );
+
+    std::uint32_t mask = 0u;
+
+    for( std::uint32_t i=0u; i<count; i+=2u )
+    {
+        const auto x =
+            _mm_and_pd(
+                _mm_cmplt_pd( q_min_x, _mm_loadu_pd( b.max_x + i ) ),
+                _mm_cmpgt_pd( q_max_x, _mm_loadu_pd( b.min_x + i ) ) );
+        const auto y =
+            _mm_and_pd(
+                _mm_cmplt_pd( q_min_y, _mm_loadu_pd( b.max_y + i ) ),
+                _mm_cmpgt_pd( q_max_y, _mm_loadu_pd( b.min_y + i ) ) );
+        const auto z =
+            _mm_and_pd(
+                _mm_cmplt_pd( q_min_z, _mm_loadu_pd( b.max_z + i ) ),
+                _mm_cmpgt_pd( q_max_z, _mm_loadu_pd( b.min_z + i ) ) );
+
+        mask |= static_cast<std::uint32_t>( _mm_movemask_pd( _mm_and_pd( _mm_and_pd( x, y ), z ) ) ) << i;
+    }
+
+    return mask;
+}
+
+#else
+
+template <typename T>
+std::uint32_t
+overlap_mask_simd(
+        const Node_BBox&                    bbox,
+        const SoA_Bounds_View<T>&           b,
+        const std::uint32_t                 count )
+{
+    std::uint32_t mask = 0u;
+
+    for( std::uint32_t i=0u; i<count; ++i )
+    {
+        const auto overlap =
+              (bbox.min[0u] < b.max_x[i]) & (bbox.max[0u] > b.min_x[i])
+            & (bbox.min[1u] < b.max_y[i]) & (bbox.max[1u] > b.min_y[i])
+            & (bbox.min[2u] < b.max_z[i]) & (bbox.max[2u] > b.min_z[i]);    // bitwise operator to remove dependency
+
+        mask |= static_cast<std::uint32_t>( overlap ) << i;
+    }
+
+    return mask;
+}
+
+#endif
+
+}
+
+/*  Test one box against count consecutive boxes of the SoA bounds.
+*
+*   Bit i of the result is set when the box overlaps box first+i.
+*   Boxes that only touch do not overlap, as in do_bbox_intersect.
+*   Uses AVX or SSE2 when the compiler targets them, scalar code otherwise
+*   or when CODET_NO_SIMD is defined. Single precision bounds fill twice
+*   as many lanes as double ones.
+*/
+inline
+std::uint32_t
+overlap_mask(
+        const Node_BBox&        bbox,
+        const Node_Bounds_View& soa,
+        const std::uint32_t     first,
+        const std::uint32_t     count )
+{
+    assert( count <= overlap_mask_width );
+    assert( first + count + Node_Bounds_SoA::padding <= soa.min[0u].size() );
+
+    const detail::SoA_Bounds_View<bound_t> bounds{
+        soa.min[0u].data() + first,
+        soa.min[1u].data() + first,
+        soa.min[2u].data() + first,
+        soa.max[0u].data() + first,
+        soa.max[1u].data() + first,
+        soa.max[2u].data() + first };
+
+    const auto mask = detail::overlap_mask_simd( bbox, bounds, count );
+
+    // drop lanes past count
+    return
+        (overlap_mask_width == count)
+            ? mask
+            : mask & ((1u << count) - 1u);
+}
+
+}
@@ -1,141 +1,1661 @@
 #include "BoundingVolumeHierarchy.h"
 #include "Pairwise_Pruning.h"
+#include "Task_Scheduler.h"
+#include "Overlap_Kernel.h"
+#include "Rigid_Transform.h"
+#include "Statistics.h"
 #include <tuple>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
 
 using namespace CoDet;
 
 namespace {
 
-/*  Check whether two bounding boxes intersect
+/*  do_bbox_intersect of two nodes, counted in the pruning statistics.
 */
 bool
-do_bbox_intersect(
-        const BBox bbox1,
-        const BBox bbox2 )
-{
-    assert( bbox1.min.data[0] <= bbox1.max.data[0] );
-    assert( bbox1.min.data[1] <= bbox1.max.data[1] );
-    assert( bbox1.min.data[2] <= bbox1.max.data[2] );
-    assert( bbox2.min.data[0] <= bbox2.max.data[0] );
-    assert( bbox2.min.data[1] <= bbox2.max.data[1] );
-    assert( bbox2.min.data[2] <= bbox2.max.data[2] );
-
-    const auto test_coordinate_intersection =
-        [&bbox1,&bbox2]
-        ( const unsigned int coord )
-        {
-            return
-                  (bbox1.min.data[coord] < bbox2.max.data[coord])
-                & (bbox1.max.data[coord] > bbox2.min.data[coord]);    // bitwise operator to remove dependency
-        };
+do_counted_bbox_intersect(
+        const Node_BBox& bbox1,
+        const Node_BBox& bbox2 )
+{
+    assert( bbox1.min[0] <= bbox1.max[0] );
+    assert( bbox1.min[1] <= bbox1.max[1] );
+    assert( bbox1.min[2] <= bbox1.max[2] );
+    assert( bbox2.min[0] <= bbox2.max[0] );
+    assert( bbox2.min[1] <= bbox2.max[1] );
+    assert( bbox2.min[2] <= bbox2.max[2] );
 
-    return
-          test_coordinate_intersection(0u)
-        & test_coordinate_intersection(1u)
-        & test_coordinate_intersection(2u);    // bitwise operator to remove dependency
+    const bool intersect = do_bbox_intersect( bbox1, bbox2 );
+
+    CODET_STATISTICS( detail::count_bbox_tests( 1u, intersect ? 1u : 0u ) );
+
+    return intersect;
 }
 
-/*    If interior node, return its children.
- *    If leaf, return vector comprised only of that leaf node.
+/*  Contiguous range of nodes in the flattened node array.
+*/
+struct
+Node_Range
+{
+    std::uint32_t   first;
+    std::uint32_t   count;
+};
+
+/*    If interior node, return range of its children.
+ *    If leaf, return range comprised only of that leaf node.
  * */
-auto
-get_vector_of_candidates(
-        const BVH_Node*const node )
+Node_Range
+get_range_of_candidates(
+        const Array_View<Compact_BVH_Node>&     nodes,
+        const std::uint32_t                     node_index )
 {
-    assert( nullptr != node );
-    assert(    (!node->get_child_volumes().empty() && nullptr == node->get_face())
-            || ( node->get_child_volumes().empty() && nullptr != node->get_face()) );
+    assert( node_index < nodes.size() );
+
+    const auto& node = nodes[node_index];
 
-    if ( !node->get_child_volumes().empty() )
+    if ( !is_leaf( node ) )
     {
-        return
-            generate_vector_of_pointers_to_elements(
-                node->get_child_volumes() );
+        return Node_Range{ node.first_child, node.child_count };
     }
 
-    return std::vector<const BVH_Node*>{node};
+    return Node_Range{ node_index, 1u };
 }
 
 bool
 both_candidates_are_leaf_nodes(
-        const BVH_Node& node1_child,
-        const BVH_Node& node2_child )
+        const Compact_BVH_Node& node1_child,
+        const Compact_BVH_Node& node2_child )
 {
     return
-          (node1_child.get_child_volumes().empty())
-        & (node2_child.get_child_volumes().empty());    // bitwise operator to remove dependency
+          is_leaf( node1_child )
+        & is_leaf( node2_child );    // bitwise operator to remove dependency
 }
 
+/*  Index of the face referenced by a leaf node.
+*/
+std::uint32_t
+get_leaf_face_index(
+        const BoundingVolumeHierarchy&  bvh,
+        const Compact_BVH_Node&         leaf )
+{
+    assert( is_leaf( leaf ) );
+
+    return bvh.get_face_order()[leaf.first_face];
 }
 
-pairwise_pruning_return_t
-CoDet::pairwise_pruning(
-        const BoundingVolumeHierarchy&    bvh1,
-        const BoundingVolumeHierarchy&    bvh2 )
+/*  Throws std::invalid_argument unless face pointers can be reported for
+*   both BVHs. BVHs built from an Indexed_Mesh have no Mesh_Face data,
+*   pruning them with a query reporting pointers would find no candidates.
+*/
+void
+require_face_data(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2 )
+{
+    if ( (nullptr == bvh1.get_mesh_faces()) || (nullptr == bvh2.get_mesh_faces()) )
+    {
+        throw std::invalid_argument( "BVH built from an Indexed_Mesh has no Mesh_Face data, use pairwise_pruning_face_indices" );
+    }
+}
+
+/*  Face at face_index of the Mesh_Face data the BVH references.
+*/
+const Mesh_Face*
+get_face_pointer(
+        const BoundingVolumeHierarchy&  bvh,
+        const std::uint32_t             face_index )
+{
+    // BVHs built from an Indexed_Mesh only report face indices
+    assert( nullptr != bvh.get_mesh_faces() );
+
+    return bvh.get_mesh_faces() + face_index;
+}
+
+using node_pair_t = pruning_node_pair_t;
+using detail::Pruning_Front_State;
+
+/*  Report candidate face pair, given by face indices, to a sink.
+*   Returns false when the sink wants traversal to stop.
+*/
+bool
+report_face_pair(
+        pairwise_pruning_return_t&      candidate_faces,
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2,
+        const std::uint32_t             face1,
+        const std::uint32_t             face2 )
+{
+    candidate_faces.emplace_back(
+        get_face_pointer( bvh1, face1 ),
+        get_face_pointer( bvh2, face2 ) );
+
+    return true;
+}
+
+bool
+report_face_pair(
+        pairwise_pruning_face_indices_t&    candidate_faces,
+        const BoundingVolumeHierarchy&,
+        const BoundingVolumeHierarchy&,
+        const std::uint32_t                 face1,
+        const std::uint32_t                 face2 )
+{
+    candidate_faces.emplace_back( face1, face2 );
+
+    return true;
+}
+
+bool
+report_face_pair(
+        const detail::Face_Pair_Visitor_Ref&    visitor,
+        const BoundingVolumeHierarchy&          bvh1,
+        const BoundingVolumeHierarchy&          bvh2,
+        const std::uint32_t                     face1,
+        const std::uint32_t                     face2 )
 {
-    pairwise_pruning_return_t                                   candidate_faces;
-    std::vector<std::tuple<const BVH_Node*,const BVH_Node*>>    candidates;
-    std::vector<std::tuple<const BVH_Node*,const BVH_Node*>>    new_candidates;
+    return
+        Visit_Result::proceed ==
+            visitor.visit(
+                visitor.visitor,
+                get_face_pointer( bvh1, face1 ),
+                get_face_pointer( bvh2, face2 ) );
+}
+
+/*  Sink of any_collision, first face pair is the answer. */
+struct
+First_Face_Pair
+{};
+
+bool
+report_face_pair(
+        const First_Face_Pair&,
+        const BoundingVolumeHierarchy&,
+        const BoundingVolumeHierarchy&,
+        const std::uint32_t,
+        const std::uint32_t )
+{
+    return false;
+}
 
-    const auto& root1 = bvh1.get_root();
-    const auto& root2 = bvh2.get_root();
+/*  Bounds of nodes of the first BVH, as tested against the second.
+*   Without transforms both BVHs share one frame.
+*/
+struct
+Same_Frame
+{
+    const Node_BBox&
+    operator()(
+            const Node_BBox& bbox ) const
+    {
+        return bbox;
+    }
+};
 
-    const auto bbox1 = root1.get_bbox();
-    const auto bbox2 = root2.get_bbox();
+/*  With rigid transforms, boxes of the first BVH are moved into the
+*   frame of the second and re-bounded there. Bounds of the second BVH
+*   are then tested as stored, in SoA layout.
+*/
+struct
+Relative_Frame
+{
+    Rigid_Transform first_to_second;
 
-    if ( false == do_bbox_intersect( bbox1, bbox2 ) )
+    Node_BBox
+    operator()(
+            const Node_BBox& bbox ) const
     {
-        return candidate_faces;
+        return transform_bbox( first_to_second, bbox );
     }
+};
 
-    candidates.emplace_back( &root1, &root2 );
+/*  Frame taking local coordinates of the first BVH to those of the second. */
+Relative_Frame
+make_relative_frame(
+        const Rigid_Transform& transform1,
+        const Rigid_Transform& transform2 )
+{
+    return Relative_Frame{ compose( inverse( transform2 ), transform1 ) };
+}
 
-    //    Take all current candidates and test their children against each other.
-    //    For those pairs of children where bboxes do intersect, add them to the
-    //    pool of candidates.
+/*  Bounds of the face at face order position slot of a leaf. */
+Node_BBox
+get_leaf_face_bbox(
+        const BoundingVolumeHierarchy&  bvh,
+        const Compact_BVH_Node&         leaf,
+        const std::uint32_t             slot )
+{
+    assert( is_leaf( leaf ) );
 
-    while( !candidates.empty() )
+    if ( 1u == leaf.face_count )
     {
-        for( const auto& candidate_pair : candidates )
+        return leaf.bbox;
+    }
+
+    return get_bbox( bvh.get_face_bounds(), slot );
+}
+
+/*  Test faces of two overlapping leaves against each other by brute force,
+*   each face of leaf1 against up to overlap_mask_width faces of leaf2 at once.
+*   Overlapping face pairs are reported to the sink.
+*   Returns false as soon as the face sink asks to stop.
+*/
+template <typename Face_sink, typename Frame>
+bool
+expand_leaf_pair(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2,
+        const Compact_BVH_Node&         leaf1,
+        const Compact_BVH_Node&         leaf2,
+        Face_sink&                      candidate_faces,
+        const Frame&                    to_frame2 )
+{
+    const auto& face_order1 = bvh1.get_face_order();
+    const auto& face_order2 = bvh2.get_face_order();
+
+    for( auto slot1=leaf1.first_face; slot1<leaf1.first_face+leaf1.face_count; ++slot1 )
+    {
+        const Node_BBox face_bbox1 = to_frame2( get_leaf_face_bbox( bvh1, leaf1, slot1 ) );
+
+        if ( 1u == leaf2.face_count )
+        {
+            const bool proceed =
+                !do_counted_bbox_intersect( face_bbox1, leaf2.bbox )
+                || report_face_pair(
+                        candidate_faces,
+                        bvh1,
+                        bvh2,
+                        face_order1[slot1],
+                        face_order2[leaf2.first_face] );
+
+            if ( !proceed )
+            {
+                return false;
+            }
+            continue;
+        }
+
+        for( std::uint32_t batch=0u; batch<leaf2.face_count; batch+=overlap_mask_width )
         {
-            const auto& node1 = std::get<0u>( candidate_pair );
-            const auto& node2 = std::get<1u>( candidate_pair );
+            auto mask =
+                overlap_mask(
+                    face_bbox1,
+                    bvh2.get_face_bounds(),
+                    leaf2.first_face + batch,
+                    std::min( overlap_mask_width, leaf2.face_count - batch ) );
+
+            CODET_STATISTICS( detail::count_bbox_tests( std::min( overlap_mask_width, leaf2.face_count - batch ), count_set_bits( mask ) ) );
+
+            while( 0u != mask )
+            {
+                const auto slot2 = leaf2.first_face + batch + lowest_set_bit( mask );
+                mask &= mask - 1u;
+
+                const bool proceed =
+                    report_face_pair(
+                        candidate_faces,
+                        bvh1,
+                        bvh2,
+                        face_order1[slot1],
+                        face_order2[slot2] );
+
+                if ( !proceed )
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/*  Test children of a candidate node pair against each other.
+*   Overlapping leaf pairs are reported as candidate faces,
+*   other overlapping pairs become new candidates.
+*   Returns false as soon as the face sink asks to stop.
+*/
+template <typename Face_sink, typename Candidate_container, typename Frame>
+bool
+expand_candidate_pair(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2,
+        const node_pair_t&              candidate_pair,
+        Face_sink&                      candidate_faces,
+        Candidate_container&            new_candidates,
+        const Frame&                    to_frame2 )
+{
+    const auto& nodes1 = bvh1.get_nodes();
+    const auto& nodes2 = bvh2.get_nodes();
+
+    const auto node1_candidates =
+        get_range_of_candidates( nodes1, std::get<0u>( candidate_pair ) );
+
+    const auto node2_candidates =
+        get_range_of_candidates( nodes2, std::get<1u>( candidate_pair ) );
+
+    assert( 0u != node1_candidates.count );
+    assert( 0u != node2_candidates.count );
 
-            assert( nullptr != node1 );
-            assert( nullptr != node2 );
+    CODET_STATISTICS( ++detail::get_thread_pruning_statistics().node_pairs_visited );
 
-            const auto& node1_candidates =
-                get_vector_of_candidates( node1 );
+    const auto& node_bounds2 = bvh2.get_node_bounds();
 
-            const auto& node2_candidates =
-                get_vector_of_candidates( node2 );
+    // test each node1 candidate against all node2 candidates at once
+    for( auto node1_child=node1_candidates.first; node1_child!=node1_candidates.first+node1_candidates.count; ++node1_child )
+    {
+        const auto& child1 = nodes1[node1_child];
+        const Node_BBox child1_bbox = to_frame2( child1.bbox );
+
+        for( std::uint32_t batch=0u; batch<node2_candidates.count; batch+=overlap_mask_width )
+        {
+            auto mask =
+                overlap_mask(
+                    child1_bbox,
+                    node_bounds2,
+                    node2_candidates.first + batch,
+                    std::min( overlap_mask_width, node2_candidates.count - batch ) );
 
-            assert( !node1_candidates.empty() );
-            assert( !node2_candidates.empty() );
+            CODET_STATISTICS( detail::count_bbox_tests( std::min( overlap_mask_width, node2_candidates.count - batch ), count_set_bits( mask ) ) );
 
-            for( const auto& node1_child : node1_candidates )
-            for( const auto& node2_child : node2_candidates )
+            while( 0u != mask )
             {
-                if ( do_bbox_intersect( node1_child->get_bbox(), node2_child->get_bbox() ) )
+                const auto node2_child = node2_candidates.first + batch + lowest_set_bit( mask );
+                mask &= mask - 1u;
+
+                const auto& child2 = nodes2[node2_child];
+
+                if ( both_candidates_are_leaf_nodes( child1, child2 ) )
                 {
-                    if ( both_candidates_are_leaf_nodes( *node1_child, *node2_child ) )
+                    CODET_STATISTICS( ++detail::get_thread_pruning_statistics().leaf_pairs );
+
+                    // single face leaves are bounded exactly by the leaf bounds
+                    const bool proceed =
+                        ( (1u == child1.face_count) & (1u == child2.face_count) )
+                            ? report_face_pair(
+                                candidate_faces,
+                                bvh1,
+                                bvh2,
+                                get_leaf_face_index( bvh1, child1 ),
+                                get_leaf_face_index( bvh2, child2 ) )
+                            : expand_leaf_pair(
+                                bvh1,
+                                bvh2,
+                                child1,
+                                child2,
+                                candidate_faces,
+                                to_frame2 );
+
+                    if ( !proceed )
                     {
-                        candidate_faces.emplace_back(
-                            node1_child->get_face(),
-                            node2_child->get_face() );
-                    } else {
-                        new_candidates.emplace_back(
-                            node1_child,
-                            node2_child );
+                        return false;
                     }
+                } else {
+                    new_candidates.emplace_back(
+                        node1_child,
+                        node2_child );
                 }
             }
         }
+    }
 
-        new_candidates.swap( candidates );
-        new_candidates.clear();
+    return true;
+}
+
+/*  Parent and depth of every node, children are stored after their parent. */
+void
+compute_parents(
+        const Array_View<Compact_BVH_Node>&     nodes,
+        std::vector<std::uint32_t>&             parents,
+        std::vector<std::uint32_t>&             depths )
+{
+    parents.assign( nodes.size(), 0u );
+    depths.assign( nodes.size(), 0u );
+
+    for( std::uint32_t node=0u; node<nodes.size(); ++node )
+    {
+        if ( is_leaf( nodes[node] ) )
+        {
+            continue;
+        }
+
+        for( auto child=nodes[node].first_child; child<nodes[node].first_child+nodes[node].child_count; ++child )
+        {
+            assert( child > node );
+
+            parents[child]  = node;
+            depths[child]   = depths[node] + 1u;
+        }
     }
+}
 
-    return candidate_faces;
+/*  Node pair whose expansion produced pair.
+*
+*   Traversal descends both trees at once and a leaf stays in place
+*   while the other tree is descended further. So the deeper node of
+*   a pair, both if equally deep, was reached in the last step.
+*/
+node_pair_t
+get_parent_pair(
+        const Pruning_Front_State&  front,
+        const std::uint32_t         node1,
+        const std::uint32_t         node2 )
+{
+    assert( (0u != node1) | (0u != node2) );
+
+    const auto depth = std::max( front.depths1[node1], front.depths2[node2] );
+
+    return
+        node_pair_t(
+            (front.depths1[node1] == depth) ? front.parents1[node1] : node1,
+            (front.depths2[node2] == depth) ? front.parents2[node2] : node2 );
+}
+
+/*  Bounds of a node of the first BVH in the frame of the second. Front
+*   pairs share nodes, so posed bounds are computed once per query.
+*/
+const Node_BBox&
+get_frame_bbox1(
+        Pruning_Front_State&    front,
+        const std::uint32_t     node1,
+        const Same_Frame& )
+{
+    return front.bvh1->get_nodes()[node1].bbox;
+}
+
+template <typename Frame>
+const Node_BBox&
+get_frame_bbox1(
+        Pruning_Front_State&    front,
+        const std::uint32_t     node1,
+        const Frame&            to_frame2 )
+{
+    if ( front.frame_stamps1[node1] != front.query_stamp )
+    {
+        front.frame_bounds1[node1] = to_frame2( front.bvh1->get_nodes()[node1].bbox );
+        front.frame_stamps1[node1] = front.query_stamp;
+    }
+
+    return front.frame_bounds1[node1];
+}
+
+using Front_Pair = Pruning_Front_State::Front_Pair;
+
+/*  Empty front for the current nodes of both BVHs. */
+void
+reset_front(
+        Pruning_Front_State&    front )
+{
+    const auto& nodes1 = front.bvh1->get_nodes();
+    const auto& nodes2 = front.bvh2->get_nodes();
+
+    front.build_generation1 = front.bvh1->get_build_generation();
+    front.build_generation2 = front.bvh2->get_build_generation();
+
+    compute_parents( nodes1, front.parents1, front.depths1 );
+    compute_parents( nodes2, front.parents2, front.depths2 );
+
+    front.pairs.clear();
+    front.frame_bounds1.resize( nodes1.size() );
+    front.frame_stamps1.assign( nodes1.size(), 0u );
+    front.query_stamp = 0u;
+}
+
+/*  Front pair of node1 and node2, expanded from parent_pair. */
+Front_Pair
+make_front_pair(
+        const Pruning_Front_State&  front,
+        const std::uint32_t         node1,
+        const std::uint32_t         node2,
+        const node_pair_t&          parent_pair )
+{
+    const auto parent1 = std::get<0u>( parent_pair );
+    const auto parent2 = std::get<1u>( parent_pair );
+
+    return
+        Front_Pair{
+            node1,
+            node2,
+            parent1,
+            parent2,
+              get_range_of_candidates( front.bvh1->get_nodes(), parent1 ).count
+            * get_range_of_candidates( front.bvh2->get_nodes(), parent2 ).count,
+            0u };
+}
+
+/*  Front pair of the roots, the only one without parent. */
+Front_Pair
+make_root_front_pair()
+{
+    return Front_Pair{ 0u, 0u, 0u, 0u, 0u, 0u };
+}
+
+/*  Append a pair whose bounds are disjoint to the new front.
+*   Once all pairs expanded from a parent pair are separated and
+*   the parent pair is disjoint too, they are replaced by the parent,
+*   up as far as that holds.
+*/
+template <typename Frame>
+void
+push_separated_pair(
+        Pruning_Front_State&    front,
+        Front_Pair              pair,
+        const Frame&            to_frame2 )
+{
+    auto& new_pairs = front.new_pairs;
+
+    for( ;; )
+    {
+        // siblings are expanded next to each other, so separated ones form a run
+        pair.separated_run = 1u;
+
+        if ( !new_pairs.empty() )
+        {
+            const auto& previous = new_pairs.back();
+
+            const bool is_separated_sibling =
+                  (0u != previous.separated_run)
+                & (previous.parent1 == pair.parent1)
+                & (previous.parent2 == pair.parent2)
+                & (0u != pair.number_of_siblings);
+
+            if ( is_separated_sibling )
+            {
+                pair.separated_run = previous.separated_run + 1u;
+            }
+        }
+
+        new_pairs.push_back( pair );
+
+        if (   (pair.separated_run != pair.number_of_siblings)
+            || do_counted_bbox_intersect(
+                    get_frame_bbox1( front, pair.parent1, to_frame2 ),
+                    front.bvh2->get_nodes()[pair.parent2].bbox ) )
+        {
+            return;
+        }
+
+        new_pairs.resize( new_pairs.size() - pair.number_of_siblings );
+
+        const bool parent_is_root = (0u == pair.parent1) & (0u == pair.parent2);
+
+        pair =
+            parent_is_root
+                ? make_root_front_pair()
+                : make_front_pair(
+                    front,
+                    pair.parent1,
+                    pair.parent2,
+                    get_parent_pair( front, pair.parent1, pair.parent2 ) );
+    }
+}
+
+/*  Handle a front pair whose bounds overlap. A leaf pair reports its
+*   candidate faces and stays in the new front, other pairs push the pairs
+*   of their children to the stack.
+*/
+template <typename Face_sink, typename Frame>
+void
+expand_front_pair(
+        Pruning_Front_State&    front,
+        const Front_Pair&       pair,
+        Face_sink&              candidate_faces,
+        const Frame&            to_frame2 )
+{
+    const auto& bvh1 = *front.bvh1;
+    const auto& bvh2 = *front.bvh2;
+
+    const auto& nodes1 = bvh1.get_nodes();
+    const auto& nodes2 = bvh2.get_nodes();
+
+    const auto& node1 = nodes1[pair.node1];
+    const auto& node2 = nodes2[pair.node2];
+
+    if ( both_candidates_are_leaf_nodes( node1, node2 ) )
+    {
+        CODET_STATISTICS( ++detail::get_thread_pruning_statistics().leaf_pairs );
+
+        if ( (1u == node1.face_count) & (1u == node2.face_count) )
+        {
+            report_face_pair(
+                candidate_faces,
+                bvh1,
+                bvh2,
+                get_leaf_face_index( bvh1, node1 ),
+                get_leaf_face_index( bvh2, node2 ) );
+        } else {
+            expand_leaf_pair(
+                bvh1,
+                bvh2,
+                node1,
+                node2,
+                candidate_faces,
+                to_frame2 );
+        }
+
+        front.new_pairs.push_back( pair );
+        front.new_pairs.back().separated_run = 0u;
+
+        return;
+    }
+
+    CODET_STATISTICS( ++detail::get_thread_pruning_statistics().node_pairs_visited );
+
+    const auto children1 = get_range_of_candidates( nodes1, pair.node1 );
+    const auto children2 = get_range_of_candidates( nodes2, pair.node2 );
+
+    // pushed in reverse, so that expanded pairs enter the front in order
+    for( auto child1=children1.first+children1.count; child1-- > children1.first; )
+    for( auto child2=children2.first+children2.count; child2-- > children2.first; )
+    {
+        front.stack.push_back(
+            Front_Pair{
+                child1,
+                child2,
+                pair.node1,
+                pair.node2,
+                children1.count * children2.count,
+                0u } );
+    }
+}
+
+/*  Move the front to the current bounds of both BVHs, reporting
+*   candidate faces of overlapping leaf pairs on the way.
+*/
+template <typename Face_sink, typename Frame>
+void
+update_front(
+        Pruning_Front_State&    front,
+        Face_sink&              candidate_faces,
+        const Frame&            to_frame2 )
+{
+    assert( nullptr != front.bvh1 );
+    assert( nullptr != front.bvh2 );
+
+    const auto& bvh1 = *front.bvh1;
+    const auto& bvh2 = *front.bvh2;
+
+    const auto& nodes1 = bvh1.get_nodes();
+    const auto& nodes2 = bvh2.get_nodes();
+
+    // a rebuilt or reassigned BVH has other nodes, start over from the roots
+    if (   (bvh1.get_build_generation() != front.build_generation1)
+        || (bvh2.get_build_generation() != front.build_generation2)
+        || (nodes1.size() != front.parents1.size())
+        || (nodes2.size() != front.parents2.size()) )
+    {
+        reset_front( front );
+    }
+
+    candidate_faces.clear();
+    front.new_pairs.clear();
+
+    // posed bounds of earlier queries go stale
+    if ( 0u == ++front.query_stamp )
+    {
+        std::fill( front.frame_stamps1.begin(), front.frame_stamps1.end(), 0u );
+        front.query_stamp = 1u;
+    }
+
+    if ( front.pairs.empty() )
+    {
+        front.pairs.push_back( make_root_front_pair() );
+    }
+
+    const auto& pairs = front.pairs;
+    const auto& node_bounds2 = bvh2.get_node_bounds();
+
+    auto& stack = front.stack;
+
+    for( std::size_t first=0u; first<pairs.size(); )
+    {
+        // siblings stay next to each other in the front, so pairs of one node1
+        // with consecutive node2 are re-tested by one overlap_mask call
+        const auto node1 = pairs[first].node1;
+        const auto node2 = pairs[first].node2;
+
+        std::uint32_t count = 1u;
+        while(   (count < overlap_mask_width)
+              && (first + count < pairs.size())
+              && (pairs[first + count].node1 == node1)
+              && (pairs[first + count].node2 == node2 + count) )
+        {
+            ++count;
+        }
+
+        const auto mask =
+            overlap_mask(
+                get_frame_bbox1( front, node1, to_frame2 ),
+                node_bounds2,
+                node2,
+                count );
+
+        CODET_STATISTICS( detail::count_bbox_tests( count, count_set_bits( mask ) ) );
+
+        for( std::uint32_t i=0u; i<count; ++i )
+        {
+            if ( 0u == ((mask >> i) & 1u) )
+            {
+                push_separated_pair( front, pairs[first + i], to_frame2 );
+                continue;
+            }
+
+            // only pairs that overlap are descended, or kept as leaf pairs
+            stack.clear();
+            expand_front_pair( front, pairs[first + i], candidate_faces, to_frame2 );
+
+            while( !stack.empty() )
+            {
+                const auto pair = stack.back();
+                stack.pop_back();
+
+                if ( !do_counted_bbox_intersect( get_frame_bbox1( front, pair.node1, to_frame2 ), nodes2[pair.node2].bbox ) )
+                {
+                    push_separated_pair( front, pair, to_frame2 );
+                } else {
+                    expand_front_pair( front, pair, candidate_faces, to_frame2 );
+                }
+            }
+        }
+
+        first += count;
+    }
+
+    std::swap( front.pairs, front.new_pairs );
+
+    CODET_STATISTICS( detail::count_frontier( front.pairs.size() ) );
 }
 
+/*  Number of node pairs the depth-first traversal keeps on the call stack. */
+constexpr std::size_t traversal_stack_capacity = 256u;
+
+/*  LIFO of node pairs for depth-first traversal.
+*
+*   Pairs live in a fixed array, only pairs pushed while it is full
+*   go to the heap. Those are the most recent ones, so they are popped
+*   first and order stays LIFO. Every expanded pair pushes up to one pair
+*   per pair of overlapping children, and all but one of those wait while
+*   the last is expanded. So the stack holds up to about
+*   (depth1 + depth2) * (max_children1 * max_children2 - 1) pairs, which
+*   for Naive_Oct_Split trees with up to 64 pairs per expansion can go
+*   past the fixed array. The heap part has no limit of its own, it is
+*   the caller's buffer, reused between queries given the same context.
+*/
+class
+Traversal_Stack
+{
+private:
+    node_pair_t                 pairs[traversal_stack_capacity];
+    std::size_t                 size;
+    std::vector<node_pair_t>&   overflow;
+public:
+    explicit
+    Traversal_Stack(
+            std::vector<node_pair_t>& overflow )
+        :   size        (0u)
+        ,   overflow    (overflow)
+    {
+        overflow.clear();
+    }
+public:
+    bool
+    empty() const
+    {
+        return 0u == size;
+    }
+public:
+    void
+    emplace_back(
+            const std::uint32_t node1,
+            const std::uint32_t node2 )
+    {
+        if ( size < traversal_stack_capacity )
+        {
+            pairs[size] = node_pair_t( node1, node2 );
+        } else {
+            overflow.emplace_back( node1, node2 );
+        }
+        ++size;
+
+        CODET_STATISTICS( detail::count_frontier( size ) );
+    }
+public:
+    node_pair_t
+    pop()
+    {
+        assert( !empty() );
+
+        --size;
+        if ( size < traversal_stack_capacity )
+        {
+            return pairs[size];
+        }
+
+        const auto pair = overflow.back();
+        overflow.pop_back();
+
+        return pair;
+    }
+};
+
+/*  Depth-first traversal of both trees, candidate face pairs go to sink.
+*   Returns false when the sink stopped it early.
+*/
+template <typename Face_sink, typename Frame>
+bool
+traverse_depth_first(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2,
+        Traversal_Stack&                stack,
+        Face_sink&                      candidate_faces,
+        const Frame&                    to_frame2 )
+{
+    const Node_BBox bbox1 = to_frame2( bvh1.get_nodes()[0u].bbox );
+    const auto bbox2 = bvh2.get_nodes()[0u].bbox;
+
+    if ( false == do_counted_bbox_intersect( bbox1, bbox2 ) )
+    {
+        return true;
+    }
+
+    stack.emplace_back( 0u, 0u );
+
+    //    Expand the most recently found pair first, descending into
+    //    a subtree while bounds of its nodes are still in cache.
+
+    while( !stack.empty() )
+    {
+        const bool proceed =
+            expand_candidate_pair(
+                bvh1,
+                bvh2,
+                stack.pop(),
+                candidate_faces,
+                stack,
+                to_frame2 );
+
+        if ( !proceed )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*  Output buffers of one chunk of the candidate frontier,
+*   owned by whichever thread processes that chunk.
+*/
+template <typename Candidate_faces>
+struct
+Chunk_Output
+{
+    Candidate_faces             candidate_faces;
+    std::vector<node_pair_t>    new_candidates;
+    Pruning_Statistics          statistics;
+};
+
+/*  Level by level traversal, candidate face pairs go to candidate_faces.
+*/
+template <typename Candidate_faces, typename Frame>
+void
+traverse_breadth_first(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2,
+        std::vector<node_pair_t>&       candidates,
+        std::vector<node_pair_t>&       new_candidates,
+        Candidate_faces&                candidate_faces,
+        const Frame&                    to_frame2 )
+{
+    candidate_faces.clear();
+    candidates.clear();
+    new_candidates.clear();
+
+    const Node_BBox bbox1 = to_frame2( bvh1.get_nodes()[0u].bbox );
+    const auto bbox2 = bvh2.get_nodes()[0u].bbox;
+
+    if ( false == do_counted_bbox_intersect( bbox1, bbox2 ) )
+    {
+        return;
+    }
+
+    candidates.emplace_back( 0u, 0u );
+
+    //    Take all current candidates and test their children against each other.
+    //    For those pairs of children where bboxes do intersect, add them to the
+    //    pool of candidates.
+
+    while( !candidates.empty() )
+    {
+        CODET_STATISTICS( detail::count_frontier( candidates.size() ) );
+
+        for( const auto& candidate_pair : candidates )
+        {
+            expand_candidate_pair(
+                bvh1,
+                bvh2,
+                candidate_pair,
+                candidate_faces,
+                new_candidates,
+                to_frame2 );
+        }
+
+        new_candidates.swap( candidates );
+        new_candidates.clear();
+    }
+}
+
+/*  Multithreaded variant of traverse_breadth_first.
+*/
+template <typename Candidate_faces>
+void
+traverse_breadth_first_parallel(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2,
+        Task_Scheduler&                 scheduler,
+        const std::size_t               min_chunk_size,
+        Candidate_faces&                candidate_faces )
+{
+    assert( 0u != min_chunk_size );
+
+    std::vector<node_pair_t> candidates;
+
+    const auto bbox1 = bvh1.get_nodes()[0u].bbox;
+    const auto bbox2 = bvh2.get_nodes()[0u].bbox;
+
+    if ( false == do_counted_bbox_intersect( bbox1, bbox2 ) )
+    {
+        return;
+    }
+
+    candidates.emplace_back( 0u, 0u );
+
+    // a few chunks per thread, so that stealing can balance uneven chunks
+    const std::size_t max_chunks = 4u * scheduler.get_number_of_threads();
+    std::vector<Chunk_Output<Candidate_faces>> chunks( max_chunks );
+
+    //    Same level by level expansion as the serial version, with every level
+    //    split into chunks. Each chunk writes to its own buffers, which are
+    //    concatenated once the level is done.
+
+    while( !candidates.empty() )
+    {
+        CODET_STATISTICS( detail::count_frontier( candidates.size() ) );
+
+        const auto number_of_chunks =
+            std::max<std::size_t>(
+                1u,
+                std::min( max_chunks, candidates.size() / min_chunk_size ) );
+
+        const auto chunk_size = (candidates.size() + number_of_chunks - 1u) / number_of_chunks;
+
+        const auto process_chunk =
+            [&bvh1,&bvh2,&candidates,&chunks,chunk_size]
+            ( const std::size_t chunk )
+            {
+                const auto begin = chunk * chunk_size;
+                const auto end   = std::min( begin + chunk_size, candidates.size() );
+
+                // chunks run on any thread, counts go to the chunk and from there to the caller
+                CODET_STATISTICS( const auto thread_statistics = detail::get_thread_pruning_statistics() );
+                CODET_STATISTICS( detail::get_thread_pruning_statistics() = Pruning_Statistics() );
+
+                for( auto candidate=begin; candidate<end; ++candidate )
+                {
+                    expand_candidate_pair(
+                        bvh1,
+                        bvh2,
+                        candidates[candidate],
+                        chunks[chunk].candidate_faces,
+                        chunks[chunk].new_candidates,
+                        Same_Frame() );
+                }
+
+                CODET_STATISTICS( detail::add_pruning_statistics( chunks[chunk].statistics, detail::get_thread_pruning_statistics() ) );
+                CODET_STATISTICS( detail::get_thread_pruning_statistics() = thread_statistics );
+            };
+
+        if ( 1u == number_of_chunks )
+        {
+            process_chunk( 0u );
+        } else {
+            Task_Scheduler::Task_Group group( scheduler );
+
+            for( std::size_t chunk=0u; chunk<number_of_chunks; ++chunk )
+            {
+                group.spawn(
+                    [&process_chunk,chunk]
+                    ()
+                    {
+                        process_chunk( chunk );
+                    } );
+            }
+
+            group.wait();
+        }
+
+        candidates.clear();
+        for( auto& chunk : chunks )
+        {
+            candidates.insert(
+                candidates.end(),
+                chunk.new_candidates.begin(),
+                chunk.new_candidates.end() );
+            chunk.new_candidates.clear();
+
+            CODET_STATISTICS( detail::add_pruning_statistics( detail::get_thread_pruning_statistics(), chunk.statistics ) );
+            CODET_STATISTICS( chunk.statistics = Pruning_Statistics() );
+        }
+    }
+
+    std::size_t number_of_candidate_faces = 0u;
+    for( const auto& chunk : chunks )
+    {
+        number_of_candidate_faces += chunk.candidate_faces.size();
+    }
+
+    candidate_faces.reserve( number_of_candidate_faces );
+    for( const auto& chunk : chunks )
+    {
+        candidate_faces.insert(
+            candidate_faces.end(),
+            chunk.candidate_faces.begin(),
+            chunk.candidate_faces.end() );
+    }
+}
+
+/*  Whether two faces of the mesh a BVH was built from share a vertex.
+*   Faces of an Indexed_Mesh share one by index, others by position,
+*   copies of a shared vertex are equal.
+*/
+bool
+share_vertex(
+        const BoundingVolumeHierarchy&  bvh,
+        const std::uint32_t             face1,
+        const std::uint32_t             face2 )
+{
+    if ( nullptr == bvh.get_mesh_faces() )
+    {
+        const auto* const triangle1 = bvh.get_indexed_mesh().get_triangle( face1 );
+        const auto* const triangle2 = bvh.get_indexed_mesh().get_triangle( face2 );
+
+        return
+            std::any_of(
+                triangle1,
+                triangle1 + 3u,
+                [triangle2]
+                ( const std::uint32_t vertex )
+                {
+                    return std::find( triangle2, triangle2 + 3u, vertex ) != triangle2 + 3u;
+                } );
+    }
+
+    const auto& vertices1 = bvh.get_mesh_faces()[face1].vertices;
+    const auto& vertices2 = bvh.get_mesh_faces()[face2].vertices;
+
+    return
+        std::any_of(
+            vertices1.begin(),
+            vertices1.end(),
+            [&vertices2]
+            ( const Point& vertex )
+            {
+                return std::find( vertices2.begin(), vertices2.end(), vertex ) != vertices2.end();
+            } );
+}
+
+/*  Sink of self_pruning, each unordered face pair once as
+*   (lower index, higher index), optionally without adjacent faces.
+*/
+struct
+Self_Face_Pairs
+{
+    pairwise_pruning_face_indices_t&    candidate_faces;
+    const Adjacent_Faces                adjacent_faces;
+};
+
+bool
+report_face_pair(
+        Self_Face_Pairs&                sink,
+        const BoundingVolumeHierarchy&  bvh,
+        const BoundingVolumeHierarchy&,
+        const std::uint32_t             face1,
+        const std::uint32_t             face2 )
+{
+    assert( face1 != face2 );
+
+    if ( (Adjacent_Faces::skip == sink.adjacent_faces) && share_vertex( bvh, face1, face2 ) )
+    {
+        return true;
+    }
+
+    sink.candidate_faces.emplace_back(
+        std::min( face1, face2 ),
+        std::max( face1, face2 ) );
+
+    return true;
+}
+
+/*  Report overlapping pairs of distinct faces within one leaf. */
+template <typename Face_sink>
+void
+expand_self_leaf(
+        const BoundingVolumeHierarchy&  bvh,
+        const Compact_BVH_Node&         leaf,
+        Face_sink&                      candidate_faces )
+{
+    const auto& face_order = bvh.get_face_order();
+
+    for( auto slot1=leaf.first_face; slot1<leaf.first_face+leaf.face_count; ++slot1 )
+    for( auto slot2=slot1+1u; slot2<leaf.first_face+leaf.face_count; ++slot2 )
+    {
+        if ( do_counted_bbox_intersect( get_leaf_face_bbox( bvh, leaf, slot1 ), get_leaf_face_bbox( bvh, leaf, slot2 ) ) )
+        {
+            report_face_pair(
+                candidate_faces,
+                bvh,
+                bvh,
+                face_order[slot1],
+                face_order[slot2] );
+        }
+    }
+}
+
+/*  Self-intersection traversal of a single BVH.
+*
+*   Faces of two distinct subtrees can only meet below a pair of
+*   siblings, so every interior node pairs each child with the children
+*   after it, and every leaf pairs its own faces. Sibling pairs then go
+*   through the usual breadth-first traversal. Subtrees of a sibling pair
+*   are disjoint, so each unordered pair of distinct faces comes up once.
+*/
+template <typename Face_sink>
+void
+traverse_self(
+        const BoundingVolumeHierarchy&  bvh,
+        std::vector<node_pair_t>&       candidates,
+        std::vector<node_pair_t>&       new_candidates,
+        Face_sink&                      candidate_faces )
+{
+    candidates.clear();
+    new_candidates.clear();
+
+    const auto& nodes = bvh.get_nodes();
+    const auto& node_bounds = bvh.get_node_bounds();
+
+    for( std::uint32_t node=0u; node<nodes.size(); ++node )
+    {
+        const auto& parent = nodes[node];
+
+        if ( is_leaf( parent ) )
+        {
+            expand_self_leaf( bvh, parent, candidate_faces );
+            continue;
+        }
+
+        const auto last_child = parent.first_child + parent.child_count;
+
+        CODET_STATISTICS( ++detail::get_thread_pruning_statistics().node_pairs_visited );
+
+        for( auto child1=parent.first_child; child1<last_child; ++child1 )
+        {
+            const auto& node1 = nodes[child1];
+
+            for( auto batch=child1+1u; batch<last_child; batch+=overlap_mask_width )
+            {
+                auto mask =
+                    overlap_mask(
+                        node1.bbox,
+                        node_bounds,
+                        batch,
+                        std::min( overlap_mask_width, last_child - batch ) );
+
+                CODET_STATISTICS( detail::count_bbox_tests( std::min( overlap_mask_width, last_child - batch ), count_set_bits( mask ) ) );
+
+                while( 0u != mask )
+                {
+                    const auto child2 = batch + lowest_set_bit( mask );
+                    mask &= mask - 1u;
+
+                    const auto& node2 = nodes[child2];
+
+                    if ( !both_candidates_are_leaf_nodes( node1, node2 ) )
+                    {
+                        candidates.emplace_back( child1, child2 );
+                    }
+                    else if ( (1u == node1.face_count) & (1u == node2.face_count) )
+                    {
+                        CODET_STATISTICS( ++detail::get_thread_pruning_statistics().leaf_pairs );
+
+                        report_face_pair(
+                            candidate_faces,
+                            bvh,
+                            bvh,
+                            get_leaf_face_index( bvh, node1 ),
+                            get_leaf_face_index( bvh, node2 ) );
+                    } else {
+                        CODET_STATISTICS( ++detail::get_thread_pruning_statistics().leaf_pairs );
+
+                        expand_leaf_pair(
+                            bvh,
+                            bvh,
+                            node1,
+                            node2,
+                            candidate_faces,
+                            Same_Frame() );
+                    }
+                }
+            }
+        }
+    }
+
+    while( !candidates.empty() )
+    {
+        CODET_STATISTICS( detail::count_frontier( candidates.size() ) );
+
+        for( const auto& candidate_pair : candidates )
+        {
+            expand_candidate_pair(
+                bvh,
+                bvh,
+                candidate_pair,
+                candidate_faces,
+                new_candidates,
+                Same_Frame() );
+        }
+
+        candidates.clear();
+        std::swap( candidates, new_candidates );
+    }
+}
+
+}
+
+pairwise_pruning_return_t
+CoDet::pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 )
+{
+    Pruning_Context context;
+
+    pairwise_pruning( bvh1, bvh2, context );
+
+    return std::move( context.candidate_faces );
+}
+
+const pairwise_pruning_return_t&
+CoDet::pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context )
+{
+    require_face_data( bvh1, bvh2 );
+
+    traverse_breadth_first(
+        bvh1,
+        bvh2,
+        context.candidates,
+        context.new_candidates,
+        context.candidate_faces,
+        Same_Frame() );
+
+    return context.candidate_faces;
+}
+
+pairwise_pruning_face_indices_t
+CoDet::pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 )
+{
+    Pruning_Context context;
+
+    pairwise_pruning_face_indices( bvh1, bvh2, context );
+
+    return std::move( context.candidate_face_indices );
+}
+
+const pairwise_pruning_face_indices_t&
+CoDet::pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context )
+{
+    traverse_breadth_first(
+        bvh1,
+        bvh2,
+        context.candidates,
+        context.new_candidates,
+        context.candidate_face_indices,
+        Same_Frame() );
+
+    return context.candidate_face_indices;
+}
+
+pairwise_pruning_return_t
+CoDet::pairwise_pruning_depth_first(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 )
+{
+    Pruning_Context context;
+
+    pairwise_pruning_depth_first( bvh1, bvh2, context );
+
+    return std::move( context.candidate_faces );
+}
+
+const pairwise_pruning_return_t&
+CoDet::pairwise_pruning_depth_first(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context )
+{
+    require_face_data( bvh1, bvh2 );
+
+    auto& candidate_faces = context.candidate_faces;
+
+    candidate_faces.clear();
+
+    // pairs past the fixed capacity spill into the context
+    Traversal_Stack stack( context.candidates );
+
+    traverse_depth_first(
+        bvh1,
+        bvh2,
+        stack,
+        candidate_faces,
+        Same_Frame() );
+
+    return candidate_faces;
+}
+
+Visit_Result
+CoDet::detail::pairwise_pruning_visit(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Face_Pair_Visitor_Ref&      visitor,
+        Pruning_Context&                  context )
+{
+    require_face_data( bvh1, bvh2 );
+
+    Traversal_Stack stack( context.candidates );
+
+    const bool completed =
+        traverse_depth_first(
+            bvh1,
+            bvh2,
+            stack,
+            visitor,
+            Same_Frame() );
+
+    return completed ? Visit_Result::proceed : Visit_Result::stop;
+}
+
+bool
+CoDet::any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 )
+{
+    Pruning_Context context;
+
+    return any_collision( bvh1, bvh2, context );
+}
+
+bool
+CoDet::any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context )
+{
+    Traversal_Stack stack( context.candidates );
+
+    First_Face_Pair first_face_pair;
+
+    // traversal stops at the first candidate face pair
+    return
+        !traverse_depth_first(
+            bvh1,
+            bvh2,
+            stack,
+            first_face_pair,
+            Same_Frame() );
+}
+
+pairwise_pruning_return_t
+CoDet::pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Task_Scheduler&                   scheduler,
+        const std::size_t                 min_chunk_size )
+{
+    require_face_data( bvh1, bvh2 );
+
+    pairwise_pruning_return_t candidate_faces;
+
+    traverse_breadth_first_parallel(
+        bvh1,
+        bvh2,
+        scheduler,
+        min_chunk_size,
+        candidate_faces );
+
+    return candidate_faces;
+}
+
+pairwise_pruning_face_indices_t
+CoDet::pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Task_Scheduler&                   scheduler,
+        const std::size_t                 min_chunk_size )
+{
+    pairwise_pruning_face_indices_t candidate_faces;
+
+    traverse_breadth_first_parallel(
+        bvh1,
+        bvh2,
+        scheduler,
+        min_chunk_size,
+        candidate_faces );
+
+    return candidate_faces;
+}
+
+pairwise_pruning_return_t
+CoDet::pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2 )
+{
+    Pruning_Context context;
+
+    pairwise_pruning( bvh1, transform1, bvh2, transform2, context );
+
+    return std::move( context.candidate_faces );
+}
+
+const pairwise_pruning_return_t&
+CoDet::pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2,
+        Pruning_Context&                  context )
+{
+    require_face_data( bvh1, bvh2 );
+
+    traverse_breadth_first(
+        bvh1,
+        bvh2,
+        context.candidates,
+        context.new_candidates,
+        context.candidate_faces,
+        make_relative_frame( transform1, transform2 ) );
+
+    return context.candidate_faces;
+}
+
+pairwise_pruning_face_indices_t
+CoDet::pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2 )
+{
+    Pruning_Context context;
+
+    pairwise_pruning_face_indices( bvh1, transform1, bvh2, transform2, context );
+
+    return std::move( context.candidate_face_indices );
+}
+
+const pairwise_pruning_face_indices_t&
+CoDet::pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2,
+        Pruning_Context&                  context )
+{
+    traverse_breadth_first(
+        bvh1,
+        bvh2,
+        context.candidates,
+        context.new_candidates,
+        context.candidate_face_indices,
+        make_relative_frame( transform1, transform2 ) );
+
+    return context.candidate_face_indices;
+}
+
+bool
+CoDet::any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2 )
+{
+    Pruning_Context context;
+
+    return any_collision( bvh1, transform1, bvh2, transform2, context );
+}
+
+bool
+CoDet::any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2,
+        Pruning_Context&                  context )
+{
+    Traversal_Stack stack( context.candidates );
+
+    First_Face_Pair first_face_pair;
+
+    return
+        !traverse_depth_first(
+            bvh1,
+            bvh2,
+            stack,
+            first_face_pair,
+            make_relative_frame( transform1, transform2 ) );
+}
+
+Pruning_Front
+Pruning_Front::make_pruning_front(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 )
+{
+    Pruning_Front front;
+    front.state.bvh1 = &bvh1;
+    front.state.bvh2 = &bvh2;
+
+    reset_front( front.state );
+
+    return front;
+}
+
+const pairwise_pruning_return_t&
+CoDet::pairwise_pruning(
+        Pruning_Front&                    front )
+{
+    auto& state = front.state;
+
+    require_face_data( *state.bvh1, *state.bvh2 );
+
+    update_front( state, state.candidate_faces, Same_Frame() );
+
+    return state.candidate_faces;
+}
+
+const pairwise_pruning_return_t&
+CoDet::pairwise_pruning(
+        Pruning_Front&                    front,
+        const Rigid_Transform&            transform1,
+        const Rigid_Transform&            transform2 )
+{
+    auto& state = front.state;
+
+    require_face_data( *state.bvh1, *state.bvh2 );
+
+    update_front( state, state.candidate_faces, make_relative_frame( transform1, transform2 ) );
+
+    return state.candidate_faces;
+}
+
+const pairwise_pruning_face_indices_t&
+CoDet::pairwise_pruning_face_indices(
+        Pruning_Front&                    front )
+{
+    auto& state = front.state;
+
+    update_front( state, state.candidate_face_indices, Same_Frame() );
+
+    return state.candidate_face_indices;
+}
+
+const pairwise_pruning_face_indices_t&
+CoDet::pairwise_pruning_face_indices(
+        Pruning_Front&                    front,
+        const Rigid_Transform&            transform1,
+        const Rigid_Transform&            transform2 )
+{
+    auto& state = front.state;
+
+    update_front( state, state.candidate_face_indices, make_relative_frame( transform1, transform2 ) );
+
+    return state.candidate_face_indices;
+}
+
+pairwise_pruning_face_indices_t
+CoDet::self_pruning(
+        const BoundingVolumeHierarchy&    bvh,
+        const Adjacent_Faces              adjacent_faces )
+{
+    Pruning_Context context;
+
+    self_pruning( bvh, context, adjacent_faces );
+
+    return std::move( context.candidate_face_indices );
+}
+
+const pairwise_pruning_face_indices_t&
+CoDet::self_pruning(
+        const BoundingVolumeHierarchy&    bvh,
+        Pruning_Context&                  context,
+        const Adjacent_Faces              adjacent_faces )
+{
+    context.candidate_face_indices.clear();
+
+    Self_Face_Pairs candidate_faces{ context.candidate_face_indices, adjacent_faces };
+
+    traverse_self(
+        bvh,
+        context.candidates,
+        context.new_candidates,
+        candidate_faces );
+
+    return context.candidate_face_indices;
+}
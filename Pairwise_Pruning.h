@@ -1,21 +1,461 @@
 #pragma once
 
 #include <vector>
+#include <tuple>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "BBox.h"
 
 namespace CoDet {
 
 // forward decls
 class BoundingVolumeHierarchy;
+class Task_Scheduler;
+struct Compact_BVH_Node;
 struct Mesh_Face;
+struct Rigid_Transform;
 
 // defines
 using pairwise_pruning_return_t = std::vector<std::tuple<const Mesh_Face*,const Mesh_Face*>>;
+using pruning_node_pair_t = std::tuple<std::uint32_t,std::uint32_t>;
+using pairwise_pruning_face_indices_t = std::vector<std::tuple<std::uint32_t,std::uint32_t>>;
 
-// THE pruning function
+/*  Buffers of a pruning query, owned by the caller.
+*
+*   Passing the same context to repeated queries reuses its capacity,
+*   so once buffers have grown to the size of the largest query, pruning
+*   does not allocate. One context serves one query at a time.
+*/
+struct
+Pruning_Context
+{
+    pairwise_pruning_return_t           candidate_faces;
+    pairwise_pruning_face_indices_t     candidate_face_indices;
+    std::vector<pruning_node_pair_t>    candidates;
+    std::vector<pruning_node_pair_t>    new_candidates;
+};
+
+namespace detail {
+
+/*  What a Pruning_Front keeps between queries, only its queries use it. */
+struct
+Pruning_Front_State
+{
+    struct
+    Front_Pair
+    {
+        std::uint32_t   node1;
+        std::uint32_t   node2;
+        std::uint32_t   parent1;            // pair this one was expanded from
+        std::uint32_t   parent2;
+        std::uint32_t   number_of_siblings; // pairs expanded from the parent pair, 0 for the roots
+        std::uint32_t   separated_run;      // separated siblings up to this pair, 0 if overlapping
+    };
+
+    const BoundingVolumeHierarchy*      bvh1;
+    const BoundingVolumeHierarchy*      bvh2;
+    std::uint64_t                       build_generation1;  // builds the parents were computed for
+    std::uint64_t                       build_generation2;
+    std::vector<std::uint32_t>          parents1;
+    std::vector<std::uint32_t>          depths1;
+    std::vector<std::uint32_t>          parents2;
+    std::vector<std::uint32_t>          depths2;
+    std::vector<Front_Pair>             pairs;
+    std::vector<Front_Pair>             new_pairs;
+    std::vector<Front_Pair>             stack;
+    std::vector<Node_BBox>              frame_bounds1;  // bounds of bvh1 nodes in the frame of bvh2
+    std::vector<std::uint32_t>          frame_stamps1;  // query the frame bounds were computed in
+    std::uint32_t                       query_stamp;
+    pairwise_pruning_return_t           candidate_faces;
+    pairwise_pruning_face_indices_t     candidate_face_indices;
+};
+
+}
+
+/*  Traversal state of repeated queries between the same two BVHs.
+*
+*   Keeps the front of the last query: node pairs whose bounds were
+*   disjoint and overlapping leaf pairs, in traversal order. The next
+*   query re-tests these pairs instead of starting from the roots,
+*   descends only below pairs that started to overlap, and collapses
+*   siblings that all separated into their parent pair once that is
+*   disjoint as well. With small motions between queries the front
+*   barely changes and a query costs about one bounds test per front pair.
+*
+*   Both BVHs have to outlive the front. Refitting them or moving them
+*   by rigid transforms between queries is what the front is for. If
+*   either was rebuilt or reassigned another build since the last query,
+*   told by its build generation, the query starts over from the roots.
+*/
+class
+Pruning_Front
+{
+private:
+    detail::Pruning_Front_State     state;
+public:
+    // empty front, the first query traverses from the roots
+    static
+    Pruning_Front
+    make_pruning_front(
+            const BoundingVolumeHierarchy&    bvh1,
+            const BoundingVolumeHierarchy&    bvh2 );
+public:
+    // node pairs in the front, disjoint node pairs and overlapping leaf pairs
+    std::size_t
+    size() const
+    {
+        return state.pairs.size();
+    }
+private:
+    friend
+    const pairwise_pruning_return_t&
+    pairwise_pruning(
+            Pruning_Front&                    front );
+
+    friend
+    const pairwise_pruning_return_t&
+    pairwise_pruning(
+            Pruning_Front&                    front,
+            const Rigid_Transform&            transform1,
+            const Rigid_Transform&            transform2 );
+
+    friend
+    const pairwise_pruning_face_indices_t&
+    pairwise_pruning_face_indices(
+            Pruning_Front&                    front );
+
+    friend
+    const pairwise_pruning_face_indices_t&
+    pairwise_pruning_face_indices(
+            Pruning_Front&                    front,
+            const Rigid_Transform&            transform1,
+            const Rigid_Transform&            transform2 );
+};
+
+// what a visitor of candidate face pairs tells the traversal
+enum class
+Visit_Result
+{
+    proceed,
+    stop
+};
+
+namespace detail {
+
+/*  Type erased reference to a face pair visitor, keeps the traversal
+*   out of this header. Costs an indirect call per candidate face pair,
+*   node pairs are tested without it.
+*/
+struct
+Face_Pair_Visitor_Ref
+{
+    void*           visitor;
+    Visit_Result    (*visit)( void*, const Mesh_Face*, const Mesh_Face* );
+};
+
+Visit_Result
+pairwise_pruning_visit(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Face_Pair_Visitor_Ref&      visitor,
+        Pruning_Context&                  context );
+
+template <typename Visitor>
+Visit_Result
+invoke_visitor(
+        Visitor&            visitor,
+        const Mesh_Face*    face1,
+        const Mesh_Face*    face2,
+        std::true_type      /*returns_void*/ )
+{
+    visitor( face1, face2 );
+
+    return Visit_Result::proceed;
+}
+
+template <typename Visitor>
+Visit_Result
+invoke_visitor(
+        Visitor&            visitor,
+        const Mesh_Face*    face1,
+        const Mesh_Face*    face2,
+        std::false_type     /*returns_void*/ )
+{
+    return visitor( face1, face2 );
+}
+
+template <typename Visitor>
+Visit_Result
+visit_face_pair(
+        void*               visitor,
+        const Mesh_Face*    face1,
+        const Mesh_Face*    face2 )
+{
+    auto& typed_visitor = *static_cast<Visitor*>( visitor );
+
+    return
+        invoke_visitor(
+            typed_visitor,
+            face1,
+            face2,
+            std::is_void<decltype( typed_visitor( face1, face2 ) )>() );
+}
+
+template <typename Visitor, typename = void>
+struct
+is_face_pair_visitor
+    : std::false_type
+{};
+
+template <typename Visitor>
+struct
+is_face_pair_visitor<
+        Visitor,
+        decltype( std::declval<Visitor&>()( std::declval<const Mesh_Face*>(), std::declval<const Mesh_Face*>() ), void() )>
+    : std::true_type
+{};
+
+}
+
+// THE pruning function.
+// Every query reporting Mesh_Face pointers, including visitors, output iterators
+// and the rigid, coherent and multithreaded variants, throws std::invalid_argument
+// if either BVH was built from an Indexed_Mesh, which has no Mesh_Face data to
+// point at. Use the pairwise_pruning_face_indices variants for those.
 pairwise_pruning_return_t
 pairwise_pruning(
         const BoundingVolumeHierarchy&    bvh1,
         const BoundingVolumeHierarchy&    bvh2 );
 
+// same, with buffers taken from context, result stays valid until its next use
+const pairwise_pruning_return_t&
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context );
+
+// candidate face pairs as indices into the meshes both BVHs were built from,
+// the only output of BVHs built from an Indexed_Mesh. 8 bytes per pair instead
+// of 16, and stays meaningful once sorted, stored or sent elsewhere.
+pairwise_pruning_face_indices_t
+pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 );
+
+const pairwise_pruning_face_indices_t&
+pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context );
+
+// depth-first variant, memory used by the traversal grows with depths of
+// both trees times the node pairs one expansion can push, up to
+// max_children1 * max_children2 (64 for Naive_Oct_Split), instead of with
+// the number of overlapping node pairs. It has no fixed limit: the first
+// 256 pairs are kept on the call stack, the rest in a heap buffer that grows
+// as needed. Every depth-first query given a context reuses its buffer,
+// the others start from an empty one.
+pairwise_pruning_return_t
+pairwise_pruning_depth_first(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 );
+
+const pairwise_pruning_return_t&
+pairwise_pruning_depth_first(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context );
+
+// streams candidate face pairs to visitor, depth-first, without storing them.
+// Visitor returns void, or Visit_Result::stop to end traversal early.
+// Returns Visit_Result::stop if it was ended early.
+template <
+    typename Visitor,
+    typename = std::enable_if_t<detail::is_face_pair_visitor<Visitor>::value>>
+Visit_Result
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Visitor&&                         visitor,
+        Pruning_Context&                  context )
+{
+    using visitor_t = std::remove_reference_t<Visitor>;
+
+    const detail::Face_Pair_Visitor_Ref visitor_ref{
+        const_cast<void*>( static_cast<const void*>( std::addressof( visitor ) ) ),
+        &detail::visit_face_pair<visitor_t> };
+
+    return detail::pairwise_pruning_visit( bvh1, bvh2, visitor_ref, context );
 }
 
+// same, with a traversal buffer of its own
+template <
+    typename Visitor,
+    typename = std::enable_if_t<detail::is_face_pair_visitor<Visitor>::value>>
+Visit_Result
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Visitor&&                         visitor )
+{
+    Pruning_Context context;
+
+    return pairwise_pruning( bvh1, bvh2, std::forward<Visitor>( visitor ), context );
+}
+
+// writes candidate face pairs to output iterator, returns iterator past the last one
+template <
+    typename Output_iterator,
+    typename = std::enable_if_t<!detail::is_face_pair_visitor<Output_iterator>::value>,
+    typename = typename std::iterator_traits<Output_iterator>::iterator_category>
+Output_iterator
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Output_iterator                   output )
+{
+    pairwise_pruning(
+        bvh1,
+        bvh2,
+        [&output]
+        ( const Mesh_Face* face1, const Mesh_Face* face2 )
+        {
+            *output = pairwise_pruning_return_t::value_type( face1, face2 );
+            ++output;
+        } );
+
+    return output;
+}
+
+// yes/no check whether bounds of any two faces overlap,
+// stops at the first candidate face pair
+bool
+any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2 );
+
+bool
+any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Pruning_Context&                  context );
+
+// rigidly posed variants. Each BVH is placed in the world by its transform,
+// the trees are not rebuilt. Bounds of bvh1 are moved into the frame of bvh2
+// and re-bounded by axis aligned boxes there, those are looser than the rotated
+// boxes but still contain them, so no pair of intersecting faces is missed.
+// Reported faces are the untransformed ones the BVHs were built from.
+pairwise_pruning_return_t
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2 );
+
+const pairwise_pruning_return_t&
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2,
+        Pruning_Context&                  context );
+
+pairwise_pruning_face_indices_t
+pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2 );
+
+const pairwise_pruning_face_indices_t&
+pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2,
+        Pruning_Context&                  context );
+
+bool
+any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2 );
+
+bool
+any_collision(
+        const BoundingVolumeHierarchy&    bvh1,
+        const Rigid_Transform&            transform1,
+        const BoundingVolumeHierarchy&    bvh2,
+        const Rigid_Transform&            transform2,
+        Pruning_Context&                  context );
+
+// coherent variants, the query starts from the front of the previous one
+// and moves it. Same candidates as a query from the roots, in another order.
+// Result stays valid until the next query of the front.
+const pairwise_pruning_return_t&
+pairwise_pruning(
+        Pruning_Front&                    front );
+
+const pairwise_pruning_return_t&
+pairwise_pruning(
+        Pruning_Front&                    front,
+        const Rigid_Transform&            transform1,
+        const Rigid_Transform&            transform2 );
+
+const pairwise_pruning_face_indices_t&
+pairwise_pruning_face_indices(
+        Pruning_Front&                    front );
+
+const pairwise_pruning_face_indices_t&
+pairwise_pruning_face_indices(
+        Pruning_Front&                    front,
+        const Rigid_Transform&            transform1,
+        const Rigid_Transform&            transform2 );
+
+// whether self_pruning reports pairs of faces sharing a vertex
+enum class
+Adjacent_Faces
+{
+    report,
+    skip
+};
+
+// candidate face pairs of a mesh with itself, for self-intersection.
+// Each unordered pair of distinct faces at most once, as (lower index, higher index).
+// Visits every node pair once, where passing one BVH to pairwise_pruning twice
+// visits it in both orders and pairs every face with itself.
+// Adjacent faces are found by vertex index for BVHs built from an Indexed_Mesh,
+// by vertex position otherwise.
+pairwise_pruning_face_indices_t
+self_pruning(
+        const BoundingVolumeHierarchy&    bvh,
+        const Adjacent_Faces              adjacent_faces = Adjacent_Faces::report );
+
+const pairwise_pruning_face_indices_t&
+self_pruning(
+        const BoundingVolumeHierarchy&    bvh,
+        Pruning_Context&                  context,
+        const Adjacent_Faces              adjacent_faces = Adjacent_Faces::report );
+
+// multithreaded variant, splits every level of the candidate frontier
+// into chunks of at least min_chunk_size node pairs
+pairwise_pruning_return_t
+pairwise_pruning(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Task_Scheduler&                   scheduler,
+        const std::size_t                 min_chunk_size = 256u );
+
+pairwise_pruning_face_indices_t
+pairwise_pruning_face_indices(
+        const BoundingVolumeHierarchy&    bvh1,
+        const BoundingVolumeHierarchy&    bvh2,
+        Task_Scheduler&                   scheduler,
+        const std::size_t                 min_chunk_size = 256u );
+
+}
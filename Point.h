@@ -44,6 +44,21 @@ operator+(
             } );
 }
 
+inline
+Point
+operator-(
+        const Point& l,
+        const Point& r )
+{
+    return
+        make_point(
+            [&l,&r]
+            ( const unsigned int coord )
+            {
+                return l.data[coord] - r.data[coord];
+            } );
+}
+
 inline
 Point
 operator*(
@@ -59,6 +74,31 @@ operator*(
             } );
 }
 
+inline
+float_t
+dot(
+        const Point& l,
+        const Point& r )
+{
+    return
+          l.data[0u] * r.data[0u]
+        + l.data[1u] * r.data[1u]
+        + l.data[2u] * r.data[2u];
+}
+
+inline
+Point
+cross(
+        const Point& l,
+        const Point& r )
+{
+    return
+        Point{ {
+            l.data[1u] * r.data[2u] - l.data[2u] * r.data[1u],
+            l.data[2u] * r.data[0u] - l.data[0u] * r.data[2u],
+            l.data[0u] * r.data[1u] - l.data[1u] * r.data[0u] } };
+}
+
 /*    used for testing */
 inline
 bool
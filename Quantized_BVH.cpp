@@ -0,0 +1,310 @@
+#include <tuple>
+#include <stdexcept>
+#include <cassert>
+#include "Quantized_BVH.h"
+#include "BoundingVolumeHierarchy.h"
+
+using namespace CoDet;
+
+namespace {
+
+/*  Largest step that decodes to at most v. */
+template <typename Quantized_t>
+Quantized_t
+quantize_down(
+        const CoDet::float_t    parent_min,
+        const CoDet::float_t    parent_max,
+        const CoDet::float_t    v )
+{
+    constexpr auto q_max = std::numeric_limits<Quantized_t>::max();
+
+    assert( parent_min <= v );
+
+    const auto extent = parent_max - parent_min;
+
+    unsigned int q =
+        (0 < extent)
+            ? static_cast<unsigned int>( std::min<CoDet::float_t>( (v - parent_min) / extent * q_max, q_max ) )
+            : 0u;
+
+    // estimate is off by a step at most, settle it on the decoded value
+    while( (0u < q) && (dequantize( parent_min, parent_max, static_cast<Quantized_t>( q ) ) > v) )
+    {
+        --q;
+    }
+
+    return static_cast<Quantized_t>( q );
+}
+
+/*  Smallest step that decodes to at least v. */
+template <typename Quantized_t>
+Quantized_t
+quantize_up(
+        const CoDet::float_t    parent_min,
+        const CoDet::float_t    parent_max,
+        const CoDet::float_t    v )
+{
+    constexpr auto q_max = std::numeric_limits<Quantized_t>::max();
+
+    assert( v <= parent_max );
+
+    const auto extent = parent_max - parent_min;
+
+    unsigned int q =
+        (0 < extent)
+            ? static_cast<unsigned int>( std::min<CoDet::float_t>( (v - parent_min) / extent * q_max, q_max ) )
+            : q_max;
+
+    while( (q < q_max) && (dequantize( parent_min, parent_max, static_cast<Quantized_t>( q ) ) < v) )
+    {
+        ++q;
+    }
+
+    return static_cast<Quantized_t>( q );
+}
+
+/*  Node of a hierarchy with its decoded bounds.
+*/
+struct
+Decoded_Node
+{
+    std::uint32_t   index;
+    BBox            bbox;
+};
+
+/*  Decoded children of an interior node, or the leaf node itself.
+*/
+template <typename Quantized_t>
+void
+decode_candidates(
+        const std::vector<Quantized_BVH_Node<Quantized_t>>& nodes,
+        const Decoded_Node&                                 node,
+        std::vector<Decoded_Node>&                          candidates )
+{
+    candidates.clear();
+
+    const auto& record = nodes[node.index];
+
+    if ( is_leaf( record ) )
+    {
+        candidates.push_back( node );
+        return;
+    }
+
+    for( auto child=record.first_child; child<record.first_child+record.child_count; ++child )
+    {
+        candidates.push_back( Decoded_Node{ child, decode_bbox( node.bbox, nodes[child] ) } );
+    }
+}
+
+/*  Every face pair of two overlapping leaves, as indices into the meshes.
+*   Face bounds are not kept, so pairs of multi-face leaves are not
+*   pruned any further.
+*/
+template <typename Quantized_t, typename Report_face_pair>
+void
+report_leaf_pair(
+        const Quantized_BVH<Quantized_t>&   bvh1,
+        const Quantized_BVH<Quantized_t>&   bvh2,
+        const std::uint32_t                 leaf1,
+        const std::uint32_t                 leaf2,
+        Report_face_pair&                   report_face_pair )
+{
+    const auto& node1 = bvh1.get_nodes()[leaf1];
+    const auto& node2 = bvh2.get_nodes()[leaf2];
+
+    assert( is_leaf( node1 ) );
+    assert( is_leaf( node2 ) );
+
+    for( auto slot1=node1.first_face; slot1<node1.first_face+node1.face_count; ++slot1 )
+    for( auto slot2=node2.first_face; slot2<node2.first_face+node2.face_count; ++slot2 )
+    {
+        report_face_pair( bvh1.get_face_order()[slot1], bvh2.get_face_order()[slot2] );
+    }
+}
+
+/*  Depth-first traversal of two quantized hierarchies, child bounds are
+*   decoded on the way. Reports indices of candidate face pairs.
+*/
+template <typename Quantized_t, typename Report_face_pair>
+void
+traverse_depth_first(
+        const Quantized_BVH<Quantized_t>&   bvh1,
+        const Quantized_BVH<Quantized_t>&   bvh2,
+        Report_face_pair&&                  report_face_pair )
+{
+    if ( false == do_bbox_intersect( bvh1.get_root_bbox(), bvh2.get_root_bbox() ) )
+    {
+        return;
+    }
+
+    const auto& nodes1 = bvh1.get_nodes();
+    const auto& nodes2 = bvh2.get_nodes();
+
+    // pending pairs carry decoded bounds, children are decoded from them
+    std::vector<std::tuple<Decoded_Node,Decoded_Node>> stack{
+        std::make_tuple(
+            Decoded_Node{ 0u, bvh1.get_root_bbox() },
+            Decoded_Node{ 0u, bvh2.get_root_bbox() } ) };
+
+    std::vector<Decoded_Node> candidates1;
+    std::vector<Decoded_Node> candidates2;
+
+    while( !stack.empty() )
+    {
+        const auto pair = stack.back();
+        stack.pop_back();
+
+        decode_candidates( nodes1, std::get<0u>( pair ), candidates1 );
+        decode_candidates( nodes2, std::get<1u>( pair ), candidates2 );
+
+        for( const auto& child1 : candidates1 )
+        for( const auto& child2 : candidates2 )
+        {
+            if ( !do_bbox_intersect( child1.bbox, child2.bbox ) )
+            {
+                continue;
+            }
+
+            if ( is_leaf( nodes1[child1.index] ) & is_leaf( nodes2[child2.index] ) )
+            {
+                report_leaf_pair( bvh1, bvh2, child1.index, child2.index, report_face_pair );
+            } else {
+                stack.emplace_back( child1, child2 );
+            }
+        }
+    }
+}
+}
+
+template <typename Quantized_t>
+Quantized_BVH<Quantized_t>
+Quantized_BVH<Quantized_t>::make_quantized_BVH(
+        const BoundingVolumeHierarchy& bvh )
+{
+    const auto& source_nodes = bvh.get_nodes();
+
+    Quantized_BVH ret;
+    ret.nodes.resize( source_nodes.size() );
+    ret.root_bbox   = to_bbox( source_nodes[0u].bbox );
+    ret.face_order.assign( bvh.get_face_order().begin(), bvh.get_face_order().end() );
+    ret.mesh_faces  = bvh.get_mesh_faces();
+
+    // decoded bounds of every node, children are encoded relative to them
+    std::vector<BBox> decoded( source_nodes.size() );
+    decoded[0u] = ret.root_bbox;
+
+    for( auto& coord : ret.nodes[0u].min ) coord = 0u;
+    for( auto& coord : ret.nodes[0u].max ) coord = std::numeric_limits<Quantized_t>::max();
+
+    // parents precede their children in the node array
+    for( std::uint32_t n=0u; n<source_nodes.size(); ++n )
+    {
+        const auto& source = source_nodes[n];
+        auto&       node   = ret.nodes[n];
+
+        assert( source.child_count <= std::numeric_limits<std::uint16_t>::max() );
+
+        node.child_count    = static_cast<std::uint16_t>( source.child_count );
+        node.first_child    = source.first_child;
+        node.first_face     = source.first_face;
+        node.face_count     = source.face_count;
+
+        for( auto c=source.first_child; c<source.first_child+source.child_count; ++c )
+        {
+            assert( c > n );
+
+            const auto  exact   = to_bbox( source_nodes[c].bbox );
+            const auto& parent  = decoded[n];
+            auto&       child   = ret.nodes[c];
+
+            for_each_coordinate(
+                [&child, &exact, &parent]
+                ( const unsigned int coord )
+                {
+                    const auto parent_min = parent.min.data[coord];
+                    const auto parent_max = parent.max.data[coord];
+
+                    child.min[coord] = quantize_down<Quantized_t>( parent_min, parent_max, exact.min.data[coord] );
+                    child.max[coord] = quantize_up<Quantized_t>( parent_min, parent_max, exact.max.data[coord] );
+                } );
+
+            decoded[c] = decode_bbox( parent, child );
+        }
+    }
+
+    return ret;
+}
+
+template <typename Quantized_t>
+pairwise_pruning_return_t
+CoDet::pairwise_pruning(
+        const Quantized_BVH<Quantized_t>&   bvh1,
+        const Quantized_BVH<Quantized_t>&   bvh2 )
+{
+    if ( (nullptr == bvh1.get_mesh_faces()) || (nullptr == bvh2.get_mesh_faces()) )
+    {
+        throw std::invalid_argument( "BVH built from an Indexed_Mesh has no Mesh_Face data, use pairwise_pruning_face_indices" );
+    }
+
+    pairwise_pruning_return_t candidate_faces;
+
+    traverse_depth_first(
+        bvh1,
+        bvh2,
+        [&bvh1, &bvh2, &candidate_faces]
+        ( const std::uint32_t face1, const std::uint32_t face2 )
+        {
+            candidate_faces.emplace_back( bvh1.get_mesh_faces() + face1, bvh2.get_mesh_faces() + face2 );
+        } );
+
+    return candidate_faces;
+}
+
+template <typename Quantized_t>
+pairwise_pruning_face_indices_t
+CoDet::pairwise_pruning_face_indices(
+        const Quantized_BVH<Quantized_t>&   bvh1,
+        const Quantized_BVH<Quantized_t>&   bvh2 )
+{
+    pairwise_pruning_face_indices_t candidate_faces;
+
+    traverse_depth_first(
+        bvh1,
+        bvh2,
+        [&candidate_faces]
+        ( const std::uint32_t face1, const std::uint32_t face2 )
+        {
+            candidate_faces.emplace_back( face1, face2 );
+        } );
+
+    return candidate_faces;
+}
+
+//    explicit template instantiation
+template class CoDet::Quantized_BVH<std::uint8_t>;
+template class CoDet::Quantized_BVH<std::uint16_t>;
+
+template
+pairwise_pruning_return_t
+CoDet::pairwise_pruning<std::uint8_t>(
+        const Quantized_BVH<std::uint8_t>&,
+        const Quantized_BVH<std::uint8_t>& );
+
+template
+pairwise_pruning_return_t
+CoDet::pairwise_pruning<std::uint16_t>(
+        const Quantized_BVH<std::uint16_t>&,
+        const Quantized_BVH<std::uint16_t>& );
+
+template
+pairwise_pruning_face_indices_t
+CoDet::pairwise_pruning_face_indices<std::uint8_t>(
+        const Quantized_BVH<std::uint8_t>&,
+        const Quantized_BVH<std::uint8_t>& );
+
+template
+pairwise_pruning_face_indices_t
+CoDet::pairwise_pruning_face_indices<std::uint16_t>(
+        const Quantized_BVH<std::uint16_t>&,
+        const Quantized_BVH<std::uint16_t>& );
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include "BBox.h"
+#include "Pairwise_Pruning.h"
+
+namespace CoDet {
+
+// forward decls
+class BoundingVolumeHierarchy;
+struct Mesh_Face;
+
+/*  Node record of a quantized BVH.
+*
+*   Bounds are stored relative to the bounds of the parent node, in steps
+*   of 1/max of the parent extent along each axis, max being the largest
+*   Quantized_t. Steps are rounded outwards, so decoded bounds contain
+*   the exact ones. Layout otherwise follows Compact_BVH_Node.
+*   20 bytes with 8-bit steps and 28 bytes with 16-bit steps, against
+*   40 bytes of Compact_BVH_Node with single precision bounds.
+*/
+template <typename Quantized_t>
+struct
+Quantized_BVH_Node
+{
+    std::array<Quantized_t,3u>  min;
+    std::array<Quantized_t,3u>  max;
+    std::uint16_t               child_count;    // 0 for leaves
+    std::uint32_t               first_child;
+    std::uint32_t               first_face;
+    std::uint32_t               face_count;
+};
+
+template <typename Quantized_t>
+inline
+bool
+is_leaf(
+        const Quantized_BVH_Node<Quantized_t>& node )
+{
+    return 0u == node.child_count;
+}
+
+/*  Bounds of the coordinate given by step q of the parent range.
+*   The ends of the range decode exactly.
+*/
+template <typename Quantized_t>
+inline
+float_t
+dequantize(
+        const float_t       parent_min,
+        const float_t       parent_max,
+        const Quantized_t   q )
+{
+    constexpr auto q_max = std::numeric_limits<Quantized_t>::max();
+
+    if ( q_max == q )
+    {
+        return parent_max;
+    }
+
+    return parent_min + (parent_max - parent_min) * (float_t( q ) / float_t( q_max ));
+}
+
+/*  Decoded bounds of a node, given decoded bounds of its parent. */
+template <typename Quantized_t>
+inline
+BBox
+decode_bbox(
+        const BBox&                             parent_bbox,
+        const Quantized_BVH_Node<Quantized_t>&  node )
+{
+    BBox ret;
+
+    for_each_coordinate(
+        [&ret, &parent_bbox, &node]
+        ( const unsigned int coord )
+        {
+            const auto parent_min = parent_bbox.min.data[coord];
+            const auto parent_max = parent_bbox.max.data[coord];
+
+            ret.min.data[coord] = dequantize( parent_min, parent_max, node.min[coord] );
+            ret.max.data[coord] = dequantize( parent_min, parent_max, node.max[coord] );
+        } );
+
+    return ret;
+}
+
+/*  BVH with quantized node bounds.
+*
+*   Made from a built BoundingVolumeHierarchy, with the same topology,
+*   node order and face order. Smaller nodes keep more of a large tree
+*   in cache, in exchange for decoding child bounds during traversal.
+*   Mesh face data is referenced, as by the source hierarchy.
+*   Quantized_t is std::uint8_t or std::uint16_t.
+*/
+template <typename Quantized_t>
+class Quantized_BVH final
+{
+public:
+    using node_t = Quantized_BVH_Node<Quantized_t>;
+
+private:
+    std::vector<node_t>             nodes;
+    BBox                            root_bbox;
+    std::vector<std::uint32_t>      face_order;
+    const Mesh_Face*                mesh_faces;
+
+public:
+    const std::vector<node_t>&
+    get_nodes() const
+    {
+        return nodes;
+    }
+public:
+    /*  Bounds of the root node, children decode relative to them. */
+    const BBox&
+    get_root_bbox() const
+    {
+        return root_bbox;
+    }
+public:
+    const std::vector<std::uint32_t>&
+    get_face_order() const
+    {
+        return face_order;
+    }
+public:
+    const Mesh_Face*
+    get_mesh_faces() const
+    {
+        return mesh_faces;
+    }
+
+private:
+    Quantized_BVH() = default;
+
+public:
+    static
+    Quantized_BVH
+    make_quantized_BVH(
+            const BoundingVolumeHierarchy& bvh );
+};
+
+// pruning of quantized hierarchies, depth-first with child bounds decoded on the way.
+// Throws std::invalid_argument for hierarchies built from an Indexed_Mesh,
+// which have no faces to point at.
+template <typename Quantized_t>
+pairwise_pruning_return_t
+pairwise_pruning(
+        const Quantized_BVH<Quantized_t>&   bvh1,
+        const Quantized_BVH<Quantized_t>&   bvh2 );
+
+// same, candidate face pairs as indices into the meshes both hierarchies
+// were built from. The only output of hierarchies built from an Indexed_Mesh.
+template <typename Quantized_t>
+pairwise_pruning_face_indices_t
+pairwise_pruning_face_indices(
+        const Quantized_BVH<Quantized_t>&   bvh1,
+        const Quantized_BVH<Quantized_t>&   bvh2 );
+
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include "Point.h"
+#include "BBox.h"
+
+namespace CoDet {
+
+/*  Rotation followed by translation, x -> rotation * x + translation.
+*   Rows of rotation have to be orthonormal.
+*/
+struct
+Rigid_Transform
+{
+    std::array<Point,3u>    rotation;       // rows
+    Point                   translation;
+};
+
+inline
+Rigid_Transform
+make_identity_transform()
+{
+    return
+        Rigid_Transform{
+            { {
+                Point{ { 1, 0, 0 } },
+                Point{ { 0, 1, 0 } },
+                Point{ { 0, 0, 1 } } } },
+            Point{ { 0, 0, 0 } } };
+}
+
+inline
+Point
+transform_point(
+        const Rigid_Transform&  transform,
+        const Point&            p )
+{
+    return
+        Point{ {
+            dot( transform.rotation[0u], p ),
+            dot( transform.rotation[1u], p ),
+            dot( transform.rotation[2u], p ) } }
+        + transform.translation;
+}
+
+/*  x -> first( second( x ) ) */
+inline
+Rigid_Transform
+compose(
+        const Rigid_Transform& first,
+        const Rigid_Transform& second )
+{
+    Rigid_Transform ret;
+
+    for( unsigned int row=0u; row<3u; ++row )
+    {
+        ret.rotation[row] =
+            make_point(
+                [&first, &second, row]
+                ( const unsigned int column )
+                {
+                    return
+                          first.rotation[row].data[0u] * second.rotation[0u].data[column]
+                        + first.rotation[row].data[1u] * second.rotation[1u].data[column]
+                        + first.rotation[row].data[2u] * second.rotation[2u].data[column];
+                } );
+    }
+
+    ret.translation = transform_point( first, second.translation );
+
+    return ret;
+}
+
+inline
+Rigid_Transform
+inverse(
+        const Rigid_Transform& transform )
+{
+    Rigid_Transform ret;
+
+    // inverse of a rotation is its transpose
+    for( unsigned int row=0u; row<3u; ++row )
+    {
+        ret.rotation[row] =
+            make_point(
+                [&transform, row]
+                ( const unsigned int column )
+                {
+                    return transform.rotation[column].data[row];
+                } );
+    }
+
+    ret.translation = Point{ { 0, 0, 0 } };
+    ret.translation = transform_point( ret, transform.translation ) * float_t( -1 );
+
+    return ret;
+}
+
+/*  Axis aligned box containing the transformed box.
+*   Grown by a few ulps, so that rounding never leaves part of the
+*   transformed box outside.
+*/
+inline
+BBox
+transform_bbox(
+        const Rigid_Transform&  transform,
+        const BBox&             bbox )
+{
+    constexpr float_t slack = 8 * std::numeric_limits<float_t>::epsilon();
+
+    const auto absolute =
+        []
+        ( const float_t v )
+        {
+            return (v < 0) ? -v : v;
+        };
+
+    const auto center = transform_point( transform, (bbox.min + bbox.max) * float_t( 0.5 ) );
+    const auto extent = (bbox.max - bbox.min) * float_t( 0.5 );
+
+    BBox ret;
+
+    for_each_coordinate(
+        [&ret, &transform, &center, &extent, &absolute, slack]
+        ( const unsigned int coord )
+        {
+            const auto& row = transform.rotation[coord].data;
+
+            const auto half =
+                  absolute( row[0u] ) * extent.data[0u]
+                + absolute( row[1u] ) * extent.data[1u]
+                + absolute( row[2u] ) * extent.data[2u];
+
+            const auto grown = half + slack * (absolute( center.data[coord] ) + half);
+
+            ret.min.data[coord] = center.data[coord] - grown;
+            ret.max.data[coord] = center.data[coord] + grown;
+        } );
+
+    return ret;
+}
+
+/*  Same, for node bounds, rounded outwards again. */
+inline
+Node_BBox
+transform_bbox(
+        const Rigid_Transform&  transform,
+        const Node_BBox&        bbox )
+{
+    return make_node_bbox( transform_bbox( transform, to_bbox( bbox ) ) );
+}
+
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <cassert>
+#include "Scene_Pruning.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Task_Scheduler.h"
+
+using namespace CoDet;
+
+namespace {
+
+/*  Axis along which centres of the boxes spread the most,
+*   sweeping along it leaves the fewest boxes overlapping on it alone.
+*/
+unsigned int
+get_sweep_axis(
+        const std::vector<Node_BBox>& bounds )
+{
+    float_t sum[3u]         = { 0, 0, 0 };
+    float_t sum_squares[3u] = { 0, 0, 0 };
+
+    for( const auto& bbox : bounds )
+    {
+        for_each_coordinate(
+            [&sum, &sum_squares, &bbox]
+            ( const unsigned int coord )
+            {
+                const auto centre = float_t( bbox.min[coord] ) + float_t( bbox.max[coord] );
+
+                sum[coord]          += centre;
+                sum_squares[coord]  += centre * centre;
+            } );
+    }
+
+    const auto n = float_t( bounds.size() );
+
+    unsigned int axis = 0u;
+    float_t      largest_spread = -1;
+
+    for( unsigned int coord=0u; coord<3u; ++coord )
+    {
+        const auto spread = sum_squares[coord] - sum[coord] * sum[coord] / n;
+
+        if ( spread > largest_spread )
+        {
+            largest_spread  = spread;
+            axis            = coord;
+        }
+    }
+
+    return axis;
+}
+
+/*  Prune given object pairs, append those with candidate face pairs to ret.
+*/
+void
+prune_object_pairs(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects,
+        const scene_object_pair_t*                          first,
+        const scene_object_pair_t*                          last,
+        Pruning_Context&                                    context,
+        scene_pruning_return_t&                             ret )
+{
+    for( auto pair=first; pair!=last; ++pair )
+    {
+        const auto object1 = std::get<0u>( *pair );
+        const auto object2 = std::get<1u>( *pair );
+
+        const auto& candidate_faces =
+            pairwise_pruning_face_indices(
+                *objects[object1],
+                *objects[object2],
+                context );
+
+        if ( !candidate_faces.empty() )
+        {
+            ret.push_back( Object_Pair_Candidates{ object1, object2, candidate_faces } );
+        }
+    }
+}
+
+}
+
+std::vector<scene_object_pair_t>
+CoDet::scene_object_pairs(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects )
+{
+    std::vector<scene_object_pair_t> pairs;
+
+    if ( objects.size() < 2u )
+    {
+        return pairs;
+    }
+
+    std::vector<Node_BBox> bounds( objects.size() );
+    std::transform(
+        objects.begin(),
+        objects.end(),
+        bounds.begin(),
+        []
+        ( const BoundingVolumeHierarchy* object )
+        {
+            assert( nullptr != object );
+
+            return object->get_nodes()[0u].bbox;
+        } );
+
+    const auto axis = get_sweep_axis( bounds );
+
+    std::vector<std::uint32_t> order( objects.size() );
+    std::iota( order.begin(), order.end(), 0u );
+    std::sort(
+        order.begin(),
+        order.end(),
+        [&bounds, axis]
+        ( const std::uint32_t l, const std::uint32_t r )
+        {
+            return bounds[l].min[axis] < bounds[r].min[axis];
+        } );
+
+    //    Sweep boxes in order of their lower end. Every box is tested only
+    //    against boxes starting before its upper end, those are the ones
+    //    overlapping it along the sweep axis.
+
+    for( std::size_t a=0u; a<order.size(); ++a )
+    {
+        const auto  object1 = order[a];
+        const auto& bbox1   = bounds[object1];
+
+        for( auto b=a+1u; (b<order.size()) && (bounds[order[b]].min[axis] < bbox1.max[axis]); ++b )
+        {
+            const auto object2 = order[b];
+
+            if ( do_bbox_intersect( bbox1, bounds[object2] ) )
+            {
+                pairs.emplace_back(
+                    std::min( object1, object2 ),
+                    std::max( object1, object2 ) );
+            }
+        }
+    }
+
+    std::sort( pairs.begin(), pairs.end() );
+
+    return pairs;
+}
+
+scene_pruning_return_t
+CoDet::scene_pruning(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects )
+{
+    const auto object_pairs = scene_object_pairs( objects );
+
+    scene_pruning_return_t ret;
+
+    // buffers shared by the queries of all object pairs
+    Pruning_Context context;
+
+    prune_object_pairs(
+        objects,
+        object_pairs.data(),
+        object_pairs.data() + object_pairs.size(),
+        context,
+        ret );
+
+    return ret;
+}
+
+scene_pruning_return_t
+CoDet::scene_pruning(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects,
+        Task_Scheduler&                                     scheduler,
+        const std::size_t                                   min_chunk_size )
+{
+    assert( 0u != min_chunk_size );
+
+    const auto object_pairs = scene_object_pairs( objects );
+
+    const auto number_of_chunks =
+        std::max<std::size_t>(
+            1u,
+            std::min<std::size_t>(
+                4u * scheduler.get_number_of_threads(),
+                object_pairs.size() / min_chunk_size ) );
+
+    const auto chunk_size = (object_pairs.size() + number_of_chunks - 1u) / number_of_chunks;
+
+    // every chunk prunes into its own buffers, concatenated in order afterwards
+    std::vector<scene_pruning_return_t> chunks( number_of_chunks );
+    {
+        Task_Scheduler::Task_Group group( scheduler );
+
+        for( std::size_t chunk=0u; chunk<number_of_chunks; ++chunk )
+        {
+            group.spawn(
+                [&objects,&object_pairs,&chunks,chunk,chunk_size]
+                ()
+                {
+                    const auto begin = std::min( chunk * chunk_size, object_pairs.size() );
+                    const auto end   = std::min( begin + chunk_size, object_pairs.size() );
+
+                    Pruning_Context context;
+
+                    prune_object_pairs(
+                        objects,
+                        object_pairs.data() + begin,
+                        object_pairs.data() + end,
+                        context,
+                        chunks[chunk] );
+                } );
+        }
+
+        group.wait();
+    }
+
+    scene_pruning_return_t ret;
+    for( auto& chunk : chunks )
+    {
+        std::move( chunk.begin(), chunk.end(), std::back_inserter( ret ) );
+    }
+
+    return ret;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <cstdint>
+#include "Pairwise_Pruning.h"
+
+namespace CoDet {
+
+// forward decls
+class BoundingVolumeHierarchy;
+class Task_Scheduler;
+
+/*  Pair of scene objects whose meshes may collide, with the candidate
+*   face pairs between them. Faces are given by index into the mesh of
+*   each object, objects by index into the scene.
+*/
+struct
+Object_Pair_Candidates
+{
+    std::uint32_t                       object1;
+    std::uint32_t                       object2;    // object1 < object2
+    pairwise_pruning_face_indices_t     candidate_faces;
+};
+
+// defines
+using scene_object_pair_t = std::tuple<std::uint32_t,std::uint32_t>;
+using scene_pruning_return_t = std::vector<Object_Pair_Candidates>;
+
+// top level of the scene query. Pairs of objects whose root bounds overlap,
+// found by sweep and prune along the axis of largest spread,
+// each as (lower index, higher index), in ascending order.
+std::vector<scene_object_pair_t>
+scene_object_pairs(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects );
+
+// all object pairs that have candidate face pairs, with those candidates.
+// BVHs of the objects are the bottom level, object pairs found by
+// scene_object_pairs are pruned one after another with pairwise_pruning_face_indices.
+scene_pruning_return_t
+scene_pruning(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects );
+
+// multithreaded variant, object pairs are pruned as tasks
+// in chunks of at least min_chunk_size object pairs
+scene_pruning_return_t
+scene_pruning(
+        const std::vector<const BoundingVolumeHierarchy*>&  objects,
+        Task_Scheduler&                                     scheduler,
+        const std::size_t                                   min_chunk_size = 16u );
+
+}
@@ -0,0 +1,40 @@
+#include "Statistics.h"
+
+using namespace CoDet;
+
+namespace {
+
+thread_local Pruning_Statistics    pruning_statistics;
+thread_local Build_Statistics      build_statistics;
+
+}
+
+const Pruning_Statistics&
+CoDet::get_pruning_statistics()
+{
+    return pruning_statistics;
+}
+
+void
+CoDet::reset_pruning_statistics()
+{
+    pruning_statistics = Pruning_Statistics();
+}
+
+const Build_Statistics&
+CoDet::get_build_statistics()
+{
+    return build_statistics;
+}
+
+Pruning_Statistics&
+CoDet::detail::get_thread_pruning_statistics()
+{
+    return pruning_statistics;
+}
+
+Build_Statistics&
+CoDet::detail::get_thread_build_statistics()
+{
+    return build_statistics;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace CoDet {
+
+/*  Statement that counts statistics. Compiled out, so free,
+*   unless CODET_ENABLE_STATISTICS is defined.
+*/
+#if defined(CODET_ENABLE_STATISTICS)
+#define CODET_STATISTICS( statement ) statement
+#else
+#define CODET_STATISTICS( statement )
+#endif
+
+#if defined(CODET_ENABLE_STATISTICS)
+constexpr bool statistics_enabled = true;
+#else
+constexpr bool statistics_enabled = false;
+#endif
+
+/*  What pruning queries did, summed over queries run on a thread since
+*   reset_pruning_statistics. Chunks of parallel queries count towards
+*   the thread that ran the query.
+*/
+struct
+Pruning_Statistics
+{
+    std::uint64_t   node_pairs_visited  = 0u;   // node pairs whose children were tested
+    std::uint64_t   bbox_tests          = 0u;   // node and face bounds tested for overlap
+    std::uint64_t   bbox_tests_passed   = 0u;
+    std::uint64_t   peak_frontier_size  = 0u;   // most node pairs waiting to be expanded at once
+    std::uint64_t   leaf_pairs          = 0u;   // overlapping leaf pairs, faces of which became candidates
+};
+
+/*  Tree made by the last build on a thread. Times are only taken by
+*   make_BVH_topDown, summed over threads of a parallel build.
+*/
+struct
+Build_Statistics
+{
+    std::uint32_t               depth                   = 0u;   // levels, 1 for a single leaf
+    std::uint32_t               number_of_nodes         = 0u;
+    std::uint32_t               number_of_leaves        = 0u;
+    std::vector<std::uint32_t>  leaf_size_histogram;            // leaves by their face count
+    double                      find_bounds_seconds     = 0;
+    double                      partitioning_seconds    = 0;
+};
+
+// statistics of the calling thread, all zero unless CODET_ENABLE_STATISTICS is defined
+const Pruning_Statistics&
+get_pruning_statistics();
+
+void
+reset_pruning_statistics();
+
+const Build_Statistics&
+get_build_statistics();
+
+namespace detail {
+
+Pruning_Statistics&
+get_thread_pruning_statistics();
+
+Build_Statistics&
+get_thread_build_statistics();
+
+inline
+void
+count_bbox_tests(
+        const std::uint32_t tests,
+        const std::uint32_t passed )
+{
+    auto& statistics = get_thread_pruning_statistics();
+
+    statistics.bbox_tests           += tests;
+    statistics.bbox_tests_passed    += passed;
+}
+
+inline
+void
+count_frontier(
+        const std::size_t size )
+{
+    auto& statistics = get_thread_pruning_statistics();
+
+    statistics.peak_frontier_size = std::max<std::uint64_t>( statistics.peak_frontier_size, size );
+}
+
+inline
+void
+add_pruning_statistics(
+        Pruning_Statistics&         sum,
+        const Pruning_Statistics&   statistics )
+{
+    sum.node_pairs_visited  += statistics.node_pairs_visited;
+    sum.bbox_tests          += statistics.bbox_tests;
+    sum.bbox_tests_passed   += statistics.bbox_tests_passed;
+    sum.peak_frontier_size  = std::max( sum.peak_frontier_size, statistics.peak_frontier_size );
+    sum.leaf_pairs          += statistics.leaf_pairs;
+}
+
+}
+
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <utility>
+#include "Task_Scheduler.h"
+
+using namespace CoDet;
+
+namespace {
+
+/*  Identifies worker thread the code runs on, if any. */
+thread_local const Task_Scheduler*  current_scheduler   = nullptr;
+thread_local unsigned int           current_worker      = 0u;
+
+}
+
+Task_Scheduler::Task_Scheduler(
+        unsigned int number_of_threads )
+    :   queued_tasks    (0u)
+    ,   next_queue      (0u)
+    ,   stopping        (false)
+{
+    if ( 0u == number_of_threads )
+    {
+        number_of_threads = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+
+    for( unsigned int i=0u; i<number_of_threads; ++i )
+    {
+        queues.emplace_back( new Worker_Queue );
+    }
+
+    for( unsigned int i=0u; i<number_of_threads; ++i )
+    {
+        threads.emplace_back(
+            [this,i]
+            ()
+            {
+                worker_loop( i );
+            } );
+    }
+}
+
+Task_Scheduler::~Task_Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock( sleep_mutex );
+        stopping = true;
+    }
+    sleep_condition.notify_all();
+
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+}
+
+void
+Task_Scheduler::push(
+        std::function<void()>&& task )
+{
+    // workers push to their own queue, other threads spread round robin
+    const auto queue_index =
+        (this == current_scheduler)
+            ? current_worker
+            : next_queue.fetch_add( 1u ) % static_cast<unsigned int>( queues.size() );
+
+    // count first, so that queued_tasks never drops below zero
+    queued_tasks.fetch_add( 1u );
+
+    {
+        std::lock_guard<std::mutex> lock( queues[queue_index]->mutex );
+        queues[queue_index]->tasks.emplace_back( std::move( task ) );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( sleep_mutex );
+    }
+    sleep_condition.notify_one();
+}
+
+/*  Pop newest task from first_queue, or steal oldest task from
+*   any other queue. Returns false if all queues were empty.
+*/
+bool
+Task_Scheduler::try_run_one(
+        const unsigned int first_queue )
+{
+    const auto number_of_queues = static_cast<unsigned int>( queues.size() );
+
+    std::function<void()> task;
+
+    for( unsigned int i=0u; i<number_of_queues && !task; ++i )
+    {
+        auto& queue = *queues[(first_queue + i) % number_of_queues];
+
+        std::lock_guard<std::mutex> lock( queue.mutex );
+
+        if ( queue.tasks.empty() )
+        {
+            continue;
+        }
+
+        if ( 0u == i )
+        {
+            task = std::move( queue.tasks.back() );
+            queue.tasks.pop_back();
+        } else {
+            task = std::move( queue.tasks.front() );
+            queue.tasks.pop_front();
+        }
+    }
+
+    if ( !task )
+    {
+        return false;
+    }
+
+    queued_tasks.fetch_sub( 1u );
+    task();
+
+    return true;
+}
+
+void
+Task_Scheduler::worker_loop(
+        const unsigned int worker_index )
+{
+    current_scheduler   = this;
+    current_worker      = worker_index;
+
+    for(;;)
+    {
+        if ( try_run_one( worker_index ) )
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock( sleep_mutex );
+        sleep_condition.wait(
+            lock,
+            [this]
+            ()
+            {
+                return stopping || (0u != queued_tasks.load());
+            } );
+
+        if ( stopping )
+        {
+            return;
+        }
+    }
+}
+
+void
+Task_Scheduler::Task_Group::spawn(
+        std::function<void()> task )
+{
+    pending.fetch_add( 1u );
+
+    scheduler.push(
+        [this,task]
+        ()
+        {
+            try
+            {
+                task();
+            }
+            catch( ... )
+            {
+                std::lock_guard<std::mutex> lock( exception_mutex );
+
+                if ( !exception )
+                {
+                    exception = std::current_exception();
+                }
+            }
+
+            auto& task_scheduler = scheduler;
+
+            // the group may be gone once pending drops to zero, only the scheduler is used after it
+            if ( 1u == pending.fetch_sub( 1u ) )
+            {
+                {
+                    std::lock_guard<std::mutex> lock( task_scheduler.sleep_mutex );
+                }
+                task_scheduler.sleep_condition.notify_all();
+            }
+        } );
+}
+
+void
+Task_Scheduler::Task_Group::wait()
+{
+    wait_for_tasks();
+
+    if ( exception )
+    {
+        std::exception_ptr rethrown;
+        std::swap( rethrown, exception );
+
+        std::rethrow_exception( rethrown );
+    }
+}
+
+/*  Runs queued tasks until none of this group is pending. With nothing
+*   left to run, sleeps until a task is queued or the last one of this
+*   group finishes.
+*/
+void
+Task_Scheduler::Task_Group::wait_for_tasks()
+{
+    const auto first_queue =
+        (&scheduler == current_scheduler)
+            ? current_worker
+            : 0u;
+
+    while( 0u != pending.load() )
+    {
+        if ( scheduler.try_run_one( first_queue ) )
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock( scheduler.sleep_mutex );
+        scheduler.sleep_condition.wait(
+            lock,
+            [this]
+            ()
+            {
+                return (0u == pending.load()) || (0u != scheduler.queued_tasks.load());
+            } );
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CoDet {
+
+/*  Work stealing thread pool.
+*
+*   Every worker owns a deque of tasks. Tasks spawned from a worker go
+*   to the back of its own deque and are popped LIFO, idle workers steal
+*   the oldest task from the front of other deques.
+*   Tasks are spawned and awaited through a Task_Group; waiting thread
+*   keeps executing queued tasks, so nested groups do not deadlock, and
+*   sleeps once there are none left to run.
+*/
+class Task_Scheduler final
+{
+public:
+    class Task_Group;
+
+private:
+    struct
+    Worker_Queue
+    {
+        std::mutex                          mutex;
+        std::deque<std::function<void()>>   tasks;
+    };
+
+private:
+    std::vector<std::unique_ptr<Worker_Queue>>  queues;
+    std::vector<std::thread>                    threads;
+    std::atomic<unsigned int>                   queued_tasks;
+    std::atomic<unsigned int>                   next_queue;
+    std::mutex                                  sleep_mutex;
+    std::condition_variable                     sleep_condition;
+    bool                                        stopping;
+
+public:
+    /*  Starts number_of_threads workers, 0 means one per hardware thread. */
+    explicit
+    Task_Scheduler(
+            unsigned int number_of_threads = 0u );
+
+    ~Task_Scheduler();
+
+    Task_Scheduler( const Task_Scheduler& ) = delete;
+    Task_Scheduler& operator=( const Task_Scheduler& ) = delete;
+
+public:
+    unsigned int
+    get_number_of_threads() const
+    {
+        return static_cast<unsigned int>( threads.size() );
+    }
+
+private:
+    void
+    push(
+            std::function<void()>&& task );
+
+    bool
+    try_run_one(
+            const unsigned int first_queue );
+
+    void
+    worker_loop(
+            const unsigned int worker_index );
+};
+
+/*  Set of tasks that can be waited upon together.
+*
+*   An exception thrown by a task is caught on the thread that ran it,
+*   the first one is rethrown by wait(). The group is destroyed without
+*   rethrowing it if wait() was not called.
+*/
+class Task_Scheduler::Task_Group final
+{
+private:
+    Task_Scheduler&             scheduler;
+    std::atomic<unsigned int>   pending;
+    std::mutex                  exception_mutex;
+    std::exception_ptr          exception;
+
+public:
+    explicit
+    Task_Group(
+            Task_Scheduler& scheduler
+    )
+        :   scheduler   (scheduler)
+        ,   pending     (0u)
+    {}
+
+    ~Task_Group()
+    {
+        wait_for_tasks();
+    }
+
+    Task_Group( const Task_Group& ) = delete;
+    Task_Group& operator=( const Task_Group& ) = delete;
+
+public:
+    void
+    spawn(
+            std::function<void()> task );
+
+public:
+    /*  Returns once every task spawned in this group has finished,
+    *   rethrows the first exception one of them threw.
+    */
+    void
+    wait();
+
+private:
+    void
+    wait_for_tasks();
+};
+
+}
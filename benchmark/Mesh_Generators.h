@@ -0,0 +1,205 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <map>
+#include <random>
+#include <cmath>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <cstdint>
+#include "../Mesh_Face.h"
+
+namespace CoDet {
+namespace Bench {
+
+using mesh_t = std::vector<Mesh_Face>;
+
+/*  Random triangle soup.
+*
+*   Triangles of roughly unit size are scattered in a cube whose volume
+*   grows with the number of faces, so density, and with it the number
+*   of candidates per face, stays the same across sizes.
+*/
+inline
+mesh_t
+make_triangle_soup(
+        const std::size_t   number_of_faces,
+        const unsigned int  seed,
+        const Point&        offset = Point{ { 0, 0, 0 } } )
+{
+    std::mt19937 rng( seed );
+
+    const CoDet::float_t side = 2 * std::cbrt( static_cast<CoDet::float_t>( number_of_faces ) );
+    std::uniform_real_distribution<CoDet::float_t> position( 0, side );
+    std::uniform_real_distribution<CoDet::float_t> corner( -0.5, 0.5 );
+
+    mesh_t mesh;
+    mesh.reserve( number_of_faces );
+
+    for( std::size_t f=0u; f<number_of_faces; ++f )
+    {
+        const Point center{ { position( rng ), position( rng ), position( rng ) } };
+
+        Mesh_Face face;
+        for( auto& vert : face.vertices )
+        {
+            vert = center + offset + Point{ { corner( rng ), corner( rng ), corner( rng ) } };
+        }
+        mesh.push_back( face );
+    }
+
+    return mesh;
+}
+
+/*  Unit icosahedron subdivided given number of times and projected
+*   onto a sphere, 20 * 4^subdivisions faces.
+*/
+inline
+mesh_t
+make_subdivided_sphere(
+        const unsigned int  subdivisions,
+        const Point&        center = Point{ { 0, 0, 0 } },
+        const CoDet::float_t radius = 1 )
+{
+    const CoDet::float_t t = (1 + std::sqrt( CoDet::float_t(5) )) / 2;
+
+    std::vector<Point> vertices{
+        Point{ { -1,  t,  0 } }, Point{ {  1,  t,  0 } }, Point{ { -1, -t,  0 } }, Point{ {  1, -t,  0 } },
+        Point{ {  0, -1,  t } }, Point{ {  0,  1,  t } }, Point{ {  0, -1, -t } }, Point{ {  0,  1, -t } },
+        Point{ {  t,  0, -1 } }, Point{ {  t,  0,  1 } }, Point{ { -t,  0, -1 } }, Point{ { -t,  0,  1 } } };
+
+    std::vector<std::array<std::uint32_t,3u>> triangles{
+        {{0,11,5}}, {{0,5,1}}, {{0,1,7}}, {{0,7,10}}, {{0,10,11}},
+        {{1,5,9}}, {{5,11,4}}, {{11,10,2}}, {{10,7,6}}, {{7,1,8}},
+        {{3,9,4}}, {{3,4,2}}, {{3,2,6}}, {{3,6,8}}, {{3,8,9}},
+        {{4,9,5}}, {{2,4,11}}, {{6,2,10}}, {{8,6,7}}, {{9,8,1}} };
+
+    const auto normalise =
+        []
+        ( const Point& p )
+        {
+            return p * (1 / std::sqrt( dot( p, p ) ));
+        };
+
+    for( auto& vert : vertices )
+    {
+        vert = normalise( vert );
+    }
+
+    for( unsigned int level=0u; level<subdivisions; ++level )
+    {
+        std::map<std::pair<std::uint32_t,std::uint32_t>,std::uint32_t> midpoints;
+
+        const auto midpoint =
+            [&vertices,&midpoints,&normalise]
+            ( std::uint32_t a, std::uint32_t b )
+            {
+                if ( a > b )
+                {
+                    std::swap( a, b );
+                }
+
+                const auto it = midpoints.find( { a, b } );
+                if ( it != midpoints.end() )
+                {
+                    return it->second;
+                }
+
+                vertices.push_back( normalise( (vertices[a] + vertices[b]) * 0.5 ) );
+                const auto index = static_cast<std::uint32_t>( vertices.size() - 1u );
+                midpoints.emplace( std::make_pair( a, b ), index );
+
+                return index;
+            };
+
+        std::vector<std::array<std::uint32_t,3u>> refined;
+        refined.reserve( 4u * triangles.size() );
+
+        for( const auto& tri : triangles )
+        {
+            const auto ab = midpoint( tri[0u], tri[1u] );
+            const auto bc = midpoint( tri[1u], tri[2u] );
+            const auto ca = midpoint( tri[2u], tri[0u] );
+
+            refined.push_back( {{ tri[0u], ab, ca }} );
+            refined.push_back( {{ tri[1u], bc, ab }} );
+            refined.push_back( {{ tri[2u], ca, bc }} );
+            refined.push_back( {{ ab, bc, ca }} );
+        }
+
+        triangles.swap( refined );
+    }
+
+    mesh_t mesh;
+    mesh.reserve( triangles.size() );
+
+    for( const auto& tri : triangles )
+    {
+        mesh.push_back(
+            Mesh_Face{ {
+                center + vertices[tri[0u]] * radius,
+                center + vertices[tri[1u]] * radius,
+                center + vertices[tri[2u]] * radius } } );
+    }
+
+    return mesh;
+}
+
+/*  Minimal Wavefront OBJ reader, vertices and polygonal faces only.
+*   Polygons are triangulated as fans. Returns empty mesh on failure.
+*/
+inline
+mesh_t
+load_obj(
+        const std::string& path )
+{
+    std::ifstream file( path );
+
+    std::vector<Point> vertices;
+    mesh_t mesh;
+
+    std::string line;
+    while( std::getline( file, line ) )
+    {
+        std::istringstream tokens( line );
+        std::string tag;
+        tokens >> tag;
+
+        if ( "v" == tag )
+        {
+            Point p;
+            tokens >> p.data[0u] >> p.data[1u] >> p.data[2u];
+            vertices.push_back( p );
+        }
+        else if ( "f" == tag )
+        {
+            std::vector<std::uint32_t> polygon;
+            std::string corner;
+            while( tokens >> corner )
+            {
+                // "v", "v/vt", "v//vn" or "v/vt/vn", negative indices are relative
+                const long index = std::stol( corner.substr( 0u, corner.find( '/' ) ) );
+                polygon.push_back(
+                    static_cast<std::uint32_t>(
+                        (index < 0) ? static_cast<long>( vertices.size() ) + index : index - 1 ) );
+            }
+
+            for( std::size_t k=2u; k<polygon.size(); ++k )
+            {
+                mesh.push_back(
+                    Mesh_Face{ {
+                        vertices.at( polygon[0u] ),
+                        vertices.at( polygon[k-1u] ),
+                        vertices.at( polygon[k] ) } } );
+            }
+        }
+    }
+
+    return mesh;
+}
+
+}
+}
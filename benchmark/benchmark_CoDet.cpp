@@ -0,0 +1,828 @@
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Mesh_Generators.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Naive_Oct_Split.h"
+#include "../Binned_SAH_Split.h"
+#include "../Pairwise_Pruning.h"
+#include "../Quantized_BVH.h"
+#include "../BVH_Image.h"
+#include "../Scene_Pruning.h"
+#include "../Rigid_Transform.h"
+#include "../Narrow_Phase.h"
+#include "../Continuous_Narrow_Phase.h"
+#include "../Statistics.h"
+
+using namespace CoDet;
+using namespace CoDet::Bench;
+
+namespace {
+
+/*  Reset peak resident set size, so that every benchmark reports its own.
+*   Linux only, elsewhere the peak of the whole process is reported.
+*/
+void
+reset_peak_rss()
+{
+    std::ofstream clear_refs( "/proc/self/clear_refs" );
+    clear_refs << "5";
+}
+
+/*  Peak resident set size since the last reset, in MiB. */
+double
+peak_rss_mib()
+{
+    std::ifstream status( "/proc/self/status" );
+
+    std::string line;
+    while( std::getline( status, line ) )
+    {
+        if ( 0u == line.compare( 0u, 6u, "VmHWM:" ) )
+        {
+            return std::stod( line.substr( 6u ) ) / 1024.0;
+        }
+    }
+
+    rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+
+    return usage.ru_maxrss / 1024.0;
+}
+
+/*  Number of node pairs whose children pairwise_pruning tests.
+*   Walks the BVH pair the same way the pruning does, outside of timing.
+*/
+std::size_t
+count_visited_node_pairs(
+        const BoundingVolumeHierarchy&  bvh1,
+        const BoundingVolumeHierarchy&  bvh2 )
+{
+    const auto& nodes1 = bvh1.get_nodes();
+    const auto& nodes2 = bvh2.get_nodes();
+
+    const auto overlap =
+        []
+        ( const Node_BBox& a, const Node_BBox& b )
+        {
+            return
+                   (a.min[0u] < b.max[0u]) && (a.max[0u] > b.min[0u])
+                && (a.min[1u] < b.max[1u]) && (a.max[1u] > b.min[1u])
+                && (a.min[2u] < b.max[2u]) && (a.max[2u] > b.min[2u]);
+        };
+
+    if ( !overlap( nodes1[0u].bbox, nodes2[0u].bbox ) )
+    {
+        return 0u;
+    }
+
+    std::size_t visited = 0u;
+    std::vector<std::tuple<std::uint32_t,std::uint32_t>> stack{ std::make_tuple( 0u, 0u ) };
+
+    while( !stack.empty() )
+    {
+        const auto pair = stack.back();
+        stack.pop_back();
+        ++visited;
+
+        const auto& node1 = nodes1[std::get<0u>( pair )];
+        const auto& node2 = nodes2[std::get<1u>( pair )];
+
+        const auto first1 = is_leaf( node1 ) ? std::get<0u>( pair ) : node1.first_child;
+        const auto first2 = is_leaf( node2 ) ? std::get<1u>( pair ) : node2.first_child;
+        const auto count1 = is_leaf( node1 ) ? 1u : node1.child_count;
+        const auto count2 = is_leaf( node2 ) ? 1u : node2.child_count;
+
+        for( auto c1=first1; c1<first1+count1; ++c1 )
+        for( auto c2=first2; c2<first2+count2; ++c2 )
+        {
+            if ( overlap( nodes1[c1].bbox, nodes2[c2].bbox )
+                && !(is_leaf( nodes1[c1] ) && is_leaf( nodes2[c2] )) )
+            {
+                stack.emplace_back( c1, c2 );
+            }
+        }
+    }
+
+    return visited;
+}
+
+enum class Scene
+{
+    soup_overlapping,
+    soup_disjoint,
+    sphere_overlapping,
+    sphere_disjoint
+};
+
+/*  Two meshes of the given scene. Soups are sized by face count,
+*   spheres by subdivision level. Disjoint soups are rejected at the roots.
+*/
+std::tuple<mesh_t,mesh_t>
+make_scene(
+        const Scene         scene,
+        const std::size_t   size )
+{
+    switch( scene )
+    {
+    case Scene::soup_overlapping:
+        return std::make_tuple( make_triangle_soup( size, 1u ), make_triangle_soup( size, 2u ) );
+    case Scene::soup_disjoint:
+        {
+            auto mesh1 = make_triangle_soup( size, 1u );
+            const CoDet::float_t shift = 5 * std::cbrt( static_cast<CoDet::float_t>( size ) );
+            return std::make_tuple( std::move( mesh1 ), make_triangle_soup( size, 2u, Point{ { shift, 0, 0 } } ) );
+        }
+    case Scene::sphere_overlapping:
+        return
+            std::make_tuple(
+                make_subdivided_sphere( static_cast<unsigned int>( size ) ),
+                make_subdivided_sphere( static_cast<unsigned int>( size ), Point{ { 0.5, 0.25, 0 } } ) );
+    case Scene::sphere_disjoint:
+        // nested spheres, bounds overlap everywhere while surfaces do not
+        return
+            std::make_tuple(
+                make_subdivided_sphere( static_cast<unsigned int>( size ) ),
+                make_subdivided_sphere( static_cast<unsigned int>( size ), Point{ { 0, 0, 0 } }, 0.9 ) );
+    }
+
+    return std::tuple<mesh_t,mesh_t>();
+}
+
+using pruning_function_t =
+    const pairwise_pruning_return_t& (*)(
+        const BoundingVolumeHierarchy&,
+        const BoundingVolumeHierarchy&,
+        Pruning_Context& );
+
+template <typename Partitioning_policy>
+void
+run_build(
+        benchmark::State&       state,
+        const mesh_t&           mesh,
+        Partitioning_policy     partitioning_policy,
+        const BVH_Build_Options&    options = BVH_Build_Options() )
+{
+    std::size_t number_of_nodes = 0u;
+
+    reset_peak_rss();
+
+    for( auto _ : state )
+    {
+        auto bvh =
+            BoundingVolumeHierarchy::make_BVH_topDown<Partitioning_policy>(
+                mesh,
+                partitioning_policy,
+                options );
+
+        number_of_nodes = bvh.get_nodes().size();
+        benchmark::DoNotOptimize( bvh );
+    }
+
+    state.SetItemsProcessed( static_cast<std::int64_t>( state.iterations() * mesh.size() ) );
+    state.counters["faces"]         = static_cast<double>( mesh.size() );
+    state.counters["nodes"]         = static_cast<double>( number_of_nodes );
+    state.counters["peak_rss_MiB"]  = peak_rss_mib();
+
+    // of the last build, with CODET_ENABLE_STATISTICS
+    if ( statistics_enabled )
+    {
+        const auto& statistics = get_build_statistics();
+
+        state.counters["depth"]                 = statistics.depth;
+        state.counters["find_bounds_share"]     = statistics.find_bounds_seconds / (statistics.find_bounds_seconds + statistics.partitioning_seconds);
+    }
+}
+
+template <typename Partitioning_policy>
+void
+run_pruning(
+        benchmark::State&       state,
+        const mesh_t&           mesh1,
+        const mesh_t&           mesh2,
+        Partitioning_policy     partitioning_policy,
+        pruning_function_t      pruning_function = pairwise_pruning,
+        const BVH_Build_Options&    options = BVH_Build_Options() )
+{
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown<Partitioning_policy>( mesh1, partitioning_policy, options );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown<Partitioning_policy>( mesh2, partitioning_policy, options );
+
+    std::size_t number_of_candidates = 0u;
+
+    // buffers are reused across iterations, as a caller running many queries would
+    Pruning_Context context;
+
+    reset_peak_rss();
+
+    for( auto _ : state )
+    {
+        const auto& candidate_faces = pruning_function( bvh1, bvh2, context );
+
+        number_of_candidates = candidate_faces.size();
+        benchmark::DoNotOptimize( candidate_faces.data() );
+    }
+
+    state.SetItemsProcessed( static_cast<std::int64_t>( state.iterations() * (mesh1.size() + mesh2.size()) ) );
+    state.counters["faces"]             = static_cast<double>( mesh1.size() + mesh2.size() );
+    state.counters["candidates"]        = static_cast<double>( number_of_candidates );
+    state.counters["node_pairs_visited"]= static_cast<double>( count_visited_node_pairs( bvh1, bvh2 ) );
+    state.counters["peak_rss_MiB"]      = peak_rss_mib();
+
+    // of one more query, with CODET_ENABLE_STATISTICS
+    if ( statistics_enabled )
+    {
+        reset_pruning_statistics();
+        pruning_function( bvh1, bvh2, context );
+
+        const auto& statistics = get_pruning_statistics();
+
+        state.counters["bbox_tests"]        = static_cast<double>( statistics.bbox_tests );
+        state.counters["bbox_pass_rate"]    = static_cast<double>( statistics.bbox_tests_passed ) / static_cast<double>( statistics.bbox_tests );
+        state.counters["peak_frontier"]     = static_cast<double>( statistics.peak_frontier_size );
+        state.counters["leaf_pairs"]        = static_cast<double>( statistics.leaf_pairs );
+    }
+}
+
+void
+BM_Build_Naive_Oct_Split_Sphere(
+        benchmark::State& state )
+{
+    const auto mesh = make_subdivided_sphere( static_cast<unsigned int>( state.range( 0 ) ) );
+    run_build<decltype(Naive_Oct_Split)>( state, mesh, Naive_Oct_Split );
+}
+
+void
+BM_Refit_Sphere(
+        benchmark::State& state )
+{
+    const auto mesh = make_subdivided_sphere( static_cast<unsigned int>( state.range( 0 ) ) );
+
+    // same faces on a wobbled sphere, as one step of a deforming mesh
+    auto moved = mesh;
+    for( auto& face : moved )
+    for( auto& vert : face.vertices )
+    {
+        vert = vert * (1 + 0.05 * std::sin( 7 * vert.data[0u] + 5 * vert.data[1u] ));
+    }
+
+    auto bvh = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh, Naive_Oct_Split );
+
+    for( auto _ : state )
+    {
+        bvh.refit( moved );
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed( static_cast<std::int64_t>( state.iterations() * mesh.size() ) );
+    state.counters["faces"]             = static_cast<double>( mesh.size() );
+    state.counters["sah_cost_growth"]   = bvh.get_sah_cost_growth();
+}
+
+void
+BM_Build_Binned_SAH_Split_Soup(
+        benchmark::State& state )
+{
+    const auto mesh = make_triangle_soup( static_cast<std::size_t>( state.range( 0 ) ), 1u );
+    run_build( state, mesh, Binned_SAH_Split() );
+}
+
+void
+BM_Build_Naive_Oct_Split_Soup(
+        benchmark::State& state )
+{
+    const auto mesh = make_triangle_soup( static_cast<std::size_t>( state.range( 0 ) ), 1u );
+    run_build<decltype(Naive_Oct_Split)>( state, mesh, Naive_Oct_Split );
+}
+
+void
+BM_Build_Linear_Soup(
+        benchmark::State& state )
+{
+    const auto mesh = make_triangle_soup( static_cast<std::size_t>( state.range( 0 ) ), 1u );
+
+    std::size_t number_of_nodes = 0u;
+    CoDet::float_t sah_cost = 0;
+
+    reset_peak_rss();
+
+    for( auto _ : state )
+    {
+        auto bvh = BoundingVolumeHierarchy::make_BVH_linear( mesh );
+
+        number_of_nodes = bvh.get_nodes().size();
+        sah_cost        = bvh.get_sah_cost();
+        benchmark::DoNotOptimize( bvh );
+    }
+
+    // tree quality, compare with the SAH build of the same soup
+    const auto sah_bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+
+    state.SetItemsProcessed( static_cast<std::int64_t>( state.iterations() * mesh.size() ) );
+    state.counters["faces"]                 = static_cast<double>( mesh.size() );
+    state.counters["nodes"]                 = static_cast<double>( number_of_nodes );
+    state.counters["sah_cost_vs_binned"]    = sah_cost / sah_bvh.get_sah_cost();
+    state.counters["peak_rss_MiB"]          = peak_rss_mib();
+}
+
+void
+BM_Map_BVH_Image_Soup(
+        benchmark::State& state )
+{
+    // cold start of a prebuilt BVH, compare with BM_Build_Binned_SAH_Split_Soup
+    const auto mesh = make_triangle_soup( static_cast<std::size_t>( state.range( 0 ) ), 1u );
+    const auto path = std::string( "codet_benchmark_bvh_image.bin" );
+
+    if ( !write_BVH_image( BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() ), path.c_str() ) )
+    {
+        state.SkipWithError( "could not write BVH image" );
+        return;
+    }
+
+    for( auto _ : state )
+    {
+        const auto file = Mapped_File::map_file( path.c_str() );
+        const auto bvh  = BoundingVolumeHierarchy::make_BVH_from_image( file.data(), file.size(), mesh );
+
+        benchmark::DoNotOptimize( any_collision( bvh, bvh ) );
+    }
+
+    std::remove( path.c_str() );
+
+    state.SetItemsProcessed( static_cast<std::int64_t>( state.iterations() * mesh.size() ) );
+    state.counters["faces"] = static_cast<double>( mesh.size() );
+}
+
+void
+BM_Pairwise_Pruning(
+        benchmark::State&   state,
+        const Scene         scene,
+        pruning_function_t  pruning_function = pairwise_pruning )
+{
+    const auto meshes = make_scene( scene, static_cast<std::size_t>( state.range( 0 ) ) );
+
+    if ( (Scene::sphere_overlapping == scene) | (Scene::sphere_disjoint == scene) )
+    {
+        run_pruning<decltype(Naive_Oct_Split)>( state, std::get<0u>( meshes ), std::get<1u>( meshes ), Naive_Oct_Split, pruning_function );
+    } else {
+        run_pruning( state, std::get<0u>( meshes ), std::get<1u>( meshes ), Binned_SAH_Split(), pruning_function );
+    }
+}
+
+void
+BM_Build_Leaf_Size(
+        benchmark::State& state )
+{
+    const auto mesh = make_triangle_soup( 1000000u, 1u );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = static_cast<std::size_t>( state.range( 0 ) );
+
+    run_build( state, mesh, Binned_SAH_Split(), options );
+}
+
+void
+BM_Pairwise_Pruning_Leaf_Size(
+        benchmark::State& state )
+{
+    const auto meshes = make_scene( Scene::soup_overlapping, 100000u );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = static_cast<std::size_t>( state.range( 0 ) );
+
+    run_pruning( state, std::get<0u>( meshes ), std::get<1u>( meshes ), Binned_SAH_Split(), pairwise_pruning, options );
+}
+
+/*  Spheres of 320 faces scattered uniformly in a cube,
+*   sized so that each overlaps about one other on average.
+*/
+std::vector<mesh_t>
+make_sphere_scene(
+        const std::size_t number_of_objects )
+{
+    const CoDet::float_t radius = 0.5;
+    const auto side = std::cbrt( CoDet::float_t( number_of_objects ) * 4 * radius * radius * radius * 4.19 );
+
+    std::mt19937 generator( 42u );
+    std::uniform_real_distribution<CoDet::float_t> coordinate( 0, side );
+
+    std::vector<mesh_t> meshes;
+    for( std::size_t o=0u; o<number_of_objects; ++o )
+    {
+        const Point center{ { coordinate( generator ), coordinate( generator ), coordinate( generator ) } };
+
+        meshes.push_back( make_subdivided_sphere( 2u, center, radius ) );
+    }
+
+    return meshes;
+}
+
+void
+BM_Scene_Pruning(
+        benchmark::State& state )
+{
+    const auto meshes = make_sphere_scene( static_cast<std::size_t>( state.range( 0 ) ) );
+
+    std::vector<BoundingVolumeHierarchy> bvhs;
+    for( const auto& mesh : meshes )
+    {
+        bvhs.push_back( BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() ) );
+    }
+
+    std::vector<const BoundingVolumeHierarchy*> objects;
+    for( const auto& bvh : bvhs )
+    {
+        objects.push_back( &bvh );
+    }
+
+    std::size_t number_of_object_pairs = 0u;
+
+    for( auto _ : state )
+    {
+        const auto candidates = scene_pruning( objects );
+
+        number_of_object_pairs = candidates.size();
+        benchmark::DoNotOptimize( candidates.data() );
+    }
+
+    state.SetItemsProcessed( static_cast<std::int64_t>( state.iterations() * objects.size() ) );
+    state.counters["objects"]       = static_cast<double>( objects.size() );
+    state.counters["object_pairs"]  = static_cast<double>( number_of_object_pairs );
+}
+
+/*  Rigidly moved object, range 0 prunes the prebuilt BVHs at their poses,
+*   range 1 transforms the faces and rebuilds the moved BVH first, as a
+*   frame of a simulation without posed queries would.
+*/
+void
+BM_Rigid_Pruning(
+        benchmark::State& state )
+{
+    const auto meshes = make_scene( Scene::soup_overlapping, 100000u );
+    const auto& mesh1 = std::get<0u>( meshes );
+    const auto& mesh2 = std::get<1u>( meshes );
+
+    const bool rebuild = (0 != state.range( 0 ));
+
+    // a turn about z by about 37 degrees
+    const Rigid_Transform pose1{
+        { {
+            Point{ { 0.8, -0.6, 0 } },
+            Point{ { 0.6,  0.8, 0 } },
+            Point{ { 0,    0,   1 } } } },
+        Point{ { 0.1, 0.2, 0 } } };
+    const auto pose2 = make_identity_transform();
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    mesh_t moved1( mesh1 );
+    std::size_t number_of_candidates = 0u;
+
+    for( auto _ : state )
+    {
+        if ( rebuild )
+        {
+            for( std::size_t f=0u; f<mesh1.size(); ++f )
+            {
+                for( unsigned int v=0u; v<3u; ++v )
+                {
+                    moved1[f].vertices[v] = transform_point( pose1, mesh1[f].vertices[v] );
+                }
+            }
+
+            const auto moved_bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( moved1, Binned_SAH_Split() );
+            const auto candidates = pairwise_pruning( moved_bvh1, bvh2 );
+
+            number_of_candidates = candidates.size();
+            benchmark::DoNotOptimize( candidates.data() );
+        } else {
+            const auto candidates = pairwise_pruning( bvh1, pose1, bvh2, pose2 );
+
+            number_of_candidates = candidates.size();
+            benchmark::DoNotOptimize( candidates.data() );
+        }
+    }
+
+    state.counters["candidates"] = static_cast<double>( number_of_candidates );
+}
+
+/*  Object moving a little every step, range 0 queries from the roots,
+*   range 1 keeps a Pruning_Front between steps.
+*/
+void
+BM_Coherent_Pruning(
+        benchmark::State& state )
+{
+    const auto meshes = make_scene( Scene::soup_overlapping, 100000u );
+
+    const bool coherent = (0 != state.range( 0 ));
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( std::get<0u>( meshes ), Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( std::get<1u>( meshes ), Binned_SAH_Split() );
+
+    auto front = Pruning_Front::make_pruning_front( bvh1, bvh2 );
+    const auto pose2 = make_identity_transform();
+
+    std::size_t step = 0u;
+    std::size_t number_of_candidates = 0u;
+
+    for( auto _ : state )
+    {
+        // back and forth by up to a tenth of a face
+        const CoDet::float_t offset = CoDet::float_t( 0.001 ) * CoDet::float_t( step % 100u );
+        auto pose1 = make_identity_transform();
+        pose1.translation = Point{ { offset, offset, 0 } };
+        ++step;
+
+        if ( coherent )
+        {
+            const auto& candidates = pairwise_pruning_face_indices( front, pose1, pose2 );
+
+            number_of_candidates = candidates.size();
+            benchmark::DoNotOptimize( candidates.data() );
+        } else {
+            const auto candidates = pairwise_pruning_face_indices( bvh1, pose1, bvh2, pose2 );
+
+            number_of_candidates = candidates.size();
+            benchmark::DoNotOptimize( candidates.data() );
+        }
+    }
+
+    state.counters["candidates"]  = static_cast<double>( number_of_candidates );
+    state.counters["front_pairs"] = static_cast<double>( front.size() );
+}
+
+/*  Self-intersection of a closed surface, where only adjacent faces meet.
+*   Range 0 passes the BVH to pairwise_pruning twice, 1 uses self_pruning,
+*   2 self_pruning without adjacent faces.
+*/
+void
+BM_Self_Pruning_Sphere(
+        benchmark::State& state )
+{
+    const auto mesh = make_subdivided_sphere( 6u );
+    const auto bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+
+    Pruning_Context context;
+    std::size_t number_of_candidates = 0u;
+
+    for( auto _ : state )
+    {
+        const auto& candidates =
+            (0 == state.range( 0 ))
+                ? pairwise_pruning_face_indices( bvh, bvh, context )
+                : self_pruning(
+                    bvh,
+                    context,
+                    (1 == state.range( 0 )) ? Adjacent_Faces::report : Adjacent_Faces::skip );
+
+        number_of_candidates = candidates.size();
+        benchmark::DoNotOptimize( candidates.data() );
+    }
+
+    state.counters["faces"]      = static_cast<double>( mesh.size() );
+    state.counters["candidates"] = static_cast<double>( number_of_candidates );
+}
+
+/*  One step of a soup moving through another by about a face size.
+*   Range 0 substeps eight times, refitting, pruning and running the
+*   narrow phase at every substep. Range 1 refits over the swept volume
+*   once, prunes once, and finds times of impact.
+*/
+void
+BM_Continuous_Collision(
+        benchmark::State& state )
+{
+    const auto meshes = make_scene( Scene::soup_overlapping, 100000u );
+    const auto& start1 = std::get<0u>( meshes );
+    const auto& faces2 = std::get<1u>( meshes );
+
+    const bool swept = (0 != state.range( 0 ));
+    const Point motion{ { 0.01, 0.005, 0 } };
+
+    const auto moved =
+        [&start1, &motion]
+        ( const CoDet::float_t fraction )
+        {
+            mesh_t faces( start1 );
+            for( auto& face : faces )
+            for( auto& vertex : face.vertices )
+            {
+                vertex = vertex + motion * fraction;
+            }
+            return faces;
+        };
+
+    const auto end1 = moved( 1 );
+
+    std::vector<mesh_t> substeps;
+    for( unsigned int s=1u; s<=8u; ++s )
+    {
+        substeps.push_back( moved( CoDet::float_t( s ) / 8 ) );
+    }
+
+    auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( start1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( faces2, Binned_SAH_Split() );
+
+    Pruning_Context context;
+    std::size_t number_of_contacts = 0u;
+
+    for( auto _ : state )
+    {
+        if ( swept )
+        {
+            bvh1.refit_swept( start1, end1 );
+
+            const auto impacts =
+                continuous_narrow_phase(
+                    pairwise_pruning_face_indices( bvh1, bvh2, context ),
+                    start1,
+                    end1,
+                    faces2,
+                    faces2 );
+
+            number_of_contacts = impacts.size();
+            benchmark::DoNotOptimize( impacts.data() );
+        } else {
+            number_of_contacts = 0u;
+
+            for( const auto& substep : substeps )
+            {
+                bvh1.refit( substep );
+
+                const auto intersections = narrow_phase( pairwise_pruning( bvh1, bvh2, context ) );
+
+                number_of_contacts += intersections.size();
+                benchmark::DoNotOptimize( intersections.data() );
+            }
+        }
+    }
+
+    state.counters["contacts"] = static_cast<double>( number_of_contacts );
+}
+
+template <typename Quantized_t>
+void
+run_pruning_quantized(
+        benchmark::State&   state,
+        const Scene         scene )
+{
+    const auto meshes = make_scene( scene, static_cast<std::size_t>( state.range( 0 ) ) );
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( std::get<0u>( meshes ), Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( std::get<1u>( meshes ), Binned_SAH_Split() );
+
+    const auto quantized1 = Quantized_BVH<Quantized_t>::make_quantized_BVH( bvh1 );
+    const auto quantized2 = Quantized_BVH<Quantized_t>::make_quantized_BVH( bvh2 );
+
+    std::size_t number_of_candidates = 0u;
+
+    for( auto _ : state )
+    {
+        const auto candidate_faces = pairwise_pruning( quantized1, quantized2 );
+
+        number_of_candidates = candidate_faces.size();
+        benchmark::DoNotOptimize( candidate_faces.data() );
+    }
+
+    state.counters["faces"]         = static_cast<double>( std::get<0u>( meshes ).size() + std::get<1u>( meshes ).size() );
+    state.counters["candidates"]    = static_cast<double>( number_of_candidates );
+    state.counters["node_MiB"]      = static_cast<double>( 2u * sizeof(Quantized_BVH_Node<Quantized_t>) * quantized1.get_nodes().size() ) / (1024.0 * 1024.0);
+}
+
+void
+BM_Pairwise_Pruning_Quantized_8_Bit(
+        benchmark::State&   state,
+        const Scene         scene )
+{
+    run_pruning_quantized<std::uint8_t>( state, scene );
+}
+
+void
+BM_Pairwise_Pruning_Quantized_16_Bit(
+        benchmark::State&   state,
+        const Scene         scene )
+{
+    run_pruning_quantized<std::uint16_t>( state, scene );
+}
+
+void
+BM_Any_Collision(
+        benchmark::State&   state,
+        const Scene         scene )
+{
+    const auto meshes = make_scene( scene, static_cast<std::size_t>( state.range( 0 ) ) );
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( std::get<0u>( meshes ), Naive_Oct_Split );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( std::get<1u>( meshes ), Naive_Oct_Split );
+
+    bool collision = false;
+
+    for( auto _ : state )
+    {
+        collision = any_collision( bvh1, bvh2 );
+        benchmark::DoNotOptimize( collision );
+    }
+
+    state.counters["faces"]     = static_cast<double>( std::get<0u>( meshes ).size() + std::get<1u>( meshes ).size() );
+    state.counters["collision"] = collision ? 1.0 : 0.0;
+}
+
+}
+
+// soups are sized by face count, 1K to 10M
+BENCHMARK( BM_Build_Binned_SAH_Split_Soup )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Build_Naive_Oct_Split_Soup )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Build_Linear_Soup )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Map_BVH_Image_Soup )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning, soup_overlapping, Scene::soup_overlapping )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning, soup_disjoint, Scene::soup_disjoint )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+
+// spheres are sized by subdivision level, 1280 to 5M faces
+BENCHMARK( BM_Build_Naive_Oct_Split_Sphere )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Refit_Sphere )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning, sphere_overlapping, Scene::sphere_overlapping )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning, sphere_disjoint, Scene::sphere_disjoint )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMillisecond );
+
+// depth-first traversal on the scenes with the widest breadth-first frontier
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning, soup_overlapping_depth_first, Scene::soup_overlapping, pairwise_pruning_depth_first )->RangeMultiplier( 10 )->Range( 1000, 10000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning, sphere_disjoint_depth_first, Scene::sphere_disjoint, pairwise_pruning_depth_first )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMillisecond );
+
+// quantized node bounds, candidates are a superset of the exact ones
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning_Quantized_8_Bit, soup_overlapping, Scene::soup_overlapping )->RangeMultiplier( 10 )->Range( 1000, 1000000 )->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( BM_Pairwise_Pruning_Quantized_16_Bit, soup_overlapping, Scene::soup_overlapping )->RangeMultiplier( 10 )->Range( 1000, 1000000 )->Unit( benchmark::kMillisecond );
+
+// fewer, larger leaves, faces of leaf pairs tested by brute force
+BENCHMARK( BM_Build_Leaf_Size )->RangeMultiplier( 2 )->Range( 1, 16 )->Unit( benchmark::kMillisecond );
+BENCHMARK( BM_Pairwise_Pruning_Leaf_Size )->RangeMultiplier( 2 )->Range( 1, 16 )->Unit( benchmark::kMillisecond );
+
+// many objects, sweep and prune over their roots, then BVH pairs
+BENCHMARK( BM_Scene_Pruning )->RangeMultiplier( 10 )->Range( 100, 10000 )->Unit( benchmark::kMillisecond );
+
+// posed query of prebuilt BVHs (0) against transforming and rebuilding (1)
+BENCHMARK( BM_Rigid_Pruning )->DenseRange( 0, 1 )->Unit( benchmark::kMillisecond );
+
+// same BVH pair every step with small motions, from the roots (0) or from the last front (1)
+BENCHMARK( BM_Coherent_Pruning )->DenseRange( 0, 1 )->Unit( benchmark::kMillisecond );
+
+// self-intersection: same BVH twice (0), self_pruning (1), without adjacent faces (2)
+BENCHMARK( BM_Self_Pruning_Sphere )->DenseRange( 0, 2 )->Unit( benchmark::kMillisecond );
+
+// moving soups, eight static substeps (0) against one swept query with times of impact (1)
+BENCHMARK( BM_Continuous_Collision )->DenseRange( 0, 1 )->Unit( benchmark::kMillisecond );
+
+// yes/no queries, the nested spheres have to be traversed in full to answer no
+BENCHMARK_CAPTURE( BM_Any_Collision, sphere_overlapping, Scene::sphere_overlapping )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMicrosecond );
+BENCHMARK_CAPTURE( BM_Any_Collision, sphere_disjoint, Scene::sphere_disjoint )->DenseRange( 3, 9, 2 )->Unit( benchmark::kMicrosecond );
+
+/*  Real meshes are passed through CODET_BENCH_MESH as a path to a Wavefront OBJ file.
+*   The mesh is built, and pruned against a slightly shifted copy of itself.
+*/
+int
+main(
+        int     argc,
+        char**  argv )
+{
+    benchmark::Initialize( &argc, argv );
+
+    const char* const mesh_path = std::getenv( "CODET_BENCH_MESH" );
+    const mesh_t real_mesh = (nullptr != mesh_path) ? load_obj( mesh_path ) : mesh_t();
+
+    mesh_t real_mesh_shifted;
+    if ( !real_mesh.empty() )
+    {
+        real_mesh_shifted = real_mesh;
+        for( auto& face : real_mesh_shifted )
+        for( auto& vert : face.vertices )
+        {
+            vert.data[0u] += 1e-3;
+        }
+
+        benchmark::RegisterBenchmark(
+            "BM_Build_Naive_Oct_Split_Real_Mesh",
+            [&real_mesh]
+            ( benchmark::State& state )
+            {
+                run_build<decltype(Naive_Oct_Split)>( state, real_mesh, Naive_Oct_Split );
+            } )->Unit( benchmark::kMillisecond );
+
+        benchmark::RegisterBenchmark(
+            "BM_Pairwise_Pruning/real_mesh_overlapping",
+            [&real_mesh,&real_mesh_shifted]
+            ( benchmark::State& state )
+            {
+                run_pruning<decltype(Naive_Oct_Split)>( state, real_mesh, real_mesh_shifted, Naive_Oct_Split );
+            } )->Unit( benchmark::kMillisecond );
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
@@ -1,10 +1,28 @@
 #pragma once
 
 #include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cassert>
 
 namespace CoDet {
 
+/*  Scalar type of geometry, CODET_SINGLE_PRECISION makes it float. */
+#if defined(CODET_SINGLE_PRECISION)
+using float_t = float;
+#else
 using float_t = double;
+#endif
+
+/*  Scalar type of BVH node bounds.
+*   Single precision by default, bounds are rounded outwards so that they
+*   still contain their faces. CODET_DOUBLE_PRECISION_BOUNDS stores them
+*   as float_t. */
+#if defined(CODET_DOUBLE_PRECISION_BOUNDS)
+using bound_t = float_t;
+#else
+using bound_t = float;
+#endif
 
 /*  Helper that applies the same procedure
 *   to every coordinate of the argument. */
@@ -40,5 +58,53 @@ generate_vector_of_pointers_to_elements(
     return dst;
 }
 
+/*  Index of the lowest set bit of a non zero mask. */
+inline
+unsigned int
+lowest_set_bit(
+        const std::uint32_t mask )
+{
+    assert( 0u != mask );
+
+#if defined(__GNUC__)
+    return static_cast<unsigned int>( __builtin_ctz( mask ) );
+#else
+    unsigned int bit = 0u;
+    while( 0u == (mask & (1u << bit)) ) ++bit;
+    return bit;
+#endif
+}
+
+/*  Number of set bits of a mask. */
+inline
+unsigned int
+count_set_bits(
+        const std::uint32_t mask )
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned int>( __builtin_popcount( mask ) );
+#else
+    unsigned int count = 0u;
+    for( auto m=mask; 0u!=m; m&=m-1u ) ++count;
+    return count;
+#endif
+}
+
+/*  Index of the highest set bit of a non zero mask. */
+inline
+unsigned int
+highest_set_bit(
+        const std::uint64_t mask )
+{
+    assert( 0u != mask );
+
+#if defined(__GNUC__)
+    return 63u - static_cast<unsigned int>( __builtin_clzll( mask ) );
+#else
+    unsigned int bit = 63u;
+    while( 0u == (mask & (std::uint64_t( 1u ) << bit)) ) --bit;
+    return bit;
+#endif
 }
 
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "../Mesh_Face.h"
+
+/*  Meshes shared by the tests. */
+
+/*  n by n triangles on a unit grid moved by offset, each reaching over
+*   its neighbours and lifted by one of three heights, so that two grids
+*   at slightly different offsets overlap in many face pairs.
+*/
+inline
+std::vector<CoDet::Mesh_Face>
+make_grid_mesh(
+        const unsigned int      n,
+        const CoDet::Point&     offset )
+{
+    using CoDet::Point;
+
+    std::vector<CoDet::Mesh_Face> mesh;
+
+    for( unsigned int i=0u; i<n; ++i )
+    for( unsigned int j=0u; j<n; ++j )
+    {
+        const auto corner = offset + Point{ CoDet::float_t(i), CoDet::float_t(j), CoDet::float_t( 0.1 * ((i*j)%3u) ) };
+
+        mesh.emplace_back(
+            CoDet::Mesh_Face{
+                corner,
+                corner + Point{ 1.5, 0,   0.5 },
+                corner + Point{ 0,   1.5, 1 } } );
+    }
+
+    return mesh;
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "../BVH_Image.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Binned_SAH_Split.h"
+#include "../Pairwise_Pruning.h"
+#include "../Mesh_Face.h"
+#include "Test_Meshes.h"
+
+using namespace CoDet;
+
+static
+void
+expect_same_arrays(
+        const BoundingVolumeHierarchy& l,
+        const BoundingVolumeHierarchy& r )
+{
+    ASSERT_EQ( l.get_nodes().size(), r.get_nodes().size() );
+    ASSERT_EQ( 0, std::memcmp( l.get_nodes().data(), r.get_nodes().data(), l.get_nodes().size() * sizeof(Compact_BVH_Node) ) );
+    ASSERT_EQ( l.get_face_order(), r.get_face_order() );
+
+    for( unsigned int coord=0u; coord<3u; ++coord )
+    {
+        ASSERT_EQ( l.get_node_bounds().min[coord], r.get_node_bounds().min[coord] );
+        ASSERT_EQ( l.get_node_bounds().max[coord], r.get_node_bounds().max[coord] );
+        ASSERT_EQ( l.get_face_bounds().min[coord], r.get_face_bounds().min[coord] );
+        ASSERT_EQ( l.get_face_bounds().max[coord], r.get_face_bounds().max[coord] );
+    }
+
+    ASSERT_EQ( l.get_sah_cost_growth(), r.get_sah_cost_growth() );
+}
+
+TEST( BVH_Image, In_Memory_Round_Trip )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,    0,     0 } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.45, 0.315, 0 } );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split(), options );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    const auto image1 = make_BVH_image( bvh1 );
+    const auto image2 = make_BVH_image( bvh2 );
+
+    ASSERT_EQ( check_BVH_image( image1.data(), image1.size() ), BVH_Image_Status::valid );
+    ASSERT_EQ( check_BVH_image( image2.data(), image2.size() ), BVH_Image_Status::valid );
+
+    const auto mapped1 = BoundingVolumeHierarchy::make_BVH_from_image( image1.data(), image1.size(), mesh1 );
+    const auto mapped2 = BoundingVolumeHierarchy::make_BVH_from_image( image2.data(), image2.size(), mesh2 );
+
+    // arrays are read in place
+    ASSERT_TRUE( mapped1.is_mapped_image() );
+    ASSERT_FALSE( bvh1.is_mapped_image() );
+    ASSERT_GT( static_cast<const void*>( mapped1.get_nodes().data() ), static_cast<const void*>( image1.data() ) );
+    ASSERT_LT( static_cast<const void*>( mapped1.get_nodes().data() ), static_cast<const void*>( image1.data() + image1.size() ) );
+
+    expect_same_arrays( mapped1, bvh1 );
+    expect_same_arrays( mapped2, bvh2 );
+
+    const auto expected = pairwise_pruning( bvh1, bvh2 );
+    ASSERT_FALSE( expected.empty() );
+    ASSERT_EQ( pairwise_pruning( mapped1, mapped2 ), expected );
+    ASSERT_EQ( pairwise_pruning( mapped1, bvh2 ), expected );
+}
+
+TEST( BVH_Image, Mapped_BVH_Is_Not_Refit )
+{
+    const auto mesh = make_grid_mesh( 10u, Point{ 0,    0,     0 } );
+    const auto moved = make_grid_mesh( 10u, Point{ 0.45, 0.315, 0 } );
+
+    const auto bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+    const auto image = make_BVH_image( bvh );
+
+    auto mapped = BoundingVolumeHierarchy::make_BVH_from_image( image.data(), image.size(), mesh );
+
+    // the image is read only, bounds stay those of the original faces
+    ASSERT_FALSE( mapped.refit( moved ) );
+    ASSERT_FALSE( mapped.refit_swept( mesh, moved ) );
+    expect_same_arrays( mapped, bvh );
+
+    auto copy = bvh;
+    ASSERT_FALSE( copy.refit( make_grid_mesh( 9u, Point{ 0, 0, 0 } ) ) );
+    expect_same_arrays( copy, bvh );
+    ASSERT_TRUE( copy.refit( moved ) );
+}
+
+TEST( BVH_Image, Mapped_File )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,    0,     0 } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.45, 0.315, 0 } );
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    const auto path = testing::TempDir() + "codet_test_bvh_image.bin";
+
+    ASSERT_TRUE( write_BVH_image( bvh1, path.c_str() ) );
+
+    {
+        const auto file = Mapped_File::map_file( path.c_str() );
+
+        ASSERT_TRUE( file.is_mapped() );
+        ASSERT_EQ( check_BVH_image( file.data(), file.size() ), BVH_Image_Status::valid );
+
+        const auto mapped1 = BoundingVolumeHierarchy::make_BVH_from_image( file.data(), file.size(), mesh1 );
+
+        expect_same_arrays( mapped1, bvh1 );
+        ASSERT_EQ( pairwise_pruning( mapped1, bvh2 ), pairwise_pruning( bvh1, bvh2 ) );
+    }
+
+    std::remove( path.c_str() );
+
+    ASSERT_FALSE( Mapped_File::map_file( path.c_str() ).is_mapped() );
+}
+
+TEST( BVH_Image, Rejects_Foreign_Images )
+{
+    const auto mesh = make_grid_mesh( 10u, Point{ 0, 0, 0 } );
+    const auto bvh  = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+    const auto image = make_BVH_image( bvh );
+
+    const auto check_modified =
+        [&image]
+        ( const std::size_t offset, const std::uint32_t value )
+        {
+            auto modified = image;
+            std::memcpy( modified.data() + offset, &value, sizeof(value) );
+
+            return check_BVH_image( modified.data(), modified.size() );
+        };
+
+    ASSERT_EQ( check_BVH_image( image.data(), image.size() - 1u ), BVH_Image_Status::truncated );
+    ASSERT_EQ( check_BVH_image( image.data(), 16u ), BVH_Image_Status::truncated );
+    ASSERT_EQ( check_modified( offsetof(BVH_Image_Header, magic), 0u ), BVH_Image_Status::bad_magic );
+    ASSERT_EQ( check_modified( offsetof(BVH_Image_Header, byte_order), 0x04030201u ), BVH_Image_Status::wrong_byte_order );
+    ASSERT_EQ( check_modified( offsetof(BVH_Image_Header, version), bvh_image_version + 1u ), BVH_Image_Status::unsupported_version );
+    ASSERT_EQ( check_modified( offsetof(BVH_Image_Header, bound_size), 2u * sizeof(bound_t) ), BVH_Image_Status::incompatible_layout );
+    ASSERT_EQ( check_modified( offsetof(BVH_Image_Header, number_of_faces), 1000000u ), BVH_Image_Status::truncated );
+
+    // node array offset close to 2^64, so that its end wraps around to
+    // before its original start
+    BVH_Image_Header header;
+    std::memcpy( &header, image.data(), sizeof(header) );
+
+    const std::uint64_t nodes_size = header.number_of_nodes * sizeof(Compact_BVH_Node);
+    const std::uint64_t wrapped_offset =
+        header.nodes_offset - (nodes_size + bvh_image_alignment - 1u) / bvh_image_alignment * bvh_image_alignment;
+
+    ASSERT_GT( wrapped_offset, header.image_size );
+    ASSERT_LE( wrapped_offset + nodes_size, header.nodes_offset );
+
+    auto wrapped = image;
+    std::memcpy( wrapped.data() + offsetof(BVH_Image_Header, nodes_offset), &wrapped_offset, sizeof(wrapped_offset) );
+    ASSERT_EQ( check_BVH_image( wrapped.data(), wrapped.size() ), BVH_Image_Status::truncated );
+
+    // one byte past an aligned start
+    std::vector<std::uint64_t> storage( image.size() / 8u + 2u );
+    auto* const shifted = reinterpret_cast<unsigned char*>( storage.data() ) + 1u;
+    std::memcpy( shifted, image.data(), image.size() );
+    ASSERT_EQ( check_BVH_image( shifted, image.size() ), BVH_Image_Status::misaligned );
+}
+
+TEST( BVH_Image, Rejects_Corrupt_Images )
+{
+    const auto mesh = make_grid_mesh( 10u, Point{ 0, 0, 0 } );
+    const auto bvh  = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+    const auto image = make_BVH_image( bvh );
+
+    BVH_Image_Header header;
+    std::memcpy( &header, image.data(), sizeof(header) );
+
+    const auto check_modified =
+        [&image]
+        ( const std::size_t offset, const std::uint32_t value )
+        {
+            auto modified = image;
+            std::memcpy( modified.data() + offset, &value, sizeof(value) );
+
+            return check_BVH_image( modified.data(), modified.size() );
+        };
+
+    const auto node_field_offset =
+        [&header]
+        ( const std::uint32_t node, const std::size_t field )
+        {
+            return header.nodes_offset + node * sizeof(Compact_BVH_Node) + field;
+        };
+
+    const auto& nodes = bvh.get_nodes();
+    const auto leaf =
+        static_cast<std::uint32_t>(
+            std::find_if( nodes.begin(), nodes.end(), []( const Compact_BVH_Node& node ){ return is_leaf( node ); } )
+            - nodes.begin() );
+
+    ASSERT_FALSE( is_leaf( nodes[0u] ) );
+
+    // children past the node array, or not after their parent, which could loop
+    ASSERT_EQ( check_modified( node_field_offset( 0u, offsetof(Compact_BVH_Node, first_child) ), header.number_of_nodes - 1u ), BVH_Image_Status::corrupt );
+    ASSERT_EQ( check_modified( node_field_offset( 0u, offsetof(Compact_BVH_Node, first_child) ), 0u ), BVH_Image_Status::corrupt );
+    ASSERT_EQ( check_modified( node_field_offset( 0u, offsetof(Compact_BVH_Node, child_count) ), header.number_of_nodes ), BVH_Image_Status::corrupt );
+
+    // faces past the face order, or past the mesh
+    ASSERT_EQ( check_modified( node_field_offset( leaf, offsetof(Compact_BVH_Node, face_count) ), header.number_of_faces + 1u ), BVH_Image_Status::corrupt );
+    ASSERT_EQ( check_modified( node_field_offset( leaf, offsetof(Compact_BVH_Node, first_face) ), header.number_of_faces ), BVH_Image_Status::corrupt );
+    ASSERT_EQ( check_modified( header.face_order_offset + 4u, header.number_of_faces ), BVH_Image_Status::corrupt );
+
+    // leaf of two faces inside the face order, in an image without face bounds
+    ASSERT_EQ( header.has_face_bounds, 0u );
+    ASSERT_LT( nodes[leaf].first_face + 1u, header.number_of_faces );
+    ASSERT_EQ( check_modified( node_field_offset( leaf, offsetof(Compact_BVH_Node, face_count) ), 2u ), BVH_Image_Status::corrupt );
+
+    ASSERT_EQ( check_BVH_image( image.data(), image.size() ), BVH_Image_Status::valid );
+}
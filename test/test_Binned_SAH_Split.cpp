@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include "../BoundingVolumeHierarchy.h"
+#include "../Binned_SAH_Split.h"
+#include "../Naive_Oct_Split.h"
+#include "../Pairwise_Pruning.h"
+#include "../Mesh_Face.h"
+
+using namespace CoDet;
+
+using mesh_t = std::vector<Mesh_Face>;
+
+static
+mesh_t
+make_clustered_mesh(
+        const float_t offset )
+{
+    mesh_t mesh;
+
+    // dense cluster near the origin and a few far away faces
+    for( unsigned int i=0u; i<20u; ++i )
+    {
+        const float_t x = offset + 0.01 * i;
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ x,                   0,      0 },
+                Point{ float_t(x+0.005),    0.01,   0 },
+                Point{ x,                   0,      0.01 } } );
+    }
+    for( unsigned int i=0u; i<4u; ++i )
+    {
+        const float_t x = offset + 100.0 * (i+1u);
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ x,   0,  0 },
+                Point{ x+1, 1,  0 },
+                Point{ x,   0,  1 } } );
+    }
+
+    return mesh;
+}
+
+static
+std::size_t
+count_leaves(
+        const BVH_Node& node )
+{
+    if ( node.get_child_volumes().empty() )
+    {
+        return 1u;
+    }
+
+    std::size_t ret = 0u;
+    for( const auto child : node.get_child_volumes() )
+    {
+        EXPECT_EQ( node.get_child_volumes().size(), 2u );
+        ret += count_leaves( child );
+    }
+
+    return ret;
+}
+
+TEST( Binned_SAH_Split, Binary_Tree_With_Leaf_Per_Face )
+{
+    const auto mesh = make_clustered_mesh( 0 );
+
+    BoundingVolumeHierarchy bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+            mesh,
+            Binned_SAH_Split( 8u ) ) );
+
+    ASSERT_EQ( count_leaves( bvh.get_root() ), mesh.size() );
+    ASSERT_EQ( bvh.get_nodes().size(), 2u * mesh.size() - 1u );
+}
+
+TEST( Binned_SAH_Split, Coincident_Faces )
+{
+    const mesh_t mesh(
+        5u,
+        Mesh_Face{
+            Point{ 0,0,0},
+            Point{ 0,0,1},
+            Point{ 0,1,0} } );
+
+    BoundingVolumeHierarchy bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+            mesh,
+            Binned_SAH_Split() ) );
+
+    ASSERT_EQ( count_leaves( bvh.get_root() ), mesh.size() );
+}
+
+TEST( Binned_SAH_Split, Same_Candidates_As_Naive_Oct_Split )
+{
+    const auto mesh1 = make_clustered_mesh( 0 );
+    const auto mesh2 = make_clustered_mesh( 0.003 );
+
+    const auto sah1 = BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>( mesh1, Binned_SAH_Split() );
+    const auto sah2 = BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>( mesh2, Binned_SAH_Split() );
+    const auto oct1 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh1, Naive_Oct_Split );
+    const auto oct2 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh2, Naive_Oct_Split );
+
+    auto sah_candidates = pairwise_pruning( sah1, sah2 );
+    auto oct_candidates = pairwise_pruning( oct1, oct2 );
+
+    ASSERT_FALSE( sah_candidates.empty() );
+
+    std::sort( sah_candidates.begin(), sah_candidates.end() );
+    std::sort( oct_candidates.begin(), oct_candidates.end() );
+
+    ASSERT_EQ( sah_candidates, oct_candidates );
+}
+
+TEST( Binned_SAH_Split, Denormal_Centroid_Extent )
+{
+    // centroids a few denormals apart, too close for bins of finite width
+    const float_t x = 3 * std::numeric_limits<float_t>::denorm_min();
+
+    mesh_t mesh;
+    for( unsigned int i=0u; i<4u; ++i )
+    {
+        const float_t offset = (0u == i % 2u) ? 0 : x;
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ offset, 0, 0 },
+                Point{ offset, 0, 1 },
+                Point{ offset, 1, 0 } } );
+    }
+
+    BoundingVolumeHierarchy bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown<Binned_SAH_Split>(
+            mesh,
+            Binned_SAH_Split() ) );
+
+    ASSERT_EQ( count_leaves( bvh.get_root() ), mesh.size() );
+}
@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <numeric>
 #include "../BoundingVolumeHierarchy.h"
 #include "../Naive_Oct_Split.h"
+#include "../Pairwise_Pruning.h"
 #include "../Mesh_Face.h"
+#include "../Task_Scheduler.h"
 
 using namespace CoDet;
 
@@ -68,3 +71,544 @@ TEST( BoundingVolumeHierarchy_Tree_Construction, Two_Elements )
     ASSERT_TRUE( children.end() != it2 );
 }
 
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Flattened_Layout )
+{
+    std::vector<Mesh_Face> mesh;
+    for( unsigned int i=0u; i<5u; ++i )
+    for( unsigned int j=0u; j<5u; ++j )
+    {
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ float_t(2.0*i),   float_t(2.0*j),   0 },
+                Point{ float_t(2.0*i+1), float_t(2.0*j),   0 },
+                Point{ float_t(2.0*i),   float_t(2.0*j+1), float_t((i+j)*0.5) } } );
+    }
+
+    BoundingVolumeHierarchy bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split ) );
+
+    const auto& nodes = bvh.get_nodes();
+    const auto& face_order = bvh.get_face_order();
+
+    std::vector<std::uint32_t> all_faces( mesh.size() );
+    std::iota( all_faces.begin(), all_faces.end(), 0u );
+
+    ASSERT_EQ( face_order.size(), mesh.size() );
+    ASSERT_TRUE( std::is_permutation( face_order.begin(), face_order.end(), all_faces.begin() ) );
+
+    ASSERT_EQ( nodes[0u].first_face, 0u );
+    ASSERT_EQ( nodes[0u].face_count, mesh.size() );
+
+    std::size_t number_of_leaves = 0u;
+    for( std::uint32_t n=0u; n<nodes.size(); ++n )
+    {
+        const auto& node = nodes[n];
+
+        if ( is_leaf( node ) )
+        {
+            ASSERT_EQ( node.face_count, 1u );
+            ++number_of_leaves;
+            continue;
+        }
+
+        // children follow their parent and tile its face range
+        ASSERT_GT( node.first_child, n );
+        std::uint32_t next_face = node.first_face;
+        for( std::uint32_t c=node.first_child; c<node.first_child+node.child_count; ++c )
+        {
+            ASSERT_EQ( nodes[c].first_face, next_face );
+            next_face += nodes[c].face_count;
+        }
+        ASSERT_EQ( next_face, node.first_face + node.face_count );
+    }
+
+    ASSERT_EQ( number_of_leaves, mesh.size() );
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Parallel_Build_Matches_Serial )
+{
+    std::vector<Mesh_Face> mesh;
+    for( unsigned int i=0u; i<3000u; ++i )
+    {
+        // deterministic scatter
+        const float_t x = (i * 7919u % 1000u) * 0.1;
+        const float_t y = (i * 104729u % 997u) * 0.1;
+        const float_t z = (i * 1299709u % 991u) * 0.1;
+
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ x,               y,               z },
+                Point{ float_t(x+0.5),  y,               z },
+                Point{ x,               float_t(y+0.5),  float_t(z+0.25) } } );
+    }
+
+    const auto serial =
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split );
+
+    Task_Scheduler scheduler( 4u );
+
+    BVH_Build_Options options;
+    options.scheduler       = &scheduler;
+    options.parallel_cutoff = 16u;
+
+    const auto parallel =
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split,
+            options );
+
+    ASSERT_EQ( serial.get_face_order(), parallel.get_face_order() );
+    ASSERT_EQ( serial.get_nodes().size(), parallel.get_nodes().size() );
+
+    for( std::size_t n=0u; n<serial.get_nodes().size(); ++n )
+    {
+        const auto& s = serial.get_nodes()[n];
+        const auto& p = parallel.get_nodes()[n];
+
+        ASSERT_EQ( s.bbox.min, p.bbox.min );
+        ASSERT_EQ( s.bbox.max, p.bbox.max );
+        ASSERT_EQ( s.first_child, p.first_child );
+        ASSERT_EQ( s.child_count, p.child_count );
+        ASSERT_EQ( s.first_face, p.first_face );
+        ASSERT_EQ( s.face_count, p.face_count );
+    }
+}
+
+static
+std::vector<Mesh_Face>
+make_scattered_mesh(
+        const unsigned int number_of_faces )
+{
+    std::vector<Mesh_Face> mesh;
+    for( unsigned int i=0u; i<number_of_faces; ++i )
+    {
+        // deterministic scatter
+        const float_t x = (i * 7919u % 1000u) * 0.1;
+        const float_t y = (i * 104729u % 997u) * 0.1;
+        const float_t z = (i * 1299709u % 991u) * 0.1;
+
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ x,               y,               z },
+                Point{ float_t(x+0.5),  y,               z },
+                Point{ x,               float_t(y+0.5),  float_t(z+0.25) } } );
+    }
+
+    return mesh;
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Linear_Layout )
+{
+    auto mesh = make_scattered_mesh( 3000u );
+
+    // duplicates and a flat axis give runs of equal codes
+    for( unsigned int i=0u; i<50u; ++i )
+    {
+        mesh.push_back( mesh[7u] );
+    }
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto bvh = BoundingVolumeHierarchy::make_BVH_linear( mesh, options );
+
+    const auto& nodes       = bvh.get_nodes();
+    const auto& face_order  = bvh.get_face_order();
+    const auto& face_bounds = bvh.get_face_bounds();
+
+    std::vector<std::uint32_t> all_faces( mesh.size() );
+    std::iota( all_faces.begin(), all_faces.end(), 0u );
+
+    ASSERT_EQ( bvh.get_mesh_faces(), mesh.data() );
+    ASSERT_TRUE( std::is_permutation( face_order.begin(), face_order.end(), all_faces.begin() ) );
+    ASSERT_EQ( nodes[0u].first_face, 0u );
+    ASSERT_EQ( nodes[0u].face_count, mesh.size() );
+
+    std::size_t number_of_leaf_faces = 0u;
+    for( std::uint32_t n=0u; n<nodes.size(); ++n )
+    {
+        const auto& node = nodes[n];
+
+        if ( is_leaf( node ) )
+        {
+            ASSERT_LE( node.face_count, 4u );
+            number_of_leaf_faces += node.face_count;
+
+            for( auto f=node.first_face; f<node.first_face+node.face_count; ++f )
+            {
+                auto expected = make_empty_bbox();
+                for( const auto& vert : mesh[face_order[f]].vertices )
+                {
+                    expand_bbox( expected, vert );
+                }
+
+                const auto face_bbox = get_bbox( face_bounds, f );
+                ASSERT_EQ( face_bbox.min, make_node_bbox( expected ).min );
+                ASSERT_EQ( face_bbox.max, make_node_bbox( expected ).max );
+
+                for( unsigned int coord=0u; coord<3u; ++coord )
+                {
+                    ASSERT_LE( node.bbox.min[coord], face_bbox.min[coord] );
+                    ASSERT_GE( node.bbox.max[coord], face_bbox.max[coord] );
+                }
+            }
+            continue;
+        }
+
+        // binary, children follow their parent, tile its face range and lie within its bounds
+        ASSERT_EQ( node.child_count, 2u );
+        ASSERT_GT( node.first_child, n );
+        std::uint32_t next_face = node.first_face;
+        for( std::uint32_t c=node.first_child; c<node.first_child+node.child_count; ++c )
+        {
+            ASSERT_EQ( nodes[c].first_face, next_face );
+            next_face += nodes[c].face_count;
+
+            for( unsigned int coord=0u; coord<3u; ++coord )
+            {
+                ASSERT_LE( node.bbox.min[coord], nodes[c].bbox.min[coord] );
+                ASSERT_GE( node.bbox.max[coord], nodes[c].bbox.max[coord] );
+            }
+        }
+        ASSERT_EQ( next_face, node.first_face + node.face_count );
+    }
+
+    ASSERT_EQ( number_of_leaf_faces, mesh.size() );
+    ASSERT_EQ( bvh.get_sah_cost_growth(), 1 );
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Parallel_Linear_Build_Matches_Serial )
+{
+    const auto mesh = make_scattered_mesh( 3000u );
+
+    const auto serial = BoundingVolumeHierarchy::make_BVH_linear( mesh );
+
+    Task_Scheduler scheduler( 4u );
+
+    BVH_Build_Options options;
+    options.scheduler       = &scheduler;
+    options.parallel_cutoff = 16u;
+
+    const auto parallel = BoundingVolumeHierarchy::make_BVH_linear( mesh, options );
+
+    ASSERT_EQ( serial.get_face_order(), parallel.get_face_order() );
+    ASSERT_EQ( serial.get_nodes().size(), parallel.get_nodes().size() );
+    ASSERT_EQ( serial.get_nodes().size(), 2u * mesh.size() - 1u );
+
+    for( std::size_t n=0u; n<serial.get_nodes().size(); ++n )
+    {
+        const auto& s = serial.get_nodes()[n];
+        const auto& p = parallel.get_nodes()[n];
+
+        ASSERT_EQ( s.bbox.min, p.bbox.min );
+        ASSERT_EQ( s.bbox.max, p.bbox.max );
+        ASSERT_EQ( s.first_child, p.first_child );
+        ASSERT_EQ( s.child_count, p.child_count );
+        ASSERT_EQ( s.first_face, p.first_face );
+        ASSERT_EQ( s.face_count, p.face_count );
+    }
+}
+
+TEST( BoundingVolumeHierarchy_Refit, Bounds_Follow_Moved_Faces )
+{
+    std::vector<Mesh_Face> mesh;
+    for( unsigned int i=0u; i<10u; ++i )
+    for( unsigned int j=0u; j<10u; ++j )
+    {
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ float_t(2.0*i),   float_t(2.0*j),   0 },
+                Point{ float_t(2.0*i+1), float_t(2.0*j),   0 },
+                Point{ float_t(2.0*i),   float_t(2.0*j+1), float_t((i+j)*0.5) } } );
+    }
+
+    BoundingVolumeHierarchy bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split ) );
+
+    const std::vector<Compact_BVH_Node> built_nodes( bvh.get_nodes().begin(), bvh.get_nodes().end() );
+
+    ASSERT_EQ( bvh.get_sah_cost_growth(), 1 );
+
+    // refit to unchanged faces gives the built tree back
+    bvh.refit( mesh );
+    for( std::size_t n=0u; n<built_nodes.size(); ++n )
+    {
+        ASSERT_EQ( bvh.get_nodes()[n].bbox.min, built_nodes[n].bbox.min );
+        ASSERT_EQ( bvh.get_nodes()[n].bbox.max, built_nodes[n].bbox.max );
+    }
+
+    // faces are scattered over the grid, topology no longer fits
+    std::vector<Mesh_Face> moved;
+    for( std::size_t f=0u; f<mesh.size(); ++f )
+    {
+        moved.push_back( mesh[(f * 37u) % mesh.size()] );
+    }
+
+    bvh.refit( moved );
+
+    ASSERT_EQ( bvh.get_mesh_faces(), moved.data() );
+    ASSERT_GT( bvh.get_sah_cost_growth(), 1.5 );
+
+    const auto& nodes       = bvh.get_nodes();
+    const auto& face_order  = bvh.get_face_order();
+    const auto& node_bounds = bvh.get_node_bounds();
+
+    for( std::uint32_t n=0u; n<nodes.size(); ++n )
+    {
+        const auto& node = nodes[n];
+
+        auto expected = make_empty_bbox();
+        for( auto f=node.first_face; f<node.first_face+node.face_count; ++f )
+        for( const auto& vert : moved[face_order[f]].vertices )
+        {
+            expand_bbox( expected, vert );
+        }
+
+        if ( is_leaf( node ) )
+        {
+            ASSERT_EQ( node.bbox.min, make_node_bbox( expected ).min );
+            ASSERT_EQ( node.bbox.max, make_node_bbox( expected ).max );
+        }
+
+        for( unsigned int coord=0u; coord<3u; ++coord )
+        {
+            ASSERT_LE( node.bbox.min[coord], expected.min.data[coord] );
+            ASSERT_GE( node.bbox.max[coord], expected.max.data[coord] );
+            ASSERT_EQ( node_bounds.min[coord][n], node.bbox.min[coord] );
+            ASSERT_EQ( node_bounds.max[coord][n], node.bbox.max[coord] );
+        }
+    }
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Multi_Face_Leaves )
+{
+    std::vector<Mesh_Face> mesh;
+    for( unsigned int i=0u; i<20u; ++i )
+    for( unsigned int j=0u; j<20u; ++j )
+    {
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ float_t(2.0*i),   float_t(2.0*j),   0 },
+                Point{ float_t(2.0*i+1), float_t(2.0*j),   0 },
+                Point{ float_t(2.0*i),   float_t(2.0*j+1), float_t((i+j)*0.5) } } );
+    }
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 8u;
+
+    BoundingVolumeHierarchy bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split,
+            options ) );
+
+    const auto single_face_leaves =
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split );
+
+    ASSERT_LT( 2u * bvh.get_nodes().size(), single_face_leaves.get_nodes().size() );
+    ASSERT_TRUE( single_face_leaves.get_face_bounds().min[0u].empty() );
+
+    const auto check_bounds =
+        [&bvh]
+        ( const std::vector<Mesh_Face>& faces )
+        {
+            const auto& face_order  = bvh.get_face_order();
+            const auto& face_bounds = bvh.get_face_bounds();
+
+            std::size_t number_of_leaf_faces = 0u;
+
+            for( const auto& node : bvh.get_nodes() )
+            {
+                if ( !is_leaf( node ) )
+                {
+                    continue;
+                }
+
+                ASSERT_LE( node.face_count, 8u );
+                number_of_leaf_faces += node.face_count;
+
+                for( auto f=node.first_face; f<node.first_face+node.face_count; ++f )
+                {
+                    auto expected = make_empty_bbox();
+                    for( const auto& vert : faces[face_order[f]].vertices )
+                    {
+                        expand_bbox( expected, vert );
+                    }
+
+                    const auto face_bbox = get_bbox( face_bounds, f );
+                    ASSERT_EQ( face_bbox.min, make_node_bbox( expected ).min );
+                    ASSERT_EQ( face_bbox.max, make_node_bbox( expected ).max );
+
+                    for( unsigned int coord=0u; coord<3u; ++coord )
+                    {
+                        ASSERT_LE( node.bbox.min[coord], face_bbox.min[coord] );
+                        ASSERT_GE( node.bbox.max[coord], face_bbox.max[coord] );
+                    }
+                }
+            }
+
+            ASSERT_EQ( number_of_leaf_faces, faces.size() );
+        };
+
+    check_bounds( mesh );
+
+    // face bounds follow refit
+    std::vector<Mesh_Face> moved;
+    for( std::size_t f=0u; f<mesh.size(); ++f )
+    {
+        moved.push_back( mesh[(f * 37u) % mesh.size()] );
+    }
+
+    bvh.refit( moved );
+    check_bounds( moved );
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Copies_Own_Their_Arrays )
+{
+    std::vector<Mesh_Face> mesh;
+    for( unsigned int i=0u; i<10u; ++i )
+    {
+        mesh.emplace_back(
+            Mesh_Face{
+                Point{ float_t(2.0*i),   0, 0 },
+                Point{ float_t(2.0*i+1), 0, 0 },
+                Point{ float_t(2.0*i),   1, 0 } } );
+    }
+
+    const auto bvh =
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split );
+
+    auto copy = bvh;
+    ASSERT_NE( copy.get_nodes().data(), bvh.get_nodes().data() );
+    ASSERT_NE( copy.get_node_bounds().min[0u].data(), bvh.get_node_bounds().min[0u].data() );
+
+    // refit of the copy leaves the original alone
+    auto moved = mesh;
+    for( auto& face : moved )
+    for( auto& vert : face.vertices )
+    {
+        vert.data[2u] += 5;
+    }
+
+    copy.refit( moved );
+    ASSERT_EQ( bvh.get_nodes()[0u].bbox.max[2u], 0 );
+    ASSERT_GE( copy.get_nodes()[0u].bbox.max[2u], 5 );
+
+    // moves keep the arrays in place
+    const auto* const nodes = copy.get_nodes().data();
+    const auto moved_to = std::move( copy );
+    ASSERT_EQ( moved_to.get_nodes().data(), nodes );
+}
+
+static
+std::size_t
+get_depth(
+        const Array_View<Compact_BVH_Node>& nodes )
+{
+    // children follow their parent
+    std::vector<std::size_t> levels( nodes.size(), 1u );
+
+    for( std::size_t n=0u; n<nodes.size(); ++n )
+    for( auto c=nodes[n].first_child; c<nodes[n].first_child+nodes[n].child_count; ++c )
+    {
+        levels[c] = levels[n] + 1u;
+    }
+
+    return *std::max_element( levels.begin(), levels.end() );
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Coincident_Faces )
+{
+    // midpoint bisection cannot separate copies of one face
+    std::vector<Mesh_Face> mesh(
+        100u,
+        Mesh_Face{
+            Point{ 0,0,0 },
+            Point{ 1,0,0 },
+            Point{ 0,1,0 } } );
+
+    const auto bvh =
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh,
+            Naive_Oct_Split );
+
+    // split at the median instead, binary and balanced
+    ASSERT_EQ( bvh.get_nodes().size(), 2u * mesh.size() - 1u );
+    ASSERT_EQ( get_depth( bvh.get_nodes() ), 8u );
+
+    std::vector<std::uint32_t> face_order( bvh.get_face_order().begin(), bvh.get_face_order().end() );
+    std::sort( face_order.begin(), face_order.end() );
+    for( std::uint32_t f=0u; f<face_order.size(); ++f )
+    {
+        ASSERT_EQ( face_order[f], f );
+    }
+}
+
+TEST( BoundingVolumeHierarchy_Tree_Construction, Max_Depth )
+{
+    const auto mesh1 = make_scattered_mesh( 500u );
+    auto mesh2 = mesh1;
+    for( auto& face : mesh2 )
+    for( auto& vert : face.vertices )
+    {
+        vert.data[0u] += 0.3;
+    }
+
+    BVH_Build_Options options;
+    options.max_depth = 3u;
+
+    const auto check_depth_limit =
+        []
+        ( const BoundingVolumeHierarchy& bvh )
+        {
+            ASSERT_EQ( get_depth( bvh.get_nodes() ), 3u );
+
+            // so leaves hold many faces, and keep their bounds
+            ASSERT_FALSE( bvh.get_face_bounds().min[0u].empty() );
+
+            const auto& nodes = bvh.get_nodes();
+            ASSERT_TRUE(
+                std::any_of(
+                    nodes.begin(),
+                    nodes.end(),
+                    []( const Compact_BVH_Node& node ){ return is_leaf( node ) && (1u < node.face_count); } ) );
+        };
+
+    const auto naive1 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh1, Naive_Oct_Split, options );
+    const auto naive2 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh2, Naive_Oct_Split, options );
+    const auto linear1 = BoundingVolumeHierarchy::make_BVH_linear( mesh1, options );
+    const auto linear2 = BoundingVolumeHierarchy::make_BVH_linear( mesh2, options );
+
+    check_depth_limit( naive1 );
+    check_depth_limit( linear1 );
+
+    // same candidates as without a limit
+    const auto sorted_candidates =
+        []
+        ( const BoundingVolumeHierarchy& bvh1, const BoundingVolumeHierarchy& bvh2 )
+        {
+            auto candidates = pairwise_pruning_face_indices( bvh1, bvh2 );
+            std::sort( candidates.begin(), candidates.end() );
+            return candidates;
+        };
+
+    const auto expected =
+        sorted_candidates(
+            BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh1, Naive_Oct_Split ),
+            BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh2, Naive_Oct_Split ) );
+
+    ASSERT_FALSE( expected.empty() );
+    ASSERT_EQ( sorted_candidates( naive1, naive2 ), expected );
+    ASSERT_EQ( sorted_candidates( linear1, linear2 ), expected );
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "../Continuous_Narrow_Phase.h"
+#include "../Narrow_Phase.h"
+#include "../Pairwise_Pruning.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Binned_SAH_Split.h"
+#include "../Mesh_Face.h"
+
+using namespace CoDet;
+
+using mesh_t = std::vector<Mesh_Face>;
+
+// times are taken early by a margin covering rounding
+const double time_margin = 256 * std::numeric_limits<CoDet::float_t>::epsilon();
+
+static
+bool
+near(
+        const Point& l,
+        const Point& r )
+{
+    // points move by a few units per step, so they are early by a few times the margin
+    const double tolerance = std::max( 1e-6, 8 * time_margin );
+
+    return
+          (std::abs( l.data[0u] - r.data[0u] ) < tolerance)
+        & (std::abs( l.data[1u] - r.data[1u] ) < tolerance)
+        & (std::abs( l.data[2u] - r.data[2u] ) < tolerance);
+}
+
+static
+mesh_t
+translate_mesh(
+        const mesh_t&   mesh,
+        const Point&    p )
+{
+    mesh_t ret( mesh );
+
+    for( auto& face : ret )
+    for( auto& vertex : face.vertices )
+    {
+        vertex = vertex + p;
+    }
+
+    return ret;
+}
+
+TEST( Continuous_Narrow_Phase, Tunneling_Vertex )
+{
+    // small triangle falling through a large one within one step, apart at both ends
+    const mesh_t falling_start{ Mesh_Face{ Point{ 0.3,0.3,1 }, Point{ 0.6,0.3,1.5 }, Point{ 0.3,0.6,1.5 } } };
+    const mesh_t falling_end = translate_mesh( falling_start, Point{ 0,0,-2 } );
+    const mesh_t ground{
+        Mesh_Face{ Point{ 0,0,0 }, Point{ 4,0,0 }, Point{ 0,4,0 } },
+        Mesh_Face{ Point{ 0,0,0 }, Point{ -4,0,0 }, Point{ 0,-4,0 } } };
+
+    auto falling = BoundingVolumeHierarchy::make_BVH_topDown( falling_start, Binned_SAH_Split() );
+    auto still   = BoundingVolumeHierarchy::make_BVH_topDown( ground, Binned_SAH_Split() );
+
+    ASSERT_TRUE( pairwise_pruning_face_indices( falling, still ).empty() );
+
+    falling.refit( falling_end );
+    ASSERT_TRUE( narrow_phase( pairwise_pruning( falling, still ) ).empty() );
+
+    // swept bounds catch the pair in between
+    falling.refit_swept( falling_start, falling_end );
+    still.refit_swept( ground, ground );
+
+    const auto candidates = pairwise_pruning_face_indices( falling, still );
+    ASSERT_EQ( candidates.size(), 1u );
+    ASSERT_EQ( std::get<1u>( candidates[0u] ), 0u );
+
+    const auto impacts = continuous_narrow_phase( candidates, falling_start, falling_end, ground, ground );
+
+    ASSERT_EQ( impacts.size(), 1u );
+    ASSERT_EQ( impacts[0u].face1, 0u );
+    ASSERT_EQ( impacts[0u].face2, 0u );
+    ASSERT_EQ( impacts[0u].feature, Impact_Feature::vertex_face );
+    ASSERT_LE( impacts[0u].time, 0.5 );
+    ASSERT_GT( impacts[0u].time, 0.5 - time_margin );
+    ASSERT_TRUE( near( impacts[0u].point, Point{ 0.3,0.3,0 } ) );
+
+    // same contact seen from the other side
+    const pairwise_pruning_face_indices_t swapped{ std::make_tuple( 0u, 0u ) };
+    const auto swapped_impacts = continuous_narrow_phase( swapped, ground, ground, falling_start, falling_end );
+
+    ASSERT_EQ( swapped_impacts.size(), 1u );
+    ASSERT_EQ( swapped_impacts[0u].feature, Impact_Feature::face_vertex );
+    ASSERT_EQ( swapped_impacts[0u].time, impacts[0u].time );
+}
+
+TEST( Continuous_Narrow_Phase, Times_Are_Not_Late )
+{
+    // vertex falling onto a rising face, impact time known from the z coordinates alone
+    unsigned int number_of_impacts = 0u;
+
+    for( unsigned int i=0u; i<100u; ++i )
+    for( unsigned int j=0u; j<20u; ++j )
+    {
+        const CoDet::float_t ground = 0.3 + 0.0137*i;
+        const CoDet::float_t z_start = ground + 0.1 + 0.031*j;
+        const CoDet::float_t z_end = ground - 0.05 - 0.017*i;
+        const CoDet::float_t rise = 0.013*i;
+
+        const mesh_t falling_start{ Mesh_Face{ Point{ 0.3,0.3,z_start }, Point{ 0.6,0.3,z_start+1 }, Point{ 0.3,0.6,z_start+1 } } };
+        const mesh_t falling_end{ Mesh_Face{ Point{ 0.3,0.3,z_end }, Point{ 0.6,0.3,z_end+1 }, Point{ 0.3,0.6,z_end+1 } } };
+        const mesh_t ground_start{ Mesh_Face{ Point{ 0,0,ground }, Point{ 4,0,ground }, Point{ 0,4,ground } } };
+        const mesh_t ground_end = translate_mesh( ground_start, Point{ 0,0,rise } );
+
+        const auto impacts =
+            continuous_narrow_phase(
+                { std::make_tuple( 0u, 0u ) },
+                falling_start,
+                falling_end,
+                ground_start,
+                ground_end );
+
+        const long double gap_start = static_cast<long double>( falling_start[0u].vertices[0u].data[2u] ) - ground_start[0u].vertices[0u].data[2u];
+        const long double gap_end   = static_cast<long double>( falling_end[0u].vertices[0u].data[2u] ) - ground_end[0u].vertices[0u].data[2u];
+
+        if ( gap_end > 0 )
+        {
+            continue;
+        }
+
+        ASSERT_EQ( impacts.size(), 1u );
+        ASSERT_LE( static_cast<long double>( impacts[0u].time ), gap_start / (gap_start - gap_end) );
+
+        ++number_of_impacts;
+    }
+
+    ASSERT_GT( number_of_impacts, 1000u );
+}
+
+TEST( Continuous_Narrow_Phase, Crossing_Edges )
+{
+    // horizontal edge of an upright triangle passes over the top edge of another,
+    // turned by 90 degrees. A vertex only reaches the other face at the end.
+    const mesh_t start1{ Mesh_Face{ Point{ -1,0,1 }, Point{ 1,0,1 }, Point{ 0,0,2 } } };
+    const mesh_t end1 = translate_mesh( start1, Point{ 0,0,-2 } );
+    const mesh_t faces2{ Mesh_Face{ Point{ 0,-1,0 }, Point{ 0,1,0 }, Point{ 0,0,-1 } } };
+
+    const pairwise_pruning_face_indices_t candidates{ std::make_tuple( 0u, 0u ) };
+    const auto impacts = continuous_narrow_phase( candidates, start1, end1, faces2, faces2 );
+
+    ASSERT_EQ( impacts.size(), 1u );
+    ASSERT_EQ( impacts[0u].feature, Impact_Feature::edge_edge );
+    ASSERT_LE( impacts[0u].time, 0.5 );
+    ASSERT_GT( impacts[0u].time, 0.5 - time_margin );
+    ASSERT_TRUE( near( impacts[0u].point, Point{ 0,0,0 } ) );
+}
+
+TEST( Continuous_Narrow_Phase, Passing_By )
+{
+    // falls past the edge of the large triangle, and the other way round
+    const mesh_t start1{ Mesh_Face{ Point{ 3,3,1 }, Point{ 3.5,3,1 }, Point{ 3,3.5,1 } } };
+    const mesh_t end1 = translate_mesh( start1, Point{ 0,0,-2 } );
+    const mesh_t faces2{ Mesh_Face{ Point{ 0,0,0 }, Point{ 4,0,0 }, Point{ 0,4,0 } } };
+
+    const pairwise_pruning_face_indices_t candidates{ std::make_tuple( 0u, 0u ) };
+
+    ASSERT_TRUE( continuous_narrow_phase( candidates, start1, end1, faces2, faces2 ).empty() );
+    ASSERT_TRUE( continuous_narrow_phase( candidates, faces2, faces2, start1, end1 ).empty() );
+}
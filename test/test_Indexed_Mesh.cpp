@@ -0,0 +1,350 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include "../Indexed_Mesh.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Binned_SAH_Split.h"
+#include "../Pairwise_Pruning.h"
+#include "../Quantized_BVH.h"
+#include "../Task_Scheduler.h"
+#include "../Mesh_Face.h"
+
+using namespace CoDet;
+
+using mesh_t = std::vector<Mesh_Face>;
+
+/*  Height field of (n+1)^2 shared vertices, two triangles per cell. */
+struct
+Grid
+{
+    std::vector<Point>          vertices;
+    std::vector<std::uint32_t>  indices;
+};
+
+static
+Grid
+make_grid(
+        const unsigned int      n,
+        const CoDet::float_t    offset )
+{
+    Grid grid;
+
+    for( unsigned int i=0u; i<=n; ++i )
+    for( unsigned int j=0u; j<=n; ++j )
+    {
+        grid.vertices.push_back(
+            Point{ { i + offset, CoDet::float_t(j + 0.7*offset), CoDet::float_t(0.1*((i*j)%7u) + offset) } } );
+    }
+
+    const auto vertex = [n]( const unsigned int i, const unsigned int j ){ return i*(n+1u) + j; };
+
+    for( unsigned int i=0u; i<n; ++i )
+    for( unsigned int j=0u; j<n; ++j )
+    {
+        grid.indices.insert( grid.indices.end(), { vertex(i,j), vertex(i+1u,j), vertex(i,j+1u) } );
+        grid.indices.insert( grid.indices.end(), { vertex(i+1u,j), vertex(i+1u,j+1u), vertex(i,j+1u) } );
+    }
+
+    return grid;
+}
+
+static
+mesh_t
+expand_faces(
+        const Indexed_Mesh& mesh )
+{
+    mesh_t faces;
+
+    for( std::uint32_t f=0u; f<mesh.size(); ++f )
+    {
+        faces.push_back( mesh.get_face( f ) );
+    }
+
+    return faces;
+}
+
+static
+void
+expect_same_bvh(
+        const BoundingVolumeHierarchy& l,
+        const BoundingVolumeHierarchy& r )
+{
+    ASSERT_EQ( l.get_face_order(), r.get_face_order() );
+    ASSERT_EQ( l.get_nodes().size(), r.get_nodes().size() );
+
+    for( std::size_t n=0u; n<l.get_nodes().size(); ++n )
+    {
+        const auto& ln = l.get_nodes()[n];
+        const auto& rn = r.get_nodes()[n];
+
+        ASSERT_EQ( ln.bbox.min, rn.bbox.min );
+        ASSERT_EQ( ln.bbox.max, rn.bbox.max );
+        ASSERT_EQ( ln.first_child, rn.first_child );
+        ASSERT_EQ( ln.child_count, rn.child_count );
+        ASSERT_EQ( ln.first_face, rn.first_face );
+        ASSERT_EQ( ln.face_count, rn.face_count );
+    }
+}
+
+TEST( Indexed_Mesh, Build_Matches_Face_Copies )
+{
+    const auto grid = make_grid( 20u, 0 );
+    const auto mesh = Indexed_Mesh::make_indexed_mesh( grid.vertices, grid.indices );
+    const auto faces = expand_faces( mesh );
+
+    ASSERT_EQ( mesh.size(), 800u );
+
+    const auto indexed_bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+    const auto bvh         = BoundingVolumeHierarchy::make_BVH_topDown( faces, Binned_SAH_Split() );
+
+    ASSERT_EQ( nullptr, indexed_bvh.get_mesh_faces() );
+    expect_same_bvh( indexed_bvh, bvh );
+
+    const auto indexed_linear_bvh = BoundingVolumeHierarchy::make_BVH_linear( mesh );
+
+    ASSERT_EQ( nullptr, indexed_linear_bvh.get_mesh_faces() );
+    expect_same_bvh( indexed_linear_bvh, BoundingVolumeHierarchy::make_BVH_linear( faces ) );
+
+    for( std::uint32_t f=0u; f<mesh.size(); ++f )
+    {
+        ASSERT_EQ( indexed_bvh.get_face( f ), faces[f] );
+    }
+}
+
+TEST( Indexed_Mesh, Pruning_Face_Indices )
+{
+    const auto grid1 = make_grid( 20u, 0 );
+    const auto grid2 = make_grid( 20u, 0.45 );
+    const auto mesh1 = Indexed_Mesh::make_indexed_mesh( grid1.vertices, grid1.indices );
+    const auto mesh2 = Indexed_Mesh::make_indexed_mesh( grid2.vertices, grid2.indices );
+    const auto faces1 = expand_faces( mesh1 );
+    const auto faces2 = expand_faces( mesh2 );
+
+    const auto indexed_bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto indexed_bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( faces1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( faces2, Binned_SAH_Split() );
+
+    auto indices = pairwise_pruning_face_indices( indexed_bvh1, indexed_bvh2 );
+
+    pairwise_pruning_face_indices_t expected;
+    for( const auto& pair : pairwise_pruning( bvh1, bvh2 ) )
+    {
+        expected.emplace_back(
+            static_cast<std::uint32_t>( std::get<0u>( pair ) - faces1.data() ),
+            static_cast<std::uint32_t>( std::get<1u>( pair ) - faces2.data() ) );
+    }
+
+    ASSERT_FALSE( expected.empty() );
+
+    std::sort( indices.begin(), indices.end() );
+    std::sort( expected.begin(), expected.end() );
+
+    ASSERT_EQ( indices, expected );
+    ASSERT_TRUE( any_collision( indexed_bvh1, indexed_bvh2 ) );
+}
+
+TEST( Indexed_Mesh, No_Face_Pointers )
+{
+    const auto grid1 = make_grid( 20u, 0 );
+    const auto grid2 = make_grid( 20u, 0.45 );
+    const auto mesh1 = Indexed_Mesh::make_indexed_mesh( grid1.vertices, grid1.indices );
+    const auto mesh2 = Indexed_Mesh::make_indexed_mesh( grid2.vertices, grid2.indices );
+    const auto faces2 = expand_faces( mesh2 );
+
+    const auto indexed_bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto indexed_bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( faces2, Binned_SAH_Split() );
+
+    ASSERT_FALSE( pairwise_pruning_face_indices( indexed_bvh1, indexed_bvh2 ).empty() );
+
+    // queries reporting Mesh_Face pointers have nothing to point at
+    ASSERT_THROW( pairwise_pruning( indexed_bvh1, indexed_bvh2 ), std::invalid_argument );
+    ASSERT_THROW( pairwise_pruning( indexed_bvh1, bvh2 ), std::invalid_argument );
+    ASSERT_THROW( pairwise_pruning( bvh2, indexed_bvh1 ), std::invalid_argument );
+    ASSERT_THROW( pairwise_pruning_depth_first( indexed_bvh1, indexed_bvh2 ), std::invalid_argument );
+
+    std::size_t visited = 0u;
+    ASSERT_THROW(
+        pairwise_pruning(
+            indexed_bvh1,
+            indexed_bvh2,
+            [&visited]
+            ( const Mesh_Face*, const Mesh_Face* )
+            {
+                ++visited;
+            } ),
+        std::invalid_argument );
+    ASSERT_EQ( visited, 0u );
+
+    Task_Scheduler scheduler( 2u );
+    ASSERT_THROW( pairwise_pruning( indexed_bvh1, indexed_bvh2, scheduler, 1u ), std::invalid_argument );
+
+    auto front = Pruning_Front::make_pruning_front( indexed_bvh1, indexed_bvh2 );
+    ASSERT_THROW( pairwise_pruning( front ), std::invalid_argument );
+    ASSERT_FALSE( pairwise_pruning_face_indices( front ).empty() );
+
+    const auto quantized1 = Quantized_BVH<std::uint16_t>::make_quantized_BVH( indexed_bvh1 );
+    const auto quantized2 = Quantized_BVH<std::uint16_t>::make_quantized_BVH( indexed_bvh2 );
+    ASSERT_THROW( pairwise_pruning( quantized1, quantized2 ), std::invalid_argument );
+
+    // quantized pruning finds the same face pairs, up to the looser bounds
+    auto indices = pairwise_pruning_face_indices( indexed_bvh1, indexed_bvh2 );
+    auto quantized_indices = pairwise_pruning_face_indices( quantized1, quantized2 );
+    std::sort( indices.begin(), indices.end() );
+    std::sort( quantized_indices.begin(), quantized_indices.end() );
+    ASSERT_TRUE( std::includes( quantized_indices.begin(), quantized_indices.end(), indices.begin(), indices.end() ) );
+
+    auto node = indexed_bvh1.get_root();
+    while( !node.get_child_volumes().empty() )
+    {
+        node = node.get_child_volumes()[0u];
+    }
+    ASSERT_EQ( node.get_face(), nullptr );
+
+    // still found in the face indices
+    ASSERT_TRUE( any_collision( indexed_bvh1, indexed_bvh2 ) );
+}
+
+TEST( Indexed_Mesh, Refit_Matches_Face_Copies )
+{
+    auto grid = make_grid( 20u, 0 );
+    const auto mesh = Indexed_Mesh::make_indexed_mesh( grid.vertices, grid.indices );
+    const auto faces = expand_faces( mesh );
+
+    auto indexed_bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+    auto bvh         = BoundingVolumeHierarchy::make_BVH_topDown( faces, Binned_SAH_Split() );
+
+    // move vertices in place, the view sees them without a copy
+    for( auto& vertex : grid.vertices )
+    {
+        vertex.data[2u] += 0.3 * vertex.data[0u];
+    }
+
+    const auto moved_faces = expand_faces( mesh );
+
+    indexed_bvh.refit( mesh );
+    bvh.refit( moved_faces );
+
+    expect_same_bvh( indexed_bvh, bvh );
+}
+
+TEST( Indexed_Mesh, Strided_Buffers )
+{
+    // interleaved position and normal, triangles followed by a material id
+    const auto grid = make_grid( 10u, 0 );
+
+    std::vector<CoDet::float_t> vertex_buffer;
+    for( const auto& vertex : grid.vertices )
+    {
+        vertex_buffer.insert( vertex_buffer.end(), vertex.data.begin(), vertex.data.end() );
+        vertex_buffer.insert( vertex_buffer.end(), { 0, 0, 1 } );
+    }
+
+    std::vector<std::uint32_t> index_buffer;
+    for( std::size_t t=0u; t<grid.indices.size(); t+=3u )
+    {
+        index_buffer.insert( index_buffer.end(), grid.indices.begin() + t, grid.indices.begin() + t + 3u );
+        index_buffer.push_back( 7u );
+    }
+
+    const auto packed = Indexed_Mesh::make_indexed_mesh( grid.vertices, grid.indices );
+    const auto strided =
+        Indexed_Mesh::make_indexed_mesh(
+            vertex_buffer.data(),
+            6u * sizeof(CoDet::float_t),
+            index_buffer.data(),
+            4u * sizeof(std::uint32_t),
+            grid.indices.size() / 3u );
+
+    ASSERT_EQ( packed.size(), strided.size() );
+    ASSERT_EQ( expand_faces( packed ), expand_faces( strided ) );
+
+    expect_same_bvh(
+        BoundingVolumeHierarchy::make_BVH_topDown( packed, Binned_SAH_Split() ),
+        BoundingVolumeHierarchy::make_BVH_topDown( strided, Binned_SAH_Split() ) );
+}
+
+TEST( Indexed_Mesh, Self_Pruning )
+{
+    // two interpenetrating sheets in one mesh
+    auto grid = make_grid( 20u, 0 );
+    const auto sheet = make_grid( 20u, 0.45 );
+    const auto first_vertex = static_cast<std::uint32_t>( grid.vertices.size() );
+
+    grid.vertices.insert( grid.vertices.end(), sheet.vertices.begin(), sheet.vertices.end() );
+    for( const auto index : sheet.indices )
+    {
+        grid.indices.push_back( first_vertex + index );
+    }
+
+    const auto mesh = Indexed_Mesh::make_indexed_mesh( grid.vertices, grid.indices );
+    const auto faces = expand_faces( mesh );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto indexed_bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split(), options );
+    const auto bvh         = BoundingVolumeHierarchy::make_BVH_topDown( faces, Binned_SAH_Split() );
+
+    // same BVH passed twice, each unordered pair of distinct faces kept once
+    pairwise_pruning_face_indices_t expected;
+    pairwise_pruning_face_indices_t expected_non_adjacent;
+    for( const auto& pair : pairwise_pruning_face_indices( bvh, bvh ) )
+    {
+        const auto face1 = std::get<0u>( pair );
+        const auto face2 = std::get<1u>( pair );
+
+        if ( face1 < face2 )
+        {
+            expected.push_back( pair );
+
+            const auto* const triangle1 = mesh.get_triangle( face1 );
+            const auto* const triangle2 = mesh.get_triangle( face2 );
+
+            const bool adjacent =
+                std::any_of(
+                    triangle1,
+                    triangle1 + 3u,
+                    [triangle2]( const std::uint32_t v ){ return std::count( triangle2, triangle2 + 3u, v ) != 0; } );
+
+            if ( !adjacent )
+            {
+                expected_non_adjacent.push_back( pair );
+            }
+        }
+    }
+
+    ASSERT_FALSE( expected_non_adjacent.empty() );
+    ASSERT_LT( expected_non_adjacent.size(), expected.size() );
+
+    std::sort( expected.begin(), expected.end() );
+    std::sort( expected_non_adjacent.begin(), expected_non_adjacent.end() );
+
+    const auto check =
+        []
+        ( pairwise_pruning_face_indices_t candidate_faces, const pairwise_pruning_face_indices_t& expected_faces )
+        {
+            std::sort( candidate_faces.begin(), candidate_faces.end() );
+            ASSERT_EQ( candidate_faces, expected_faces );
+        };
+
+    check( self_pruning( bvh ), expected );
+    check( self_pruning( indexed_bvh ), expected );
+
+    // by index for the indexed mesh, by position for its face copies
+    Pruning_Context context;
+    check( self_pruning( indexed_bvh, context, Adjacent_Faces::skip ), expected_non_adjacent );
+    check( self_pruning( bvh, context, Adjacent_Faces::skip ), expected_non_adjacent );
+}
+
+TEST( Indexed_Mesh, Empty_Vertices )
+{
+    const auto mesh =
+        Indexed_Mesh::make_indexed_mesh(
+            std::vector<Point>(),
+            std::vector<std::uint32_t>() );
+
+    ASSERT_EQ( mesh.size(), 0u );
+}
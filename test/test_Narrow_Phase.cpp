@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../Narrow_Phase.h"
+#include "../Pairwise_Pruning.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Naive_Oct_Split.h"
+#include "../Mesh_Face.h"
+
+using namespace CoDet;
+
+using mesh_t = std::vector<Mesh_Face>;
+
+static
+bool
+near(
+        const Point& l,
+        const Point& r )
+{
+    return
+          (std::abs( l.data[0u] - r.data[0u] ) < 1e-9)
+        & (std::abs( l.data[1u] - r.data[1u] ) < 1e-9)
+        & (std::abs( l.data[2u] - r.data[2u] ) < 1e-9);
+}
+
+TEST( Narrow_Phase, Crossing_Triangles )
+{
+    const Mesh_Face face1{
+        Point{ 0,0,0},
+        Point{ 4,0,0},
+        Point{ 0,4,0} };
+    const Mesh_Face face2{
+        Point{ 1,1,-1},
+        Point{ 1,1, 1},
+        Point{ 5,1, 1} };
+
+    const pairwise_pruning_return_t candidates{ std::make_tuple( &face1, &face2 ) };
+
+    const auto intersections = narrow_phase( candidates );
+
+    ASSERT_EQ( intersections.size(), 1u );
+    ASSERT_EQ( intersections[0u].face1, &face1 );
+    ASSERT_EQ( intersections[0u].face2, &face2 );
+    ASSERT_FALSE( intersections[0u].coplanar );
+
+    // face2 meets plane z=0 along y=1, from x=1 to x=3, clipped by face1 at x+y=4
+    const auto& segment = intersections[0u].segment;
+    ASSERT_TRUE(
+           (near( segment[0u], Point{ 1,1,0 } ) && near( segment[1u], Point{ 3,1,0 } ))
+        || (near( segment[1u], Point{ 1,1,0 } ) && near( segment[0u], Point{ 3,1,0 } )) );
+}
+
+TEST( Narrow_Phase, Overlapping_Bounds_Without_Intersection )
+{
+    const Mesh_Face face1{
+        Point{ 0,0,0},
+        Point{ 4,0,0},
+        Point{ 0,4,0} };
+    // plane crosses face1 plane outside face1
+    const Mesh_Face face2{
+        Point{ 3,3,-1},
+        Point{ 3,3, 1},
+        Point{ 4,2, 1} };
+    // strictly above face1 plane
+    const Mesh_Face face3{
+        Point{ 0,0,1},
+        Point{ 4,0,2},
+        Point{ 0,4,1} };
+
+    const pairwise_pruning_return_t candidates{
+        std::make_tuple( &face1, &face2 ),
+        std::make_tuple( &face1, &face3 ) };
+
+    ASSERT_TRUE( narrow_phase( candidates ).empty() );
+}
+
+TEST( Narrow_Phase, Coplanar_Triangles )
+{
+    const Mesh_Face face1{
+        Point{ 0,0,0},
+        Point{ 4,0,0},
+        Point{ 0,4,0} };
+    const Mesh_Face face2{
+        Point{ 1,1,0},
+        Point{ 5,1,0},
+        Point{ 1,5,0} };
+    const Mesh_Face face3{
+        Point{ 3,3,0},
+        Point{ 5,3,0},
+        Point{ 3,5,0} };
+
+    const pairwise_pruning_return_t candidates{
+        std::make_tuple( &face1, &face2 ),
+        std::make_tuple( &face1, &face3 ) };
+
+    const auto intersections = narrow_phase( candidates );
+
+    ASSERT_EQ( intersections.size(), 1u );
+    ASSERT_EQ( intersections[0u].face2, &face2 );
+    ASSERT_TRUE( intersections[0u].coplanar );
+}
+
+TEST( Narrow_Phase, Coplanar_Triangles_In_Tilted_Plane )
+{
+    // vertices on x + 2y + 3z = 1.7 are only on it to rounding
+    const auto on_plane =
+        []
+        ( const CoDet::float_t x, const CoDet::float_t y )
+        {
+            return Point{ x, y, (CoDet::float_t( 1.7 ) - x - 2*y) / 3 };
+        };
+
+    mesh_t faces;
+    for( unsigned int i=0u; i<100u; ++i )
+    {
+        const CoDet::float_t x = CoDet::float_t( 0.37 ) * i - 10;
+        const CoDet::float_t y = CoDet::float_t( 0.11 ) * i + CoDet::float_t( 0.05 ) * (i % 7u);
+
+        faces.push_back( Mesh_Face{ on_plane( x,y ), on_plane( x+1,y ), on_plane( x,y+1 ) } );
+        // overlaps the first one
+        faces.push_back( Mesh_Face{ on_plane( x+CoDet::float_t( 0.25 ),y+CoDet::float_t( 0.25 ) ), on_plane( x+CoDet::float_t( 1.25 ),y+CoDet::float_t( 0.25 ) ), on_plane( x+CoDet::float_t( 0.25 ),y+CoDet::float_t( 1.25 ) ) } );
+        // next to the first one
+        faces.push_back( Mesh_Face{ on_plane( x+1,y+1 ), on_plane( x+2,y+1 ), on_plane( x+1,y+2 ) } );
+    }
+
+    pairwise_pruning_return_t overlapping;
+    pairwise_pruning_return_t disjoint;
+    for( std::size_t f=0u; f<faces.size(); f+=3u )
+    {
+        overlapping.emplace_back( &faces[f], &faces[f + 1u] );
+        disjoint.emplace_back( &faces[f], &faces[f + 2u] );
+    }
+
+    const auto intersections = narrow_phase( overlapping );
+
+    ASSERT_EQ( intersections.size(), overlapping.size() );
+    for( const auto& intersection : intersections )
+    {
+        ASSERT_TRUE( intersection.coplanar );
+    }
+
+    ASSERT_TRUE( narrow_phase( disjoint ).empty() );
+}
+
+TEST( Narrow_Phase, Filters_Pruning_Candidates )
+{
+    // fan of faces around the z axis, pierced by a vertical face on the x axis
+    mesh_t mesh1;
+    for( unsigned int i=0u; i<40u; ++i )
+    {
+        const double a0 = 0.15 * i;
+        const double a1 = 0.15 * (i+1u);
+        mesh1.emplace_back(
+            Mesh_Face{
+                Point{ 0,0,0},
+                Point{ CoDet::float_t(3*std::cos(a0)), CoDet::float_t(3*std::sin(a0)), 0 },
+                Point{ CoDet::float_t(3*std::cos(a1)), CoDet::float_t(3*std::sin(a1)), 0 } } );
+    }
+    const mesh_t mesh2{
+        Mesh_Face{
+            Point{ 1,   0.05, -1 },
+            Point{ 2,  -0.05, -1 },
+            Point{ 1.5, 0,     1 } } };
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh1, Naive_Oct_Split );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh2, Naive_Oct_Split );
+
+    const auto candidates    = pairwise_pruning( bvh1, bvh2 );
+    const auto intersections = narrow_phase( candidates );
+
+    ASSERT_GE( candidates.size(), intersections.size() );
+    ASSERT_FALSE( intersections.empty() );
+
+    for( const auto& intersection : intersections )
+    {
+        // only faces touching the positive x axis are hit
+        const auto& face = *intersection.face1;
+        ASSERT_LE( face.vertices[1u].data[1u] * face.vertices[2u].data[1u], 0 );
+        ASSERT_GT( face.vertices[1u].data[0u] + face.vertices[2u].data[0u], 0 );
+    }
+}
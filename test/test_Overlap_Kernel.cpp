@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "../Overlap_Kernel.h"
+
+using namespace CoDet;
+
+static
+bool
+reference_overlap(
+        const Node_BBox& a,
+        const Node_BBox& b )
+{
+    bool ret = true;
+    for( unsigned int coord=0u; coord<3u; ++coord )
+    {
+        ret = ret
+            && (a.min[coord] < b.max[coord])
+            && (a.max[coord] > b.min[coord]);
+    }
+    return ret;
+}
+
+static
+Node_BBox
+random_bbox(
+        std::mt19937&   rng )
+{
+    std::uniform_real_distribution<bound_t> position( 0, 10 );
+    std::uniform_real_distribution<bound_t> extent( 0, 4 );
+
+    Node_BBox bbox;
+    for( unsigned int coord=0u; coord<3u; ++coord )
+    {
+        bbox.min[coord] = position( rng );
+        bbox.max[coord] = bbox.min[coord] + extent( rng );
+    }
+    return bbox;
+}
+
+TEST( Overlap_Kernel, Matches_Scalar_Test )
+{
+    std::mt19937 rng( 42u );
+
+    std::vector<Compact_BVH_Node> nodes( 100u );
+    for( auto& node : nodes )
+    {
+        node.bbox = random_bbox( rng );
+    }
+    const auto soa = make_node_bounds_soa( nodes );
+
+    for( unsigned int trial=0u; trial<200u; ++trial )
+    {
+        const auto query = random_bbox( rng );
+        const auto first = static_cast<std::uint32_t>( trial % 60u );
+        const auto count = static_cast<std::uint32_t>( 1u + trial % overlap_mask_width );
+
+        const auto mask = overlap_mask( query, soa, first, count );
+
+        for( std::uint32_t i=0u; i<overlap_mask_width; ++i )
+        {
+            const bool expected = (i < count) && reference_overlap( query, nodes[first+i].bbox );
+            ASSERT_EQ( 0u != (mask & (1u << i)), expected );
+        }
+    }
+}
+
+TEST( Overlap_Kernel, Touching_Boxes_Do_Not_Overlap )
+{
+    std::vector<Compact_BVH_Node> nodes( 2u );
+    nodes[0u].bbox = Node_BBox{ {{ 1,0,0 }}, {{ 2,1,1 }} };
+    nodes[1u].bbox = Node_BBox{ {{ 0.5,0.5,0.5 }}, {{ 0.75,0.75,0.75 }} };
+    const auto soa = make_node_bounds_soa( nodes );
+
+    const Node_BBox query{ {{ 0,0,0 }}, {{ 1,1,1 }} };
+
+    ASSERT_EQ( overlap_mask( query, soa, 0u, 2u ), 2u );
+}
+
+TEST( Overlap_Kernel, Node_Bounds_Are_Rounded_Outwards )
+{
+    std::mt19937 rng( 7u );
+    std::uniform_real_distribution<CoDet::float_t> position( -1e3, 1e3 );
+
+    for( unsigned int trial=0u; trial<1000u; ++trial )
+    {
+        BBox bbox;
+        for( unsigned int coord=0u; coord<3u; ++coord )
+        {
+            bbox.min.data[coord] = position( rng );
+            bbox.max.data[coord] = bbox.min.data[coord] + 1e-7;
+        }
+
+        const auto node_bbox = make_node_bbox( bbox );
+
+        for( unsigned int coord=0u; coord<3u; ++coord )
+        {
+            ASSERT_LE( node_bbox.min[coord], bbox.min.data[coord] );
+            ASSERT_GE( node_bbox.max[coord], bbox.max.data[coord] );
+        }
+    }
+}
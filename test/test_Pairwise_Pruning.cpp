@@ -2,7 +2,14 @@
 #include "../Pairwise_Pruning.h"
 #include "../BoundingVolumeHierarchy.h"
 #include "../Naive_Oct_Split.h"
+#include "../Binned_SAH_Split.h"
+#include "../Rigid_Transform.h"
+#include "../Narrow_Phase.h"
 #include "../Mesh_Face.h"
+#include "../Task_Scheduler.h"
+#include "Test_Meshes.h"
+#include <algorithm>
+#include <iterator>
 
 using namespace CoDet;
 
@@ -306,3 +313,578 @@ TEST( Pairwise_Pruning, MultipleFaces_Collision )
     check_pair( 4u, 4u );
 }
 
+TEST( Pairwise_Pruning, Parallel_Matches_Serial )
+{
+    const auto mesh1 = make_grid_mesh( 30u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 30u, Point{ 0.3, 0.6, 0.2 } );
+
+    BoundingVolumeHierarchy bvh1(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh1,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh2(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh2,
+            Naive_Oct_Split ) );
+
+    Task_Scheduler scheduler( 4u );
+
+    auto serial   = pairwise_pruning( bvh1, bvh2 );
+    auto parallel = pairwise_pruning( bvh1, bvh2, scheduler, 1u );
+
+    ASSERT_FALSE( serial.empty() );
+
+    std::sort( serial.begin(), serial.end() );
+    std::sort( parallel.begin(), parallel.end() );
+
+    ASSERT_EQ( serial, parallel );
+}
+
+TEST( Pairwise_Pruning, Depth_First_Matches_Breadth_First )
+{
+    const auto mesh1 = make_grid_mesh( 30u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 30u, Point{ 0.3, 0.6, 0.2 } );
+
+    BoundingVolumeHierarchy bvh1(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh1,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh2(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh2,
+            Naive_Oct_Split ) );
+
+    auto breadth_first = pairwise_pruning( bvh1, bvh2 );
+    auto depth_first   = pairwise_pruning_depth_first( bvh1, bvh2 );
+
+    ASSERT_FALSE( breadth_first.empty() );
+
+    std::sort( breadth_first.begin(), breadth_first.end() );
+    std::sort( depth_first.begin(), depth_first.end() );
+
+    ASSERT_EQ( breadth_first, depth_first );
+}
+
+TEST( Pairwise_Pruning, Context_Reuse )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+    const auto mesh3 = make_grid_mesh( 20u, Point{ 50,  0,   0   } );
+
+    BoundingVolumeHierarchy bvh1(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh1,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh2(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh2,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh3(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh3,
+            Naive_Oct_Split ) );
+
+    const auto expected = pairwise_pruning( bvh1, bvh2 );
+    ASSERT_FALSE( expected.empty() );
+
+    Pruning_Context context;
+
+    ASSERT_EQ( pairwise_pruning( bvh1, bvh2, context ), expected );
+
+    const auto* const buffer = context.candidate_faces.data();
+
+    // no result is left over from the previous query
+    ASSERT_TRUE( pairwise_pruning( bvh1, bvh3, context ).empty() );
+
+    // same query again reuses the same storage
+    ASSERT_EQ( pairwise_pruning( bvh1, bvh2, context ), expected );
+    ASSERT_EQ( context.candidate_faces.data(), buffer );
+
+    auto depth_first = pairwise_pruning_depth_first( bvh1, bvh2, context );
+    auto sorted_expected = expected;
+
+    std::sort( depth_first.begin(), depth_first.end() );
+    std::sort( sorted_expected.begin(), sorted_expected.end() );
+
+    ASSERT_EQ( depth_first, sorted_expected );
+
+    // other depth-first queries take their traversal buffer from the context
+    pairwise_pruning_return_t visited;
+    const auto result =
+        pairwise_pruning(
+            bvh1,
+            bvh2,
+            [&visited]
+            ( const Mesh_Face* face1, const Mesh_Face* face2 )
+            {
+                visited.emplace_back( face1, face2 );
+            },
+            context );
+
+    ASSERT_EQ( result, Visit_Result::proceed );
+    std::sort( visited.begin(), visited.end() );
+    ASSERT_EQ( visited, sorted_expected );
+
+    ASSERT_TRUE( any_collision( bvh1, bvh2, context ) );
+    ASSERT_FALSE( any_collision( bvh1, bvh3, context ) );
+}
+
+TEST( Pairwise_Pruning, Visitor_And_Output_Iterator )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+    const auto mesh3 = make_grid_mesh( 20u, Point{ 50,  0,   0   } );
+
+    BoundingVolumeHierarchy bvh1(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh1,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh2(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh2,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh3(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh3,
+            Naive_Oct_Split ) );
+
+    auto expected = pairwise_pruning( bvh1, bvh2 );
+    ASSERT_GT( expected.size(), 1u );
+    std::sort( expected.begin(), expected.end() );
+
+    // visitor returning void sees every pair
+    pairwise_pruning_return_t visited;
+    const auto result =
+        pairwise_pruning(
+            bvh1,
+            bvh2,
+            [&visited]
+            ( const Mesh_Face* face1, const Mesh_Face* face2 )
+            {
+                visited.emplace_back( face1, face2 );
+            } );
+
+    ASSERT_EQ( result, Visit_Result::proceed );
+    std::sort( visited.begin(), visited.end() );
+    ASSERT_EQ( visited, expected );
+
+    // visitor stopping at the first pair
+    std::size_t count = 0u;
+    const auto stopped =
+        pairwise_pruning(
+            bvh1,
+            bvh2,
+            [&count]
+            ( const Mesh_Face*, const Mesh_Face* )
+            {
+                ++count;
+                return Visit_Result::stop;
+            } );
+
+    ASSERT_EQ( stopped, Visit_Result::stop );
+    ASSERT_EQ( count, 1u );
+
+    pairwise_pruning_return_t copied;
+    pairwise_pruning( bvh1, bvh2, std::back_inserter( copied ) );
+    std::sort( copied.begin(), copied.end() );
+    ASSERT_EQ( copied, expected );
+
+    ASSERT_TRUE( any_collision( bvh1, bvh2 ) );
+    ASSERT_FALSE( any_collision( bvh1, bvh3 ) );
+}
+
+TEST( Pairwise_Pruning, Face_Indices )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+    const auto mesh3 = make_grid_mesh( 20u, Point{ 50,  0,   0   } );
+
+    BoundingVolumeHierarchy bvh1(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh1,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh2(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh2,
+            Naive_Oct_Split ) );
+    BoundingVolumeHierarchy bvh3(
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh3,
+            Naive_Oct_Split ) );
+
+    ASSERT_EQ( sizeof(pairwise_pruning_face_indices_t::value_type), 2u * sizeof(std::uint32_t) );
+
+    // same pairs, in the same order, as indices into the source vectors
+    pairwise_pruning_face_indices_t expected;
+    for( const auto& pair : pairwise_pruning( bvh1, bvh2 ) )
+    {
+        expected.emplace_back(
+            static_cast<std::uint32_t>( std::get<0u>( pair ) - mesh1.data() ),
+            static_cast<std::uint32_t>( std::get<1u>( pair ) - mesh2.data() ) );
+    }
+
+    ASSERT_FALSE( expected.empty() );
+    ASSERT_EQ( pairwise_pruning_face_indices( bvh1, bvh2 ), expected );
+
+    Pruning_Context context;
+
+    ASSERT_EQ( pairwise_pruning_face_indices( bvh1, bvh2, context ), expected );
+    ASSERT_TRUE( pairwise_pruning_face_indices( bvh1, bvh3, context ).empty() );
+
+    Task_Scheduler scheduler( 4u );
+
+    auto parallel = pairwise_pruning_face_indices( bvh1, bvh2, scheduler, 1u );
+
+    std::sort( parallel.begin(), parallel.end() );
+    std::sort( expected.begin(), expected.end() );
+
+    ASSERT_EQ( parallel, expected );
+}
+
+TEST( Pairwise_Pruning, Multi_Face_Leaves_Match_Single_Face_Leaves )
+{
+    const auto mesh1 = make_grid_mesh( 30u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 30u, Point{ 0.3, 0.6, 0.2 } );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 8u;
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh1, Naive_Oct_Split );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh2, Naive_Oct_Split );
+    const auto leaves1 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh1, Naive_Oct_Split, options );
+    const auto leaves2 = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh2, Naive_Oct_Split, options );
+
+    auto expected = pairwise_pruning( bvh1, bvh2 );
+    ASSERT_FALSE( expected.empty() );
+    std::sort( expected.begin(), expected.end() );
+
+    const auto check =
+        [&expected]
+        ( pairwise_pruning_return_t candidate_faces )
+        {
+            std::sort( candidate_faces.begin(), candidate_faces.end() );
+            ASSERT_EQ( candidate_faces, expected );
+        };
+
+    // face bounds prune leaf pairs down to the same face pairs,
+    // also when only one of the trees has multi-face leaves
+    check( pairwise_pruning( leaves1, leaves2 ) );
+    check( pairwise_pruning( leaves1, bvh2 ) );
+    check( pairwise_pruning( bvh1, leaves2 ) );
+    check( pairwise_pruning_depth_first( leaves1, leaves2 ) );
+
+    ASSERT_TRUE( any_collision( leaves1, leaves2 ) );
+}
+
+TEST( Pairwise_Pruning, Linear_BVH_Matches_Top_Down )
+{
+    const auto mesh1 = make_grid_mesh( 30u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 30u, Point{ 0.3, 0.6, 0.2 } );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    auto expected = pairwise_pruning( bvh1, bvh2 );
+    ASSERT_FALSE( expected.empty() );
+    std::sort( expected.begin(), expected.end() );
+
+    // leaves bound the same faces whichever way they are grouped
+    auto candidate_faces = pairwise_pruning( BoundingVolumeHierarchy::make_BVH_linear( mesh1 ), BoundingVolumeHierarchy::make_BVH_linear( mesh2 ) );
+    std::sort( candidate_faces.begin(), candidate_faces.end() );
+    ASSERT_EQ( candidate_faces, expected );
+
+    candidate_faces = pairwise_pruning( BoundingVolumeHierarchy::make_BVH_linear( mesh1, options ), bvh2 );
+    std::sort( candidate_faces.begin(), candidate_faces.end() );
+    ASSERT_EQ( candidate_faces, expected );
+}
+
+/*  Rotation about z, then about x, given by cosine and sine of each angle. */
+static
+Rigid_Transform
+make_pose(
+        const float_t   cos_z,
+        const float_t   sin_z,
+        const float_t   cos_x,
+        const float_t   sin_x,
+        const Point&    translation )
+{
+    const auto rotation_z =
+        Rigid_Transform{
+            { {
+                Point{ { cos_z, -sin_z, 0 } },
+                Point{ { sin_z,  cos_z, 0 } },
+                Point{ { 0, 0, 1 } } } },
+            translation };
+    const auto rotation_x =
+        Rigid_Transform{
+            { {
+                Point{ { 1, 0, 0 } },
+                Point{ { 0, cos_x, -sin_x } },
+                Point{ { 0, sin_x,  cos_x } } } },
+            Point{ { 0, 0, 0 } } };
+
+    return compose( rotation_z, rotation_x );
+}
+
+static
+mesh_t
+transform_mesh(
+        const Rigid_Transform&  transform,
+        const mesh_t&           mesh )
+{
+    mesh_t ret( mesh );
+
+    for( auto& face : ret )
+    {
+        for( auto& vertex : face.vertices )
+        {
+            vertex = transform_point( transform, vertex );
+        }
+    }
+
+    return ret;
+}
+
+TEST( Pairwise_Pruning, Rigid_Transforms )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split(), options );
+
+    // placing both at the same pose keeps them as they are
+    const auto shared_pose = make_pose( 0.6, 0.8, 1, 0, Point{ { 3, -2, 1 } } );
+
+    auto expected = pairwise_pruning_face_indices( bvh1, bvh2 );
+    auto transformed = pairwise_pruning_face_indices( bvh1, shared_pose, bvh2, shared_pose );
+
+    ASSERT_FALSE( expected.empty() );
+    std::sort( expected.begin(), expected.end() );
+    std::sort( transformed.begin(), transformed.end() );
+
+    ASSERT_TRUE( std::includes( transformed.begin(), transformed.end(), expected.begin(), expected.end() ) );
+
+    const auto identity = make_identity_transform();
+    auto identity_candidates = pairwise_pruning( bvh1, identity, bvh2, identity );
+    auto plain_candidates = pairwise_pruning( bvh1, bvh2 );
+
+    std::sort( identity_candidates.begin(), identity_candidates.end() );
+    std::sort( plain_candidates.begin(), plain_candidates.end() );
+
+    ASSERT_EQ( identity_candidates, plain_candidates );
+
+    // at distinct poses, candidates cover every pair of faces that does
+    // intersect once the meshes are transformed
+    const auto pose1 = make_pose( 0.8,  0.6, 1,    0,    Point{ { 1, 2, 0 } } );
+    const auto pose2 = make_pose( 0.6,  0.8, 0.96, 0.28, Point{ { 1, 2, 0 } } );
+
+    const auto moved1 = transform_mesh( pose1, mesh1 );
+    const auto moved2 = transform_mesh( pose2, mesh2 );
+
+    const auto intersections =
+        narrow_phase(
+            pairwise_pruning(
+                BoundingVolumeHierarchy::make_BVH_topDown( moved1, Binned_SAH_Split() ),
+                BoundingVolumeHierarchy::make_BVH_topDown( moved2, Binned_SAH_Split() ) ) );
+
+    Pruning_Context context;
+    auto posed = pairwise_pruning_face_indices( bvh1, pose1, bvh2, pose2, context );
+    std::sort( posed.begin(), posed.end() );
+
+    ASSERT_FALSE( intersections.empty() );
+
+    for( const auto& intersection : intersections )
+    {
+        const pairwise_pruning_face_indices_t::value_type pair(
+            static_cast<std::uint32_t>( intersection.face1 - moved1.data() ),
+            static_cast<std::uint32_t>( intersection.face2 - moved2.data() ) );
+
+        ASSERT_TRUE( std::binary_search( posed.begin(), posed.end(), pair ) );
+    }
+
+    ASSERT_TRUE( any_collision( bvh1, pose1, bvh2, pose2 ) );
+    ASSERT_TRUE( any_collision( bvh1, pose1, bvh2, pose2, context ) );
+
+    // moved apart, nothing is left
+    const auto far_pose = make_pose( 0.28, -0.96, 0.6, 0.8, Point{ { 100, 0, 0 } } );
+
+    ASSERT_TRUE( pairwise_pruning( bvh1, pose1, bvh2, far_pose ).empty() );
+    ASSERT_FALSE( any_collision( bvh1, pose1, bvh2, far_pose ) );
+}
+
+TEST( Pairwise_Pruning, Front_Follows_Motion )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split(), options );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    auto front = Pruning_Front::make_pruning_front( bvh1, bvh2 );
+    const auto pose2 = make_identity_transform();
+
+    // slide apart until disjoint, then back, turning a little every step
+    for( int step=-12; step<=12; ++step )
+    {
+        const double shift = 2.0 * (12 - (step < 0 ? -step : step));
+        const auto pose1 = make_pose( (step % 2) ? 0.96 : 1, (step % 2) ? 0.28 : 0, 1, 0, Point{ { float_t(shift), float_t(0.5 * shift), 0 } } );
+
+        auto expected = pairwise_pruning_face_indices( bvh1, pose1, bvh2, pose2 );
+        auto coherent = pairwise_pruning_face_indices( front, pose1, pose2 );
+
+        std::sort( expected.begin(), expected.end() );
+        std::sort( coherent.begin(), coherent.end() );
+
+        ASSERT_EQ( coherent, expected );
+
+        if ( 0 == step )
+        {
+            // separated roots, the front has collapsed back to them
+            ASSERT_TRUE( expected.empty() );
+            ASSERT_EQ( front.size(), 1u );
+        }
+    }
+}
+
+TEST( Pairwise_Pruning, Front_Follows_Refit )
+{
+    auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+
+    auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    auto front = Pruning_Front::make_pruning_front( bvh1, bvh2 );
+
+    // faces of the first mesh rise through the second one, row by row at different speeds
+    for( unsigned int step=0u; step<10u; ++step )
+    {
+        for( std::size_t face=0u; face<mesh1.size(); ++face )
+        {
+            mesh1[face] = translate_face( mesh1[face], Point{ 0, 0, float_t(0.05 * (face % 7u)) } );
+        }
+
+        bvh1.refit( mesh1 );
+
+        auto expected = pairwise_pruning( bvh1, bvh2 );
+        auto coherent = pairwise_pruning( front );
+
+        std::sort( expected.begin(), expected.end() );
+        std::sort( coherent.begin(), coherent.end() );
+
+        ASSERT_EQ( coherent, expected );
+    }
+}
+
+TEST( Pairwise_Pruning, Front_Starts_Over_After_Rebuild )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+    const auto mesh3 = make_grid_mesh( 12u, Point{ 0.6, 0.3, 0.1 } );
+
+    auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    auto front = Pruning_Front::make_pruning_front( bvh1, bvh2 );
+    ASSERT_FALSE( pairwise_pruning( front ).empty() );
+
+    // other topology in the same object
+    bvh1 =
+        BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>(
+            mesh3,
+            Naive_Oct_Split );
+
+    auto expected = pairwise_pruning( bvh1, bvh2 );
+    auto coherent = pairwise_pruning( front );
+
+    ASSERT_FALSE( expected.empty() );
+
+    std::sort( expected.begin(), expected.end() );
+    std::sort( coherent.begin(), coherent.end() );
+
+    ASSERT_EQ( coherent, expected );
+}
+
+TEST( Pairwise_Pruning, Front_Starts_Over_After_Rebuild_Of_Same_Size )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+
+    auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    // copies and refits keep the generation, builds do not
+    const auto generation = bvh1.get_build_generation();
+    ASSERT_EQ( BoundingVolumeHierarchy( bvh1 ).get_build_generation(), generation );
+    ASSERT_TRUE( bvh1.refit( mesh1 ) );
+    ASSERT_EQ( bvh1.get_build_generation(), generation );
+
+    auto front = Pruning_Front::make_pruning_front( bvh1, bvh2 );
+    ASSERT_FALSE( pairwise_pruning( front ).empty() );
+
+    // binary trees of one face per leaf, as many nodes in another topology
+    bvh1 = BoundingVolumeHierarchy::make_BVH_linear( mesh1 );
+
+    ASSERT_NE( bvh1.get_build_generation(), generation );
+    ASSERT_EQ( bvh1.get_nodes().size(), bvh2.get_nodes().size() );
+
+    auto expected = pairwise_pruning( bvh1, bvh2 );
+    auto coherent = pairwise_pruning( front );
+
+    std::sort( expected.begin(), expected.end() );
+    std::sort( coherent.begin(), coherent.end() );
+
+    ASSERT_EQ( coherent, expected );
+}
+
+TEST( Pairwise_Pruning, Self_Pruning_Of_Separate_Parts )
+{
+    // faces of both grids in one mesh, pairs across them are the self-intersections
+    const auto mesh1 = make_grid_mesh( 10u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 10u, Point{ 0.3, 0.6, 0.2 } );
+
+    mesh_t mesh( mesh1 );
+    mesh.insert( mesh.end(), mesh2.begin(), mesh2.end() );
+
+    const auto bvh = BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() );
+    const auto candidate_faces = self_pruning( bvh );
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    pairwise_pruning_face_indices_t expected;
+    for( const auto& pair : pairwise_pruning_face_indices( bvh1, bvh2 ) )
+    {
+        expected.emplace_back(
+            std::get<0u>( pair ),
+            static_cast<std::uint32_t>( mesh1.size() ) + std::get<1u>( pair ) );
+    }
+
+    pairwise_pruning_face_indices_t across;
+    for( const auto& pair : candidate_faces )
+    {
+        ASSERT_LT( std::get<0u>( pair ), std::get<1u>( pair ) );
+
+        if ( std::get<1u>( pair ) >= mesh1.size() && std::get<0u>( pair ) < mesh1.size() )
+        {
+            across.push_back( pair );
+        }
+    }
+
+    ASSERT_FALSE( expected.empty() );
+
+    std::sort( expected.begin(), expected.end() );
+    std::sort( across.begin(), across.end() );
+
+    ASSERT_EQ( across, expected );
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <iterator>
+#include "../Quantized_BVH.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Binned_SAH_Split.h"
+#include "../Mesh_Face.h"
+#include "Test_Meshes.h"
+
+using namespace CoDet;
+
+using mesh_t = std::vector<Mesh_Face>;
+
+template <typename Quantized_t>
+static
+void
+check_quantized_bvh(
+        const mesh_t& mesh1,
+        const mesh_t& mesh2 )
+{
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    const auto quantized1 = Quantized_BVH<Quantized_t>::make_quantized_BVH( bvh1 );
+    const auto quantized2 = Quantized_BVH<Quantized_t>::make_quantized_BVH( bvh2 );
+
+    // decoded bounds contain exact ones, walking parents before children
+    const auto& nodes   = bvh1.get_nodes();
+    const auto& qnodes  = quantized1.get_nodes();
+    ASSERT_EQ( nodes.size(), qnodes.size() );
+
+    std::vector<BBox> decoded( qnodes.size() );
+    decoded[0u] = quantized1.get_root_bbox();
+
+    for( std::uint32_t n=0u; n<qnodes.size(); ++n )
+    {
+        ASSERT_EQ( qnodes[n].child_count, nodes[n].child_count );
+        ASSERT_EQ( qnodes[n].first_face, nodes[n].first_face );
+
+        for( auto c=qnodes[n].first_child; c<qnodes[n].first_child+qnodes[n].child_count; ++c )
+        {
+            decoded[c] = decode_bbox( decoded[n], qnodes[c] );
+        }
+
+        const auto exact = to_bbox( nodes[n].bbox );
+        for( unsigned int coord=0u; coord<3u; ++coord )
+        {
+            ASSERT_LE( decoded[n].min.data[coord], exact.min.data[coord] );
+            ASSERT_GE( decoded[n].max.data[coord], exact.max.data[coord] );
+        }
+    }
+
+    // pruning never misses a pair
+    auto exact_pairs     = pairwise_pruning( bvh1, bvh2 );
+    auto quantized_pairs = pairwise_pruning( quantized1, quantized2 );
+
+    ASSERT_FALSE( exact_pairs.empty() );
+
+    std::sort( exact_pairs.begin(), exact_pairs.end() );
+    std::sort( quantized_pairs.begin(), quantized_pairs.end() );
+
+    ASSERT_TRUE( std::includes( quantized_pairs.begin(), quantized_pairs.end(), exact_pairs.begin(), exact_pairs.end() ) );
+}
+
+TEST( Quantized_BVH, Node_Size )
+{
+    ASSERT_LT( sizeof(Quantized_BVH_Node<std::uint8_t>),  sizeof(Compact_BVH_Node) );
+    ASSERT_LT( sizeof(Quantized_BVH_Node<std::uint16_t>), sizeof(Compact_BVH_Node) );
+}
+
+TEST( Quantized_BVH, Conservative_8_Bit )
+{
+    check_quantized_bvh<std::uint8_t>( make_grid_mesh( 25u, Point{ 0, 0, 0 } ), make_grid_mesh( 25u, Point{ 0.45, 0.315, 0 } ) );
+}
+
+TEST( Quantized_BVH, Conservative_16_Bit )
+{
+    check_quantized_bvh<std::uint16_t>( make_grid_mesh( 25u, Point{ 0, 0, 0 } ), make_grid_mesh( 25u, Point{ 0.45, 0.315, 0 } ) );
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include "../Scene_Pruning.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Binned_SAH_Split.h"
+#include "../Pairwise_Pruning.h"
+#include "../Task_Scheduler.h"
+#include "../Mesh_Face.h"
+
+using namespace CoDet;
+
+using mesh_t = std::vector<Mesh_Face>;
+
+/*  Small grid patch at given position. */
+static
+mesh_t
+make_patch(
+        const Point& position )
+{
+    mesh_t mesh;
+
+    for( unsigned int i=0u; i<4u; ++i )
+    for( unsigned int j=0u; j<4u; ++j )
+    {
+        const Point corner{ { position.data[0u] + i, position.data[1u] + j, CoDet::float_t(position.data[2u] + 0.1*i) } };
+
+        mesh.emplace_back(
+            Mesh_Face{
+                corner,
+                corner + Point{ { 1.3, 0,   0.3 } },
+                corner + Point{ { 0,   1.3, 0.6 } } } );
+    }
+
+    return mesh;
+}
+
+/*  Patches scattered over a plane, some of them overlapping. */
+struct
+Scene
+{
+    std::vector<mesh_t>                     meshes;
+    std::vector<BoundingVolumeHierarchy>    bvhs;
+    std::vector<const BoundingVolumeHierarchy*> objects;
+};
+
+static
+std::unique_ptr<Scene>
+make_scene(
+        const unsigned int number_of_objects )
+{
+    auto scene = std::make_unique<Scene>();
+
+    for( unsigned int o=0u; o<number_of_objects; ++o )
+    {
+        scene->meshes.push_back(
+            make_patch( Point{ { CoDet::float_t( ((o * 37u) % 101u) * 0.9 ), CoDet::float_t( (o * 53u) % 23u ), CoDet::float_t( 0.05*(o%3u) ) } } ) );
+    }
+
+    for( const auto& mesh : scene->meshes )
+    {
+        scene->bvhs.push_back( BoundingVolumeHierarchy::make_BVH_topDown( mesh, Binned_SAH_Split() ) );
+    }
+
+    for( const auto& bvh : scene->bvhs )
+    {
+        scene->objects.push_back( &bvh );
+    }
+
+    return scene;
+}
+
+TEST( Scene_Pruning, Sweep_Matches_All_Pairs )
+{
+    const auto scene = make_scene( 200u );
+
+    std::vector<scene_object_pair_t> expected;
+    for( std::uint32_t o1=0u; o1<scene->objects.size(); ++o1 )
+    for( std::uint32_t o2=o1+1u; o2<scene->objects.size(); ++o2 )
+    {
+        const auto& b1 = scene->objects[o1]->get_nodes()[0u].bbox;
+        const auto& b2 = scene->objects[o2]->get_nodes()[0u].bbox;
+
+        bool overlap = true;
+        for( unsigned int coord=0u; coord<3u; ++coord )
+        {
+            overlap = overlap && (b1.min[coord] < b2.max[coord]) && (b1.max[coord] > b2.min[coord]);
+        }
+
+        if ( overlap )
+        {
+            expected.emplace_back( o1, o2 );
+        }
+    }
+
+    ASSERT_FALSE( expected.empty() );
+    ASSERT_EQ( scene_object_pairs( scene->objects ), expected );
+
+    ASSERT_TRUE( scene_object_pairs( {} ).empty() );
+    ASSERT_TRUE( scene_object_pairs( { scene->objects[0u] } ).empty() );
+}
+
+TEST( Scene_Pruning, Candidates_Match_Pairwise_Pruning )
+{
+    const auto scene = make_scene( 200u );
+
+    scene_pruning_return_t expected;
+    for( const auto& pair : scene_object_pairs( scene->objects ) )
+    {
+        const auto o1 = std::get<0u>( pair );
+        const auto o2 = std::get<1u>( pair );
+
+        auto candidate_faces = pairwise_pruning_face_indices( *scene->objects[o1], *scene->objects[o2] );
+
+        if ( !candidate_faces.empty() )
+        {
+            expected.push_back( Object_Pair_Candidates{ o1, o2, std::move( candidate_faces ) } );
+        }
+    }
+
+    ASSERT_FALSE( expected.empty() );
+
+    Task_Scheduler scheduler( 4u );
+
+    for( const auto& result : { scene_pruning( scene->objects ), scene_pruning( scene->objects, scheduler, 1u ) } )
+    {
+        ASSERT_EQ( result.size(), expected.size() );
+
+        for( std::size_t p=0u; p<expected.size(); ++p )
+        {
+            ASSERT_EQ( result[p].object1, expected[p].object1 );
+            ASSERT_EQ( result[p].object2, expected[p].object2 );
+            ASSERT_EQ( result[p].candidate_faces, expected[p].candidate_faces );
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include "../Statistics.h"
+#include "../Pairwise_Pruning.h"
+#include "../BoundingVolumeHierarchy.h"
+#include "../Naive_Oct_Split.h"
+#include "../Binned_SAH_Split.h"
+#include "../Mesh_Face.h"
+#include "../Task_Scheduler.h"
+#include "Test_Meshes.h"
+
+using namespace CoDet;
+
+static
+void
+expect_same_counts(
+        const Pruning_Statistics& l,
+        const Pruning_Statistics& r )
+{
+    EXPECT_EQ( l.node_pairs_visited, r.node_pairs_visited );
+    EXPECT_EQ( l.bbox_tests, r.bbox_tests );
+    EXPECT_EQ( l.bbox_tests_passed, r.bbox_tests_passed );
+    EXPECT_EQ( l.leaf_pairs, r.leaf_pairs );
+}
+
+TEST( Statistics, Pruning_Counters )
+{
+    const auto mesh1 = make_grid_mesh( 20u, Point{ 0,   0,   0   } );
+    const auto mesh2 = make_grid_mesh( 20u, Point{ 0.3, 0.6, 0.2 } );
+
+    const auto bvh1 = BoundingVolumeHierarchy::make_BVH_topDown( mesh1, Binned_SAH_Split() );
+    const auto bvh2 = BoundingVolumeHierarchy::make_BVH_topDown( mesh2, Binned_SAH_Split() );
+
+    reset_pruning_statistics();
+    const auto candidate_faces = pairwise_pruning( bvh1, bvh2 );
+    const auto serial = get_pruning_statistics();
+
+    ASSERT_FALSE( candidate_faces.empty() );
+
+    if ( !statistics_enabled )
+    {
+        expect_same_counts( serial, Pruning_Statistics() );
+        EXPECT_EQ( serial.peak_frontier_size, 0u );
+        return;
+    }
+
+    // single face leaves: every leaf pair is a candidate, every other passed
+    // test, the roots included, is a node pair visited later
+    EXPECT_EQ( serial.leaf_pairs, candidate_faces.size() );
+    EXPECT_EQ( serial.bbox_tests_passed, serial.leaf_pairs + serial.node_pairs_visited );
+    EXPECT_GT( serial.bbox_tests, serial.bbox_tests_passed );
+    EXPECT_GT( serial.peak_frontier_size, 1u );
+    EXPECT_LT( serial.peak_frontier_size, serial.node_pairs_visited );
+
+    // counts add up over queries
+    pairwise_pruning( bvh1, bvh2 );
+    EXPECT_EQ( get_pruning_statistics().node_pairs_visited, 2u * serial.node_pairs_visited );
+    EXPECT_EQ( get_pruning_statistics().peak_frontier_size, serial.peak_frontier_size );
+
+    // chunks of a parallel query count towards the calling thread
+    Task_Scheduler scheduler( 4u );
+
+    reset_pruning_statistics();
+    pairwise_pruning( bvh1, bvh2, scheduler, 1u );
+    expect_same_counts( get_pruning_statistics(), serial );
+    EXPECT_EQ( get_pruning_statistics().peak_frontier_size, serial.peak_frontier_size );
+
+    // depth-first does the same tests, in another order
+    reset_pruning_statistics();
+    pairwise_pruning_depth_first( bvh1, bvh2 );
+    expect_same_counts( get_pruning_statistics(), serial );
+}
+
+TEST( Statistics, Build_Statistics )
+{
+    const auto mesh = make_grid_mesh( 20u, Point{ 0, 0, 0 } );
+
+    BVH_Build_Options options;
+    options.max_leaf_size = 4u;
+
+    const auto check_tree =
+        [&mesh]
+        ( const BoundingVolumeHierarchy& bvh, const std::uint32_t max_leaf_size )
+        {
+            const auto& statistics = get_build_statistics();
+            const auto& histogram = statistics.leaf_size_histogram;
+
+            if ( !statistics_enabled )
+            {
+                EXPECT_EQ( statistics.number_of_nodes, 0u );
+                EXPECT_TRUE( histogram.empty() );
+                return;
+            }
+
+            EXPECT_EQ( statistics.number_of_nodes, bvh.get_nodes().size() );
+            EXPECT_EQ( std::accumulate( histogram.begin(), histogram.end(), 0u ), statistics.number_of_leaves );
+            EXPECT_LE( histogram.size(), max_leaf_size + 1u );
+
+            std::size_t number_of_faces = 0u;
+            for( std::size_t size=0u; size<histogram.size(); ++size )
+            {
+                number_of_faces += size * histogram[size];
+            }
+            EXPECT_EQ( number_of_faces, mesh.size() );
+
+            // deepest leaf, walking down from the root
+            std::uint32_t depth = 0u;
+            std::vector<std::pair<std::uint32_t,std::uint32_t>> stack{ { 0u, 1u } };
+            while( !stack.empty() )
+            {
+                const auto node  = bvh.get_nodes()[stack.back().first];
+                const auto level = stack.back().second;
+                stack.pop_back();
+
+                depth = std::max( depth, level );
+                for( auto c=node.first_child; c<node.first_child+node.child_count; ++c )
+                {
+                    stack.emplace_back( c, level + 1u );
+                }
+            }
+            EXPECT_EQ( statistics.depth, depth );
+        };
+
+    const auto top_down = BoundingVolumeHierarchy::make_BVH_topDown<decltype(Naive_Oct_Split)>( mesh, Naive_Oct_Split, options );
+    check_tree( top_down, 4u );
+
+    if ( statistics_enabled )
+    {
+        EXPECT_GT( get_build_statistics().find_bounds_seconds, 0 );
+        EXPECT_GT( get_build_statistics().partitioning_seconds, 0 );
+    }
+
+    const auto linear = BoundingVolumeHierarchy::make_BVH_linear( mesh );
+    check_tree( linear, 1u );
+
+    EXPECT_EQ( get_build_statistics().find_bounds_seconds, 0 );
+    EXPECT_EQ( get_build_statistics().partitioning_seconds, 0 );
+}
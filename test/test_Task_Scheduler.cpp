@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include "../Task_Scheduler.h"
+
+using namespace CoDet;
+
+TEST( Task_Scheduler, Runs_All_Tasks )
+{
+    Task_Scheduler scheduler( 4u );
+
+    std::atomic<unsigned int> counter( 0u );
+    {
+        Task_Scheduler::Task_Group group( scheduler );
+
+        for( unsigned int i=0u; i<1000u; ++i )
+        {
+            group.spawn(
+                [&counter]
+                ()
+                {
+                    counter.fetch_add( 1u );
+                } );
+        }
+
+        group.wait();
+        ASSERT_EQ( counter.load(), 1000u );
+    }
+}
+
+static
+unsigned int
+parallel_fibonacci(
+        Task_Scheduler&     scheduler,
+        const unsigned int  n )
+{
+    if ( n < 2u )
+    {
+        return n;
+    }
+
+    unsigned int a = 0u;
+    unsigned int b = 0u;
+
+    Task_Scheduler::Task_Group group( scheduler );
+    group.spawn( [&scheduler,&a,n](){ a = parallel_fibonacci( scheduler, n-1u ); } );
+    group.spawn( [&scheduler,&b,n](){ b = parallel_fibonacci( scheduler, n-2u ); } );
+    group.wait();
+
+    return a + b;
+}
+
+TEST( Task_Scheduler, Nested_Groups )
+{
+    Task_Scheduler scheduler( 3u );
+
+    ASSERT_EQ( parallel_fibonacci( scheduler, 16u ), 987u );
+}
+
+TEST( Task_Scheduler, Rethrows_Task_Exceptions )
+{
+    Task_Scheduler scheduler( 4u );
+
+    std::atomic<unsigned int> counter( 0u );
+    Task_Scheduler::Task_Group group( scheduler );
+
+    for( unsigned int i=0u; i<100u; ++i )
+    {
+        group.spawn(
+            [&counter,i]
+            ()
+            {
+                if ( 0u == i % 10u )
+                {
+                    throw std::runtime_error( "task failed" );
+                }
+
+                counter.fetch_add( 1u );
+            } );
+    }
+
+    // every task has run, one of the exceptions reaches the caller
+    ASSERT_THROW( group.wait(), std::runtime_error );
+    ASSERT_EQ( counter.load(), 90u );
+
+    // the group can be used again
+    group.spawn( [&counter](){ counter.fetch_add( 1u ); } );
+    ASSERT_NO_THROW( group.wait() );
+    ASSERT_EQ( counter.load(), 91u );
+}
+
+static
+unsigned int
+failing_fibonacci(
+        Task_Scheduler&     scheduler,
+        const unsigned int  n )
+{
+    if ( n < 2u )
+    {
+        throw std::runtime_error( "leaf failed" );
+    }
+
+    Task_Scheduler::Task_Group group( scheduler );
+    group.spawn( [&scheduler,n](){ failing_fibonacci( scheduler, n-1u ); } );
+    group.spawn( [&scheduler,n](){ failing_fibonacci( scheduler, n-2u ); } );
+    group.wait();
+
+    return 0u;
+}
+
+TEST( Task_Scheduler, Nested_Exceptions )
+{
+    Task_Scheduler scheduler( 3u );
+
+    ASSERT_THROW( failing_fibonacci( scheduler, 12u ), std::runtime_error );
+
+    // workers are still running tasks
+    ASSERT_EQ( parallel_fibonacci( scheduler, 12u ), 144u );
+}